@@ -12,6 +12,7 @@ intq_init (struct intq *q)
 {
   lock_init (&q->lock);
   q->not_full = q->not_empty = NULL;
+  pollq_init (&q->pollers);
   q->head = q->tail = 0;
 }
 
@@ -51,6 +52,7 @@ intq_getc (struct intq *q)
   byte = q->buf[q->tail];
   q->tail = next (q->tail);
   signal (q, &q->not_full);
+  pollq_wake (&q->pollers);
   return byte;
 }
 
@@ -72,6 +74,7 @@ intq_putc (struct intq *q, uint8_t byte)
   q->buf[q->head] = byte;
   q->head = next (q->head);
   signal (q, &q->not_empty);
+  pollq_wake (&q->pollers);
 }
 
 /* Returns the position after POS within an intq. */
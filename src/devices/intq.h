@@ -2,6 +2,7 @@
 #define DEVICES_INTQ_H
 
 #include "threads/interrupt.h"
+#include "threads/pollq.h"
 #include "threads/synch.h"
 
 /* An "interrupt queue", a circular buffer shared between
@@ -27,6 +28,7 @@ struct intq
     struct lock lock;           /* Only one thread may wait at once. */
     struct thread *not_full;    /* Thread waiting for not-full condition. */
     struct thread *not_empty;   /* Thread waiting for not-empty condition. */
+    struct pollq pollers;       /* Pollers waiting for either. */
 
     /* Queue. */
     uint8_t buf[INTQ_BUFSIZE];  /* Buffer. */
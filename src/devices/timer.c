@@ -1,10 +1,16 @@
 #include "devices/timer.h"
+#include <barrier.h>
+#include <clock.h>
 #include <debug.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
+#include "devices/rtc.h"
 #include "threads/interrupt.h"
+#include "threads/kprofile.h"
+#include "threads/palloc.h"
+#include "threads/pollq.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -24,7 +30,15 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Nanoseconds per timer tick. */
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+/* The clock page that is mapped into user processes; see
+   lib/clock.h. */
+static struct clock_page *clock_page;
+
 static intr_handler_func timer_interrupt;
+static void update_clock_page(void);
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
@@ -36,6 +50,10 @@ void timer_init(void)
 {
   pit_configure_channel(0, 2, TIMER_FREQ);
   intr_register_ext(0x20, timer_interrupt, "8254 Timer");
+
+  clock_page = palloc_get_page(PAL_ZERO | PAL_ASSERT);
+  clock_page->freq = TIMER_FREQ;
+  clock_page->boot_time = rtc_get_time();
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -62,6 +80,31 @@ void timer_calibrate(void)
       loops_per_tick |= test_bit;
 
   printf("%'" PRIu64 " loops/s.\n", (uint64_t)loops_per_tick * TIMER_FREQ);
+
+  /* Measure the time-stamp counter over a few ticks, so that
+     user programs can tell the time between ticks. */
+  {
+    int64_t start = ticks;
+    uint64_t tsc;
+
+    while (ticks == start)
+      barrier();
+    tsc = clock_rdtsc();
+    start = ticks;
+    while (ticks < start + 4)
+      barrier();
+    tsc = (clock_rdtsc() - tsc) / 4;
+    if (tsc > 0)
+      clock_page->ns_mult = ((uint64_t)NS_PER_TICK << 32) / tsc;
+  }
+}
+
+/* Returns the kernel address of the clock page, which is mapped
+   read-only into every user process. */
+void *
+timer_clock_page(void)
+{
+  return clock_page;
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -155,11 +198,14 @@ void timer_print_stats(void)
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt(struct intr_frame *args UNUSED)
+timer_interrupt(struct intr_frame *args)
 {
   ticks++;
-  thread_tick();
+  update_clock_page();
+  kprofile_sample(args);
+  thread_tick(args);
   thread_sleep_tick();
+  poller_tick(ticks);
 
   if (thread_mlfqs)
   {
@@ -173,6 +219,21 @@ timer_interrupt(struct intr_frame *args UNUSED)
   }
 }
 
+/* Publishes the new tick count, with the time-stamp counter
+   reading that goes with it, in the clock page. */
+static void
+update_clock_page(void)
+{
+  clock_page->seq++;
+  barrier();
+  clock_page->ticks = ticks;
+  clock_page->ns = ticks * NS_PER_TICK;
+  clock_page->tsc = clock_rdtsc();
+  clock_page->load_avg = thread_get_load_avg();
+  barrier();
+  clock_page->seq++;
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -9,6 +9,7 @@
 
 void timer_init (void);
 void timer_calibrate (void);
+void *timer_clock_page (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
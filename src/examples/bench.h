@@ -0,0 +1,18 @@
+#ifndef EXAMPLES_BENCH_H
+#define EXAMPLES_BENCH_H
+
+/* Helpers shared by the benchmark programs in this directory. */
+
+#include <stdint.h>
+
+/* Returns the processor's time-stamp counter, which user
+   programs may read directly. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+#endif /* examples/bench.h */
@@ -1,6 +1,9 @@
 /* cat.c
 
-   Prints files specified on command line to the console. */
+   Prints files specified on command line to the console, with
+   sendfile() so that the data does not pass through user
+   memory, or copies standard input to standard output if there
+   are none. */
 
 #include <stdio.h>
 #include <syscall.h>
@@ -10,6 +13,16 @@ main (int argc, char *argv[])
 {
   bool success = true;
   int i;
+
+  if (argc < 2)
+    {
+      char buffer[1024];
+      int bytes_read;
+
+      while ((bytes_read = read (STDIN_FILENO, buffer, sizeof buffer)) > 0)
+        write (STDOUT_FILENO, buffer, bytes_read);
+      return EXIT_SUCCESS;
+    }
   
   for (i = 1; i < argc; i++) 
     {
@@ -20,14 +33,8 @@ main (int argc, char *argv[])
           success = false;
           continue;
         }
-      for (;;) 
-        {
-          char buffer[1024];
-          int bytes_read = read (fd, buffer, sizeof buffer);
-          if (bytes_read == 0)
-            break;
-          write (STDOUT_FILENO, buffer, bytes_read);
-        }
+      while (sendfile (STDOUT_FILENO, fd, filesize (fd)) > 0)
+        continue;
       close (fd);
     }
   return success ? EXIT_SUCCESS : EXIT_FAILURE;
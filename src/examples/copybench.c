@@ -0,0 +1,123 @@
+/* copybench.c
+
+   Measures the throughput of copying a large file with a
+   read()/write() loop through a user buffer, as cp used to,
+   against copy_file_range(), which copies in the kernel.
+   Throughput is reported in bytes per thousand cycles, which is
+   also MB/s per GHz of clock speed.
+
+   Usage: copybench [KB] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "bench.h"
+
+#define DEFAULT_KB 256
+
+#define SRC_FILE "copybench.src"
+#define DST_FILE "copybench.dst"
+
+static char buf[1024];
+
+/* Opens SRC_FILE and a new DST_FILE of SIZE bytes, storing their
+   file descriptors in *IN and *OUT.  Returns true if
+   successful. */
+static bool
+open_files (int size, int *in, int *out)
+{
+  remove (DST_FILE);
+  if (!create (DST_FILE, size))
+    return false;
+  *in = open (SRC_FILE);
+  *out = open (DST_FILE);
+  return *in >= 0 && *out >= 0;
+}
+
+/* Copies SIZE bytes from SRC_FILE to DST_FILE with read() and
+   write() and returns the number of cycles taken, or 0 on
+   failure. */
+static uint64_t
+copy_user (int size)
+{
+  uint64_t start;
+  int in, out, done;
+
+  if (!open_files (size, &in, &out))
+    return 0;
+  start = rdtsc ();
+  for (done = 0; done < size; done += sizeof buf)
+    if (read (in, buf, sizeof buf) <= 0
+        || write (out, buf, sizeof buf) != sizeof buf)
+      return 0;
+  start = rdtsc () - start;
+  close (in);
+  close (out);
+  return start;
+}
+
+/* Copies SIZE bytes from SRC_FILE to DST_FILE with
+   copy_file_range() and returns the number of cycles taken, or 0
+   on failure. */
+static uint64_t
+copy_kernel (int size)
+{
+  uint64_t start;
+  int in, out;
+
+  if (!open_files (size, &in, &out))
+    return 0;
+  start = rdtsc ();
+  if (copy_file_range (in, out, size) != size)
+    return 0;
+  start = rdtsc () - start;
+  close (in);
+  close (out);
+  return start;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint64_t user_cycles, kernel_cycles;
+  int kb = DEFAULT_KB;
+  int size, fd, i;
+
+  if (argc > 1)
+    kb = atoi (argv[1]);
+  if (kb <= 0)
+    {
+      printf ("usage: copybench [KB]\n");
+      return EXIT_FAILURE;
+    }
+  size = kb * 1024;
+
+  /* Make the source file. */
+  memset (buf, 'x', sizeof buf);
+  remove (SRC_FILE);
+  if (!create (SRC_FILE, 0) || (fd = open (SRC_FILE)) < 0)
+    {
+      printf ("copybench: cannot create %s\n", SRC_FILE);
+      return EXIT_FAILURE;
+    }
+  for (i = 0; i < kb; i++)
+    write (fd, buf, sizeof buf);
+  close (fd);
+
+  user_cycles = copy_user (size);
+  kernel_cycles = copy_kernel (size);
+  remove (SRC_FILE);
+  remove (DST_FILE);
+  if (user_cycles == 0 || kernel_cycles == 0)
+    {
+      printf ("copybench: copy failed\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("read/write:      %llu bytes/kcycle\n",
+          (uint64_t) size * 1000 / user_cycles);
+  printf ("copy_file_range: %llu bytes/kcycle\n",
+          (uint64_t) size * 1000 / kernel_cycles);
+  return EXIT_SUCCESS;
+}
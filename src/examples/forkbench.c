@@ -0,0 +1,65 @@
+/* forkbench.c
+
+   Compares the cost of creating a process with fork() against
+   exec() of this same binary.  Each iteration creates a child
+   that exits immediately and waits for it, so the figures
+   include process teardown.
+
+   Usage: forkbench [ITERATIONS] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "bench.h"
+
+#define DEFAULT_ITERATIONS 50
+
+int
+main (int argc, char *argv[])
+{
+  uint64_t start, fork_cycles, exec_cycles;
+  int iterations = DEFAULT_ITERATIONS;
+  int i;
+
+  /* Child started by exec(): nothing to do. */
+  if (argc > 1 && !strcmp (argv[1], "-x"))
+    return EXIT_SUCCESS;
+
+  if (argc > 1)
+    iterations = atoi (argv[1]);
+  if (iterations <= 0)
+    {
+      printf ("usage: forkbench [ITERATIONS]\n");
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      pid_t pid = fork ();
+      if (pid == 0)
+        exit (EXIT_SUCCESS);
+      if (pid == PID_ERROR || wait (pid) != EXIT_SUCCESS)
+        {
+          printf ("forkbench: fork failed\n");
+          return EXIT_FAILURE;
+        }
+    }
+  fork_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    if (wait (exec ("forkbench -x")) != EXIT_SUCCESS)
+      {
+        printf ("forkbench: exec failed\n");
+        return EXIT_FAILURE;
+      }
+  exec_cycles = rdtsc () - start;
+
+  printf ("fork+exit+wait: %llu cycles/iteration\n",
+          fork_cycles / iterations);
+  printf ("exec+exit+wait: %llu cycles/iteration\n",
+          exec_cycles / iterations);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+/* mallocbench.c
+
+   Measures malloc() and free() from lib/user/malloc.c on an
+   allocation-heavy workload: each of THREADS threads keeps a
+   working set of SLOTS blocks of random small sizes, replacing a
+   random one on each iteration, with an occasional block too big
+   for the size classes.  Reports cycles per malloc+free pair and
+   how far the heap grew.
+
+   Usage: mallocbench [ITERATIONS [THREADS [SLOTS]]] */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "bench.h"
+
+#define DEFAULT_ITERATIONS 100000
+#define DEFAULT_THREADS 1
+#define DEFAULT_SLOTS 1024
+#define MAX_THREADS 32
+
+static int iterations = DEFAULT_ITERATIONS;
+static int slot_cnt = DEFAULT_SLOTS;
+
+/* Runs the workload in the calling thread, seeding the random
+   number generator with AUX.  Returns 0 if successful, -1 if
+   memory ran out or a block was corrupted. */
+static int
+churn (void *aux)
+{
+  unsigned char **blocks = calloc (slot_cnt, sizeof *blocks);
+  unsigned seed = (unsigned) aux;
+  int result = 0;
+  int i;
+
+  if (blocks == NULL)
+    return -1;
+  for (i = 0; i < iterations && result == 0; i++)
+    {
+      int slot;
+      size_t size;
+
+      /* A small linear congruential generator, since random() is
+         not safe to share between threads. */
+      seed = seed * 1103515245 + 12345;
+      slot = (seed >> 8) % slot_cnt;
+      size = (seed >> 8) % ((seed >> 28) == 0 ? 8192 : 256) + 1;
+
+      if (blocks[slot] != NULL)
+        {
+          if (blocks[slot][0] != (unsigned char) slot)
+            result = -1;
+          free (blocks[slot]);
+        }
+      blocks[slot] = malloc (size);
+      if (blocks[slot] == NULL)
+        result = -1;
+      else
+        blocks[slot][0] = slot;
+    }
+  for (i = 0; i < slot_cnt; i++)
+    free (blocks[i]);
+  free (blocks);
+  return result;
+}
+
+int
+main (int argc, char *argv[])
+{
+  tid_t tids[MAX_THREADS];
+  int thread_cnt = DEFAULT_THREADS;
+  uint8_t *heap_start;
+  uint64_t start, cycles;
+  int i, failed = 0;
+
+  if (argc > 1)
+    iterations = atoi (argv[1]);
+  if (argc > 2)
+    thread_cnt = atoi (argv[2]);
+  if (argc > 3)
+    slot_cnt = atoi (argv[3]);
+  if (iterations <= 0 || thread_cnt <= 0 || thread_cnt > MAX_THREADS
+      || slot_cnt <= 0)
+    {
+      printf ("usage: mallocbench [ITERATIONS [THREADS [SLOTS]]]\n");
+      return EXIT_FAILURE;
+    }
+
+  heap_start = sbrk (0);
+  start = rdtsc ();
+  if (thread_cnt == 1)
+    failed = churn ((void *) 1) != 0;
+  else
+    {
+      for (i = 0; i < thread_cnt; i++)
+        if ((tids[i] = thread_create (churn, (void *) (i + 1))) == TID_ERROR)
+          {
+            printf ("mallocbench: thread_create failed\n");
+            return EXIT_FAILURE;
+          }
+      for (i = 0; i < thread_cnt; i++)
+        failed |= thread_join (tids[i]) != 0;
+    }
+  cycles = rdtsc () - start;
+  if (failed)
+    {
+      printf ("mallocbench: out of memory or heap corrupted\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("%d threads x %d iterations, %d live blocks each\n",
+          thread_cnt, iterations, slot_cnt);
+  printf ("malloc+free: %llu cycles\n",
+          cycles / ((uint64_t) iterations * thread_cnt));
+  printf ("heap grew by %d kB\n",
+          (int) ((uint8_t *) sbrk (0) - heap_start) / 1024);
+  return EXIT_SUCCESS;
+}
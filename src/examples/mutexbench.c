@@ -0,0 +1,115 @@
+/* mutexbench.c
+
+   Measures the cost of the user-space mutex in lib/user/synch.c
+   when uncontended, which should be a few instructions with no
+   system call, and of its contended unlock path, which hands the
+   mutex over through a futex() system call.  Then THREADS threads
+   hammer the same mutex, so that a thread preempted while
+   holding it makes the others sleep in futex().
+
+   Usage: mutexbench [ITERATIONS [THREADS]] */
+
+#include <futex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <synch.h>
+#include <syscall.h>
+#include "bench.h"
+
+#define DEFAULT_ITERATIONS 100000
+#define DEFAULT_THREADS 4
+#define MAX_THREADS 32
+
+static struct mutex mutex = MUTEX_INITIALIZER;
+static struct cond cond = COND_INITIALIZER;
+static int counter;
+
+/* Locks and unlocks the mutex AUX times. */
+static int
+hammer (void *aux)
+{
+  int iterations = (int) aux;
+  int i;
+
+  for (i = 0; i < iterations; i++)
+    {
+      mutex_lock (&mutex);
+      counter++;
+      mutex_unlock (&mutex);
+    }
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint64_t start, uncontended, contended, signal, wake, threaded;
+  int iterations = DEFAULT_ITERATIONS;
+  int thread_cnt = DEFAULT_THREADS;
+  tid_t tids[MAX_THREADS];
+  int i;
+
+  if (argc > 1)
+    iterations = atoi (argv[1]);
+  if (argc > 2)
+    thread_cnt = atoi (argv[2]);
+  if (iterations <= 0 || thread_cnt <= 0 || thread_cnt > MAX_THREADS)
+    {
+      printf ("usage: mutexbench [ITERATIONS [THREADS]]\n");
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      mutex_lock (&mutex);
+      mutex_unlock (&mutex);
+    }
+  uncontended = rdtsc () - start;
+
+  /* Mark the mutex as having waiters, as a thread that found it
+     held would, so that unlocking takes the slow path. */
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    {
+      mutex_lock (&mutex);
+      mutex.state = 2;
+      mutex_unlock (&mutex);
+    }
+  contended = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    cond_signal (&cond);
+  signal = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    futex ((int *) &cond.seq, FUTEX_WAKE, 1);
+  wake = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < thread_cnt; i++)
+    if ((tids[i] = thread_create (hammer, (void *) iterations)) == TID_ERROR)
+      {
+        printf ("mutexbench: thread_create failed\n");
+        return EXIT_FAILURE;
+      }
+  for (i = 0; i < thread_cnt; i++)
+    thread_join (tids[i]);
+  threaded = rdtsc () - start;
+  if (counter != thread_cnt * iterations)
+    {
+      printf ("mutexbench: counter is %d, expected %d\n",
+              counter, thread_cnt * iterations);
+      return EXIT_FAILURE;
+    }
+
+  printf ("lock+unlock, uncontended:  %llu cycles\n", uncontended / iterations);
+  printf ("lock+unlock, with waiters: %llu cycles\n", contended / iterations);
+  printf ("cond_signal, no waiters:   %llu cycles\n", signal / iterations);
+  printf ("futex wake, no waiters:    %llu cycles\n", wake / iterations);
+  printf ("lock+unlock, %2d threads:   %llu cycles\n", thread_cnt,
+          threaded / ((uint64_t) iterations * thread_cnt));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+/* pipebench.c
+
+   Measures the throughput of a pipe between a parent, which
+   writes, and a child created by fork(), which reads until end
+   of file.  The test runs once with small writes and once with
+   page-sized writes.  Throughput is reported in bytes per
+   thousand cycles, which is also MB/s per GHz of clock speed.
+
+   Usage: pipebench [KB] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "bench.h"
+
+#define DEFAULT_KB 1024
+
+static char buf[4096];
+
+/* Sends TOTAL bytes through a new pipe to a child, SIZE bytes
+   per write(), and returns the number of cycles taken, or 0 on
+   failure. */
+static uint64_t
+run (size_t total, size_t size)
+{
+  uint64_t start;
+  size_t sent;
+  pid_t pid;
+  int fds[2];
+
+  if (pipe (fds) != 0)
+    return 0;
+
+  start = rdtsc ();
+  pid = fork ();
+  if (pid == 0)
+    {
+      close (fds[1]);
+      while (read (fds[0], buf, sizeof buf) > 0)
+        continue;
+      exit (EXIT_SUCCESS);
+    }
+  close (fds[0]);
+  if (pid == PID_ERROR)
+    return 0;
+  for (sent = 0; sent < total; sent += size)
+    if (write (fds[1], buf, size) != (int) size)
+      break;
+  close (fds[1]);
+  if (wait (pid) != EXIT_SUCCESS || sent < total)
+    return 0;
+  return rdtsc () - start;
+}
+
+int
+main (int argc, char *argv[])
+{
+  static const size_t sizes[] = {64, sizeof buf};
+  int kb = DEFAULT_KB;
+  size_t i;
+
+  if (argc > 1)
+    kb = atoi (argv[1]);
+  if (kb <= 0)
+    {
+      printf ("usage: pipebench [KB]\n");
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t total = (size_t) kb * 1024;
+      uint64_t cycles = run (total, sizes[i]);
+
+      if (cycles == 0)
+        {
+          printf ("pipebench: transfer failed\n");
+          return EXIT_FAILURE;
+        }
+      printf ("%4zu-byte writes: %llu bytes/kcycle\n",
+              sizes[i], (uint64_t) total * 1000 / cycles);
+    }
+  return EXIT_SUCCESS;
+}
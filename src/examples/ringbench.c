@@ -0,0 +1,159 @@
+/* ringbench.c
+
+   Compares the throughput of reads and writes issued one system
+   call at a time against the same requests batched through a
+   submission ring, with and without a kernel polling thread.
+   Each pass writes, then reads back, a file in BLOCK-byte
+   records at explicit offsets.
+
+   Usage: ringbench [RECORDS] */
+
+#include <inttypes.h>
+#include <ring.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "bench.h"
+
+#define BLOCK 512                       /* Bytes per request. */
+#define DEFAULT_RECORDS 64
+#define ENTRIES 32                      /* Ring size. */
+#define RING_ADDR ((void *) 0x20000000) /* Where to map the ring. */
+
+static char buf[BLOCK];
+
+/* Writes then reads RECORDS records of FD with pwrite() and
+   pread(). */
+static void
+plain_pass (int fd, int records)
+{
+  int i;
+
+  for (i = 0; i < records; i++)
+    if (pwrite (fd, buf, BLOCK, i * BLOCK) != BLOCK)
+      {
+        printf ("ringbench: pwrite failed\n");
+        exit (EXIT_FAILURE);
+      }
+  for (i = 0; i < records; i++)
+    if (pread (fd, buf, BLOCK, i * BLOCK) != BLOCK)
+      {
+        printf ("ringbench: pread failed\n");
+        exit (EXIT_FAILURE);
+      }
+}
+
+/* Carries out RECORDS requests of type OP on FD through ring R,
+   keeping the SQ as full as possible.  POLLING says whether R
+   has a kernel polling thread. */
+static void
+ring_requests (struct ring *r, int fd, enum ring_op op, int records,
+               bool polling)
+{
+  int submitted = 0, completed = 0, queued = 0;
+
+  while (completed < records)
+    {
+      struct ring_sqe *sqe;
+      struct ring_cqe *cqe;
+
+      while (submitted < records && (sqe = ring_next_sqe (r)) != NULL)
+        {
+          sqe->op = op;
+          sqe->flags = RING_F_OFFSET;
+          sqe->fd = fd;
+          sqe->buf = buf;
+          sqe->len = BLOCK;
+          sqe->offset = submitted * BLOCK;
+          sqe->user_data = submitted;
+          ring_push_sqe (r);
+          submitted++;
+          queued++;
+        }
+
+      /* A poller picks up requests by itself, unless it has gone
+         to sleep. */
+      if (polling ? (r->flags & RING_NEED_WAKEUP) != 0 : queued > 0)
+        ring_enter (queued, 0);
+      queued = 0;
+
+      while ((cqe = ring_peek_cqe (r)) != NULL)
+        {
+          if (cqe->res != BLOCK)
+            {
+              printf ("ringbench: request %"PRIu32" failed\n",
+                      cqe->user_data);
+              exit (EXIT_FAILURE);
+            }
+          ring_pop_cqe (r);
+          completed++;
+        }
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct ring *r = RING_ADDR;
+  int records = DEFAULT_RECORDS;
+  uint64_t start, plain, batched, polled;
+  pid_t pid;
+  int fd;
+
+  if (argc > 1)
+    records = atoi (argv[1]);
+  if (records <= 0)
+    {
+      printf ("usage: ringbench [RECORDS]\n");
+      return EXIT_FAILURE;
+    }
+
+  memset (buf, 'x', sizeof buf);
+  if (!create ("ringbench.dat", records * BLOCK)
+      || (fd = open ("ringbench.dat")) < 0)
+    {
+      printf ("ringbench: cannot create ringbench.dat\n");
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  plain_pass (fd, records);
+  plain = rdtsc () - start;
+
+  if (ring_setup (r, ENTRIES, 0) < 0)
+    {
+      printf ("ringbench: ring_setup failed\n");
+      return EXIT_FAILURE;
+    }
+  start = rdtsc ();
+  ring_requests (r, fd, RING_WRITE, records, false);
+  ring_requests (r, fd, RING_READ, records, false);
+  batched = rdtsc () - start;
+
+  printf ("pread/pwrite:  %llu cycles/request\n", plain / (2 * records));
+  printf ("ring, batched: %llu cycles/request\n", batched / (2 * records));
+
+  /* A process has only one ring, so measure polling in a child,
+     which does not inherit ours but still has its address
+     reserved. */
+  pid = fork ();
+  if (pid == 0)
+    {
+      r = (struct ring *) ((char *) RING_ADDR + 0x100000);
+      if (ring_setup (r, ENTRIES, RING_SQPOLL) < 0)
+        {
+          printf ("ringbench: ring_setup with polling failed\n");
+          exit (EXIT_FAILURE);
+        }
+      start = rdtsc ();
+      ring_requests (r, fd, RING_WRITE, records, true);
+      ring_requests (r, fd, RING_READ, records, true);
+      polled = rdtsc () - start;
+      printf ("ring, polled:  %llu cycles/request\n",
+              polled / (2 * records));
+      exit (EXIT_SUCCESS);
+    }
+  return pid != PID_ERROR && wait (pid) == EXIT_SUCCESS
+         ? EXIT_SUCCESS : EXIT_FAILURE;
+}
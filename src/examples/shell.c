@@ -3,12 +3,19 @@
 #include <string.h>
 #include <syscall.h>
 
+/* Most words in a command. */
+#define MAX_ARGS 32
+
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static pid_t launch (char *command, int in_fd, int out_fd);
 
 int
 main (void)
 {
+  /* read_line() echoes each key as it arrives. */
+  setvbuf (stdout, NULL, _IONBF, 0);
+
   printf ("Shell starting...\n");
   for (;;) 
     {
@@ -30,13 +37,33 @@ main (void)
         {
           /* Empty command. */
         }
+      else if (strchr (command, '|') != NULL)
+        {
+          /* Pipeline of two commands. */
+          char *second = strchr (command, '|');
+          pid_t pids[2];
+          int fds[2];
+
+          *second++ = '\0';
+          if (pipe (fds) != 0)
+            {
+              printf ("pipe failed\n");
+              continue;
+            }
+          pids[0] = launch (command, -1, fds[1]);
+          close (fds[1]);
+          pids[1] = launch (second, fds[0], -1);
+          close (fds[0]);
+          if (pids[0] != PID_ERROR)
+            printf ("\"%s\": exit code %d\n", command, wait (pids[0]));
+          if (pids[1] != PID_ERROR)
+            printf ("\"%s\": exit code %d\n", second, wait (pids[1]));
+        }
       else
         {
-          pid_t pid = exec (command);
+          pid_t pid = launch (command, -1, -1);
           if (pid != PID_ERROR)
             printf ("\"%s\": exit code %d\n", command, wait (pid));
-          else
-            printf ("exec failed\n");
         }
     }
 
@@ -102,3 +129,79 @@ backspace (char **pos, char line[])
   else
     return false;
 }
+
+/* Starts COMMAND with its standard input and output taken from
+   IN_FD and OUT_FD, or from the shell's own if they are -1.  A
+   "<FILE" or ">FILE" word in COMMAND overrides them with FILE.
+   Returns the new process's pid, or PID_ERROR on failure.  The
+   words of COMMAND are separated by null characters on return,
+   so the caller should only print its first word. */
+static pid_t
+launch (char *command, int in_fd, int out_fd)
+{
+  char *argv[MAX_ARGS + 1];
+  struct spawn_action actions[2];
+  char *in_file = NULL, *out_file = NULL;
+  char *word, *save_ptr;
+  int argc = 0, action_cnt = 0;
+  int opened_in = -1, opened_out = -1;
+  pid_t pid;
+
+  /* Split redirections from the command line. */
+  for (word = strtok_r (command, " ", &save_ptr); word != NULL;
+       word = strtok_r (NULL, " ", &save_ptr))
+    if (word[0] == '<' || word[0] == '>')
+      {
+        char *file = word[1] != '\0' ? word + 1 : strtok_r (NULL, " ",
+                                                            &save_ptr);
+        if (word[0] == '<')
+          in_file = file;
+        else
+          out_file = file;
+      }
+    else if (argc < MAX_ARGS)
+      argv[argc++] = word;
+  argv[argc] = NULL;
+  if (argc == 0)
+    return PID_ERROR;
+
+  /* Open files for redirection. */
+  if (in_file != NULL)
+    {
+      opened_in = in_fd = open (in_file);
+      if (in_fd < 0)
+        {
+          printf ("%s: open failed\n", in_file);
+          return PID_ERROR;
+        }
+    }
+  if (out_file != NULL)
+    {
+      remove (out_file);
+      if (!create (out_file, 0) || (opened_out = out_fd = open (out_file)) < 0)
+        {
+          printf ("%s: create failed\n", out_file);
+          if (opened_in >= 0)
+            close (opened_in);
+          return PID_ERROR;
+        }
+    }
+
+  /* The new process gets our standard input and output, or the
+     redirections. */
+  if (in_fd >= 0)
+    actions[action_cnt++] = (struct spawn_action) {SPAWN_DUP2, in_fd,
+                                                   STDIN_FILENO};
+  if (out_fd >= 0)
+    actions[action_cnt++] = (struct spawn_action) {SPAWN_DUP2, out_fd,
+                                                   STDOUT_FILENO};
+  pid = spawn (argv[0], argv, actions, action_cnt);
+
+  if (opened_in >= 0)
+    close (opened_in);
+  if (opened_out >= 0)
+    close (opened_out);
+  if (pid == PID_ERROR)
+    printf ("spawn failed\n");
+  return pid;
+}
@@ -0,0 +1,94 @@
+/* spawnbench.c
+
+   Measures how many processes per second exec() and spawn() can
+   start, each running this same binary, which exits at once.
+   Each figure includes waiting for the child and tearing it
+   down.  spawn() returns before the child has loaded, so the
+   batched run starts BATCH children before waiting for any of
+   them, letting the parent get ahead while they load.
+
+   Usage: spawnbench [ITERATIONS [MHZ]]
+
+   MHZ is the processor's clock rate, which converts cycles into
+   seconds; rdtsc() cannot tell. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "bench.h"
+
+#define DEFAULT_ITERATIONS 50
+#define DEFAULT_MHZ 1000
+#define BATCH 8
+
+static char *child_argv[] = {"spawnbench", "-x", NULL};
+
+/* Prints the rate for NAME, which started ITERATIONS processes in
+   CYCLES cycles at MHZ. */
+static void
+report (const char *name, int iterations, uint64_t cycles, int mhz)
+{
+  printf ("%s: %llu cycles/process, %llu processes/s\n", name,
+          cycles / iterations,
+          (uint64_t) mhz * 1000000 * iterations / cycles);
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint64_t start;
+  int iterations = DEFAULT_ITERATIONS;
+  int mhz = DEFAULT_MHZ;
+  pid_t pids[BATCH];
+  int i, j;
+
+  /* Child: nothing to do. */
+  if (argc > 1 && !strcmp (argv[1], "-x"))
+    return EXIT_SUCCESS;
+
+  if (argc > 1)
+    iterations = atoi (argv[1]);
+  if (argc > 2)
+    mhz = atoi (argv[2]);
+  if (iterations <= 0 || mhz <= 0)
+    {
+      printf ("usage: spawnbench [ITERATIONS [MHZ]]\n");
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    if (wait (exec ("spawnbench -x")) != EXIT_SUCCESS)
+      {
+        printf ("spawnbench: exec failed\n");
+        return EXIT_FAILURE;
+      }
+  report ("exec+wait", iterations, rdtsc () - start, mhz);
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    if (wait (spawn ("spawnbench", child_argv, NULL, 0)) != EXIT_SUCCESS)
+      {
+        printf ("spawnbench: spawn failed\n");
+        return EXIT_FAILURE;
+      }
+  report ("spawn+wait", iterations, rdtsc () - start, mhz);
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i += BATCH)
+    {
+      int cnt = iterations - i < BATCH ? iterations - i : BATCH;
+
+      for (j = 0; j < cnt; j++)
+        pids[j] = spawn ("spawnbench", child_argv, NULL, 0);
+      for (j = 0; j < cnt; j++)
+        if (wait (pids[j]) != EXIT_SUCCESS)
+          {
+            printf ("spawnbench: spawn failed\n");
+            return EXIT_FAILURE;
+          }
+    }
+  report ("spawn x8, wait x8", iterations, rdtsc () - start, mhz);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+/* syscallbench.c
+
+   Measures the round-trip cost of entering and leaving the
+   kernel, using getpid() as a system call that does no work, and
+   of a write() of a single byte to the console for comparison.
+   The getpid() library call uses SYSENTER if the CPU supports
+   it, so getpid is also timed through "int $0x30" directly to
+   show the difference between the two ways into the kernel.
+
+   Usage: syscallbench [ITERATIONS] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "bench.h"
+
+#define DEFAULT_ITERATIONS 10000
+
+/* Calls getpid() through the interrupt gate, whatever the C
+   library would use. */
+static int
+getpid_int (void)
+{
+  int retval;
+  asm volatile ("pushl %[number]; int $0x30; addl $4, %%esp"
+                : "=a" (retval)
+                : [number] "i" (SYS_GETPID)
+                : "memory");
+  return retval;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint64_t start, null_cycles, int_cycles, write_cycles;
+  int iterations = DEFAULT_ITERATIONS;
+  int i;
+
+  if (argc > 1)
+    iterations = atoi (argv[1]);
+  if (iterations <= 0)
+    {
+      printf ("usage: syscallbench [ITERATIONS]\n");
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    getpid ();
+  null_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    getpid_int ();
+  int_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < iterations / 100 + 1; i++)
+    write (STDOUT_FILENO, ".", 1);
+  write_cycles = rdtsc () - start;
+  printf ("\n");
+
+  printf ("getpid: %llu cycles/call\n", null_cycles / iterations);
+  printf ("getpid via int $0x30: %llu cycles/call\n",
+          int_cycles / iterations);
+  printf ("write: %llu cycles/call\n",
+          write_cycles / (iterations / 100 + 1));
+  return EXIT_SUCCESS;
+}
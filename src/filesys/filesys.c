@@ -10,6 +10,9 @@
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* Serializes file system operations. */
+struct lock filesys_lock;
+
 static void do_format (void);
 
 /* Initializes the file system module.
@@ -17,6 +20,7 @@ static void do_format (void);
 void
 filesys_init (bool format) 
 {
+  lock_init (&filesys_lock);
   fs_device = block_get_role (BLOCK_FILESYS);
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
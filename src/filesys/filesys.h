@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include "filesys/off_t.h"
+#include "threads/synch.h"
 
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
@@ -11,6 +12,10 @@
 /* Block device that contains the file system. */
 extern struct block *fs_device;
 
+/* Serializes file system operations, which are not thread-safe
+   by themselves. */
+extern struct lock filesys_lock;
+
 void filesys_init (bool format);
 void filesys_done (void);
 bool filesys_create (const char *name, off_t initial_size);
@@ -36,6 +36,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    unsigned generation;                /* Bumped by each write. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -136,6 +137,7 @@ inode_open (block_sector_t sector)
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
+  inode->generation = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
   return inode;
@@ -313,6 +315,8 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       bytes_written += chunk_size;
     }
   free (bounce);
+  if (bytes_written > 0)
+    inode->generation++;
 
   return bytes_written;
 }
@@ -337,6 +341,15 @@ inode_allow_write (struct inode *inode)
   inode->deny_write_cnt--;
 }
 
+/* Returns a count that changes whenever INODE's data is written,
+   for caches of data derived from it.  The count is only
+   meaningful while INODE stays open. */
+unsigned
+inode_get_generation (const struct inode *inode)
+{
+  return inode->generation;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode)
@@ -0,0 +1,15 @@
+#ifndef __LIB_BARRIER_H
+#define __LIB_BARRIER_H
+
+/* Optimization barrier.
+
+   The compiler will not reorder memory accesses across an
+   optimization barrier.  x86 does not reorder stores with other
+   stores, or loads with other loads, so this is enough to order
+   accesses to memory shared with another thread, the kernel, or
+   an interrupt handler, without a fence instruction.  See
+   "Optimization Barriers" in the reference guide for more
+   information. */
+#define barrier() asm volatile ("" : : : "memory")
+
+#endif /* lib/barrier.h */
@@ -0,0 +1,47 @@
+#ifndef __LIB_CLOCK_H
+#define __LIB_CLOCK_H
+
+/* The clock page, which is shared between user programs and the
+   kernel.
+
+   The kernel maps one page, read-only, at CLOCK_PAGE_ADDR in
+   every process, and the timer interrupt handler updates it on
+   every tick.  User programs read the time from it without a
+   system call; see clock_gettime() in lib/user/time.h.
+
+   The time between ticks comes from the processor's time-stamp
+   counter: NS plus (TSC now - TSC) times NS_MULT / 2**32,
+   clamped to one tick's worth of nanoseconds.
+
+   The handler makes SEQ odd while it updates the page, so a
+   reader that sees SEQ odd, or changed by the time it is done,
+   must read again. */
+
+#include <stdint.h>
+#include <uthread.h>
+
+struct clock_page
+  {
+    uint32_t seq;               /* Odd while being updated. */
+    uint32_t freq;              /* Timer ticks per second. */
+    int64_t ticks;              /* Timer ticks since boot. */
+    int64_t ns;                 /* Nanoseconds since boot, at the tick. */
+    uint64_t tsc;               /* Time-stamp counter, at the tick. */
+    uint64_t ns_mult;           /* Nanoseconds per TSC cycle, times 2**32. */
+    int64_t boot_time;          /* Seconds since the epoch, at boot. */
+    int load_avg;               /* System load average, times 100. */
+  };
+
+/* Just below the thread stacks, above the highest heap break. */
+#define CLOCK_PAGE_ADDR (UTHREAD_STACKS_BOTTOM - 4096)
+
+/* Returns the processor's time-stamp counter. */
+static inline uint64_t
+clock_rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+#endif /* lib/clock.h */
@@ -0,0 +1,20 @@
+#ifndef __LIB_FUTEX_H
+#define __LIB_FUTEX_H
+
+/* Operations for the futex() system call, which is shared
+   between user programs and the kernel.
+
+   futex(ADDR, FUTEX_WAIT, VAL) sleeps if the int at ADDR still
+   holds VAL, until another thread wakes it, and otherwise
+   returns -1 at once.  futex(ADDR, FUTEX_WAKE, N) wakes up to N
+   threads sleeping on ADDR and returns how many it woke.  The
+   check and the sleep are atomic with respect to FUTEX_WAKE, so
+   a wake-up between a user-space test of ADDR and FUTEX_WAIT is
+   never lost. */
+enum futex_op
+  {
+    FUTEX_WAIT,                 /* Sleep if *ADDR == VAL. */
+    FUTEX_WAKE                  /* Wake up to VAL sleepers. */
+  };
+
+#endif /* lib/futex.h */
@@ -0,0 +1,18 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+#include <stddef.h>
+
+/* A buffer for the vectored I/O system calls, readv() and
+   writev(), which is shared between user programs and the
+   kernel. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer, in bytes. */
+  };
+
+/* Most buffers that one readv() or writev() accepts. */
+#define IOV_MAX 32
+
+#endif /* lib/iovec.h */
@@ -0,0 +1,168 @@
+#include "lz.h"
+#include <string.h>
+#include "debug.h"
+
+/* The compressed data is a sequence of chunks, each of which
+   starts with a control byte CTRL:
+
+        - CTRL < 32: CTRL + 1 literal bytes follow.
+
+        - Otherwise, a back-reference: LEN = CTRL >> 5 is the match
+          length minus 2, extended by a following byte if it is 7,
+          and the next byte together with CTRL & 0x1f gives the
+          distance back into the output, minus 1.
+
+   This is the format of Marc Lehmann's LZF. */
+#define MAX_LIT (1 << 5)                /* Longest literal run. */
+#define MAX_OFF (1 << 13)               /* Greatest match distance. */
+#define MAX_REF ((1 << 8) + (1 << 3))   /* Longest match. */
+
+/* Returns a hash of the 3 bytes at P. */
+static inline unsigned
+hash3 (const uint8_t *p)
+{
+  uint32_t v = ((uint32_t) p[0] << 16) | (p[1] << 8) | p[2];
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Compresses the IN_LEN bytes at IN, which must be at least 1
+   and at most LZ_MAX_INPUT, into the OUT_LEN bytes at OUT.
+   WORK must point to LZ_WORK_SIZE bytes of scratch memory.
+   Returns the size of the compressed data, or 0 if it does not
+   fit in OUT_LEN bytes. */
+size_t
+lz_compress (const void *in_, size_t in_len, void *out_, size_t out_len,
+             void *work)
+{
+  const uint8_t *in = in_;
+  const uint8_t *ip = in;
+  const uint8_t *in_end = in + in_len;
+  uint8_t *out = out_;
+  uint8_t *op = out;
+  uint8_t *out_end = out + out_len;
+  uint16_t *table = work;
+  size_t lit = 0;               /* Bytes in the current literal run. */
+
+  ASSERT (in_len > 0 && in_len <= LZ_MAX_INPUT);
+
+  /* The table holds offsets into IN, so all zeros is as good a
+     start as any: a stale entry just fails to match. */
+  memset (table, 0, LZ_WORK_SIZE);
+
+  /* OP always points just past the control byte reserved for the
+     current literal run. */
+  op++;
+  while (ip < in_end)
+    {
+      /* Room for a back-reference plus the next control byte. */
+      if (out_end - op < 4)
+        return 0;
+
+      if (in_end - ip >= 3)
+        {
+          unsigned h = hash3 (ip);
+          const uint8_t *ref = in + table[h];
+
+          table[h] = ip - in;
+          if (ref < ip && ip - ref <= MAX_OFF
+              && ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2])
+            {
+              size_t max = in_end - ip < MAX_REF ? in_end - ip : MAX_REF;
+              size_t len = 3;
+              size_t off = ip - ref - 1;
+
+              while (len < max && ref[len] == ip[len])
+                len++;
+
+              /* Close the literal run, or take back its unused
+                 control byte. */
+              if (lit > 0)
+                op[-(int) lit - 1] = lit - 1;
+              else
+                op--;
+              lit = 0;
+
+              if (len - 2 < 7)
+                *op++ = (off >> 8) + ((len - 2) << 5);
+              else
+                {
+                  *op++ = (off >> 8) + (7 << 5);
+                  *op++ = len - 2 - 7;
+                }
+              *op++ = off;
+              op++;
+              ip += len;
+              continue;
+            }
+        }
+
+      *op++ = *ip++;
+      if (++lit == MAX_LIT)
+        {
+          op[-(int) lit - 1] = lit - 1;
+          lit = 0;
+          op++;
+        }
+    }
+
+  if (lit > 0)
+    op[-(int) lit - 1] = lit - 1;
+  else
+    op--;
+  return op - out;
+}
+
+/* Decompresses the IN_LEN bytes at IN, produced by
+   lz_compress(), into the OUT_LEN bytes at OUT.  Returns the
+   size of the decompressed data, or 0 if IN is corrupt or its
+   contents do not fit in OUT_LEN bytes. */
+size_t
+lz_decompress (const void *in_, size_t in_len, void *out_, size_t out_len)
+{
+  const uint8_t *ip = in_;
+  const uint8_t *in_end = ip + in_len;
+  uint8_t *out = out_;
+  uint8_t *op = out;
+  uint8_t *out_end = out + out_len;
+
+  while (ip < in_end)
+    {
+      unsigned ctrl = *ip++;
+
+      if (ctrl < MAX_LIT)
+        {
+          size_t len = ctrl + 1;
+
+          if ((size_t) (in_end - ip) < len || (size_t) (out_end - op) < len)
+            return 0;
+          memcpy (op, ip, len);
+          op += len;
+          ip += len;
+        }
+      else
+        {
+          size_t len = ctrl >> 5;
+          size_t off;
+          const uint8_t *ref;
+
+          if (len == 7)
+            {
+              if (ip >= in_end)
+                return 0;
+              len += *ip++;
+            }
+          len += 2;
+          if (ip >= in_end)
+            return 0;
+          off = ((ctrl & 0x1f) << 8) + *ip++ + 1;
+          if (off > (size_t) (op - out) || (size_t) (out_end - op) < len)
+            return 0;
+
+          /* The match may overlap its own output, so copy it a byte
+             at a time. */
+          for (ref = op - off; len > 0; len--)
+            *op++ = *ref++;
+        }
+    }
+  return op - out;
+}
@@ -0,0 +1,26 @@
+#ifndef __LIB_LZ_H
+#define __LIB_LZ_H
+
+/* A small, fast LZ77-family compressor, in the format of LZF.
+   It trades compression ratio for speed, which suits data that
+   is compressed and decompressed often, such as pages swapped to
+   memory. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Hash table size, in bits. */
+#define LZ_HASH_BITS 10
+
+/* Bytes of scratch memory that lz_compress() needs. */
+#define LZ_WORK_SIZE ((1 << LZ_HASH_BITS) * sizeof (uint16_t))
+
+/* Longest input that lz_compress() accepts. */
+#define LZ_MAX_INPUT 65536
+
+size_t lz_compress (const void *in, size_t in_len, void *out, size_t out_len,
+                    void *work);
+size_t lz_decompress (const void *in, size_t in_len,
+                      void *out, size_t out_len);
+
+#endif /* lib/lz.h */
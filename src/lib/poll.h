@@ -0,0 +1,33 @@
+#ifndef __LIB_POLL_H
+#define __LIB_POLL_H
+
+/* A file descriptor to watch with the poll() system call, which
+   is shared between user programs and the kernel.
+
+   The caller sets FD and EVENTS, and poll() sets REVENTS to those
+   of EVENTS that hold, plus any of POLLERR, POLLHUP, and POLLNVAL,
+   which are reported whether requested or not.  An entry with a
+   negative FD is ignored, except for POLL_CHILDREN. */
+struct pollfd
+  {
+    int fd;                     /* File descriptor. */
+    short events;               /* Events of interest. */
+    short revents;              /* Events that hold. */
+  };
+
+/* Events. */
+#define POLLIN 0x01     /* Reading will not block. */
+#define POLLOUT 0x04    /* Writing will not block. */
+#define POLLERR 0x08    /* Write end of a pipe with no readers. */
+#define POLLHUP 0x10    /* Read end of a pipe with no writers. */
+#define POLLNVAL 0x20   /* FD is not open. */
+
+/* An FD that watches the caller's child processes instead of a
+   file.  POLLIN means that one has exited, so that waitany() will
+   not block, and POLLHUP that there are none left. */
+#define POLL_CHILDREN (-2)
+
+/* Most descriptors that one poll() accepts. */
+#define POLL_MAX_FDS 1024
+
+#endif /* lib/poll.h */
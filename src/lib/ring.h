@@ -0,0 +1,140 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+/* Submission and completion rings for batched system calls.
+
+   A process that sets up a ring with ring_setup() shares it with
+   the kernel.  The process queues requests at the tail of the
+   submission queue (SQ) and asks the kernel to carry them out
+   with ring_enter(), which can take any number of requests in a
+   single trap.  The kernel posts the result of each request at
+   the tail of the completion queue (CQ), in the order the
+   requests were submitted.
+
+   With RING_SQPOLL, a kernel thread polls the SQ and carries out
+   requests as they arrive, so that a busy process need not trap
+   at all.  After polling an empty SQ for a while, the thread
+   sets RING_NEED_WAKEUP in the ring's flags and sleeps until the
+   next ring_enter().
+
+   Each side writes only its own indexes: the process writes
+   sq_tail and cq_head, the kernel sq_head, cq_tail and flags.
+   Indexes run freely and wrap around modulo 2**32; entry I of a
+   queue is at I & (entries - 1). */
+
+#include <barrier.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Requests. */
+enum ring_op
+  {
+    RING_NOP,                   /* Do nothing; result 0. */
+    RING_READ,                  /* read(fd, buf, len). */
+    RING_WRITE,                 /* write(fd, buf, len). */
+    RING_OPEN,                  /* open(buf); result is the fd. */
+    RING_CLOSE,                 /* close(fd). */
+    RING_FSYNC                  /* Flush fd to disk. */
+  };
+
+/* Request flags. */
+#define RING_F_OFFSET 0x1       /* READ/WRITE at `offset', as pread(). */
+
+/* A submission queue entry. */
+struct ring_sqe
+  {
+    uint8_t op;                 /* A RING_* request. */
+    uint8_t flags;              /* RING_F_* flags. */
+    uint16_t reserved;
+    int32_t fd;                 /* File descriptor. */
+    void *buf;                  /* Buffer, or file name for OPEN. */
+    uint32_t len;               /* Length of buffer. */
+    uint32_t offset;            /* File offset for RING_F_OFFSET. */
+    uint32_t user_data;         /* Copied to the completion. */
+  };
+
+/* A completion queue entry. */
+struct ring_cqe
+  {
+    uint32_t user_data;         /* From the request. */
+    int32_t res;                /* Result, -1 on failure. */
+  };
+
+/* The shared ring.  ENTRIES SQEs follow the header, and then
+   ENTRIES CQEs. */
+struct ring
+  {
+    volatile uint32_t sq_head;  /* Next SQE the kernel will take. */
+    volatile uint32_t sq_tail;  /* Next SQE the process will fill. */
+    volatile uint32_t cq_head;  /* Next CQE the process will read. */
+    volatile uint32_t cq_tail;  /* Next CQE the kernel will fill. */
+    volatile uint32_t flags;    /* RING_NEED_WAKEUP. */
+    uint32_t entries;           /* Entries in each queue. */
+  };
+
+/* ring_setup() flags. */
+#define RING_SQPOLL 0x1         /* Poll the SQ from a kernel thread. */
+
+/* struct ring flags. */
+#define RING_NEED_WAKEUP 0x1    /* Poller is asleep. */
+
+/* Largest number of entries in a ring. */
+#define RING_MAX_ENTRIES 256
+
+/* Bytes occupied by a ring of ENTRIES entries. */
+#define RING_SIZE(ENTRIES)                                              \
+        (sizeof (struct ring)                                           \
+         + (ENTRIES) * (sizeof (struct ring_sqe) + sizeof (struct ring_cqe)))
+
+/* Returns R's SQEs. */
+static inline struct ring_sqe *
+ring_sqes (struct ring *r)
+{
+  return (struct ring_sqe *) (r + 1);
+}
+
+/* Returns R's CQEs. */
+static inline struct ring_cqe *
+ring_cqes (struct ring *r)
+{
+  return (struct ring_cqe *) (ring_sqes (r) + r->entries);
+}
+
+/* Returns the next free SQE in R, or a null pointer if the SQ is
+   full.  The SQE is queued by ring_push_sqe(). */
+static inline struct ring_sqe *
+ring_next_sqe (struct ring *r)
+{
+  if (r->sq_tail - r->sq_head >= r->entries)
+    return NULL;
+  return &ring_sqes (r)[r->sq_tail & (r->entries - 1)];
+}
+
+/* Queues the SQE returned by the last ring_next_sqe() call. */
+static inline void
+ring_push_sqe (struct ring *r)
+{
+  barrier ();
+  r->sq_tail++;
+}
+
+/* Returns the oldest CQE in R, or a null pointer if the CQ is
+   empty.  ring_pop_cqe() consumes it. */
+static inline struct ring_cqe *
+ring_peek_cqe (struct ring *r)
+{
+  if (r->cq_head == r->cq_tail)
+    return NULL;
+  barrier ();
+  return &ring_cqes (r)[r->cq_head & (r->entries - 1)];
+}
+
+/* Consumes the CQE returned by the last ring_peek_cqe() call. */
+static inline void
+ring_pop_cqe (struct ring *r)
+{
+  barrier ();
+  r->cq_head++;
+}
+
+#endif /* lib/ring.h */
@@ -0,0 +1,26 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Resource usage of a process, as reported by the getrusage()
+   system call, which is shared between user programs and the
+   kernel.  Times are in timer ticks. */
+struct rusage
+  {
+    int64_t utime;              /* Ticks spent running user code. */
+    int64_t stime;              /* Ticks spent in the kernel for it. */
+    int64_t minflt;             /* Page faults served without I/O. */
+    int64_t majflt;             /* Page faults that read a file or swap. */
+    int64_t nvcsw;              /* Context switches from blocking. */
+    int64_t nivcsw;             /* Context switches from preemption. */
+    int64_t nsyscalls;          /* System calls made. */
+    int64_t read_bytes;         /* Bytes read by read() and friends. */
+    int64_t write_bytes;        /* Bytes written by write() and friends. */
+  };
+
+/* Whose usage getrusage() reports. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN (-1)    /* Its children that have been waited for. */
+
+#endif /* lib/rusage.h */
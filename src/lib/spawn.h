@@ -0,0 +1,24 @@
+#ifndef __LIB_SPAWN_H
+#define __LIB_SPAWN_H
+
+/* A file action for the spawn() system call, which is shared
+   between user programs and the kernel.
+
+   A new process starts with its parent's descriptors 0 and 1, as
+   for exec().  spawn() then carries out its actions, in order, on
+   the new process's table before the new process runs. */
+struct spawn_action
+  {
+    int op;                     /* SPAWN_DUP2 or SPAWN_CLOSE. */
+    int fd;                     /* See below. */
+    int new_fd;                 /* See below. */
+  };
+
+/* Actions. */
+#define SPAWN_DUP2 0    /* Parent's FD becomes the child's NEW_FD. */
+#define SPAWN_CLOSE 1   /* Child's FD is closed. */
+
+/* Most actions that one spawn() accepts. */
+#define SPAWN_MAX_ACTIONS 16
+
+#endif /* lib/spawn.h */
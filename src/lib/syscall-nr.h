@@ -28,7 +28,36 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_FORK,                   /* Duplicate this process. */
+    SYS_GETPID,                 /* Obtain this process's id. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write to a file from several buffers. */
+    SYS_PREAD,                  /* Read from a file at a given position. */
+    SYS_PWRITE,                 /* Write to a file at a given position. */
+    SYS_RING_SETUP,             /* Set up a submission ring. */
+    SYS_RING_ENTER,             /* Carry out requests from the ring. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_SPLICE,                 /* Move data between a pipe and a file. */
+    SYS_COPY_FILE_RANGE,        /* Copy data from one file to another. */
+    SYS_SENDFILE,               /* Copy data from a file to the console. */
+    SYS_DUP,                    /* Duplicate a file descriptor. */
+    SYS_DUP2,                   /* Duplicate onto a given descriptor. */
+    SYS_FUTEX,                  /* Wait on or wake a user address. */
+    SYS_THREAD_CREATE,          /* Start a thread in this process. */
+    SYS_THREAD_JOIN,            /* Wait for a thread to exit. */
+    SYS_THREAD_EXIT,            /* End the calling thread. */
+    SYS_SBRK,                   /* Grow or shrink the heap. */
+    SYS_SPAWN,                  /* Start a new process running a program. */
+    SYS_WAITANY,                /* Wait for any child process to die. */
+    SYS_POLL,                   /* Wait for any of several descriptors. */
+    SYS_SHM_OPEN,               /* Open or create a shared memory segment. */
+    SYS_SHM_MAP,                /* Map a shared memory segment. */
+    SYS_SHM_UNMAP,              /* Unmap a shared memory segment. */
+    SYS_SHM_UNLINK,             /* Remove a shared memory segment's name. */
+    SYS_GETRUSAGE               /* Report resource usage. */
   };
 
 #endif /* lib/syscall-nr.h */
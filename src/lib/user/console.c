@@ -1,19 +1,187 @@
 #include <stdio.h>
 #include <string.h>
+#include <synch.h>
 #include <syscall.h>
 #include <syscall-nr.h>
 
+/* A buffered stream.
+
+   An output stream collects bytes in BUF from BUF up to POS and
+   writes them out with a single write() when it is flushed.  An
+   input stream holds the bytes read but not yet consumed between
+   POS and END, and refills BUF with a single read() when they run
+   out. */
+struct stream
+  {
+    int fd;                     /* File descriptor. */
+    bool output;                /* Output stream? */
+    int mode;                   /* _IOFBF, _IOLBF, or _IONBF. */
+    char *buf;                  /* Buffer. */
+    size_t size;                /* Size of BUF. */
+    char *pos;                  /* Next byte to write or read. */
+    char *end;                  /* End of buffered input. */
+    struct mutex lock;          /* Serializes threads. */
+  };
+
+static char stdin_buf[BUFSIZ];
+static char stdout_buf[BUFSIZ];
+static char stderr_buf[128];
+
+static struct stream streams[3] =
+  {
+    {STDIN_FILENO, false, _IOFBF, stdin_buf, sizeof stdin_buf,
+     stdin_buf, stdin_buf, MUTEX_INITIALIZER},
+    {STDOUT_FILENO, true, _IOLBF, stdout_buf, sizeof stdout_buf,
+     stdout_buf, NULL, MUTEX_INITIALIZER},
+    {STDOUT_FILENO, true, _IONBF, stderr_buf, sizeof stderr_buf,
+     stderr_buf, NULL, MUTEX_INITIALIZER},
+  };
+
+FILE *stdin = &streams[0];
+FILE *stdout = &streams[1];
+FILE *stderr = &streams[2];
+
+/* Writes out the bytes buffered in output stream S.  Returns 0 if
+   successful, EOF if a write fails, in which case the unwritten
+   bytes are dropped.  S's lock must be held. */
+static int
+flush_locked (struct stream *s)
+{
+  char *p = s->buf;
+
+  while (p < s->pos)
+    {
+      int n = write (s->fd, p, s->pos - p);
+      if (n <= 0)
+        {
+          s->pos = s->buf;
+          return EOF;
+        }
+      p += n;
+    }
+  s->pos = s->buf;
+  return 0;
+}
+
+/* Appends the SIZE bytes at DATA to output stream S, flushing it
+   whenever its buffer fills.  Data at least as big as the buffer
+   is written directly instead of being copied through it.  S's
+   lock must be held. */
+static void
+put_locked (struct stream *s, const char *data, size_t size)
+{
+  while (size > 0)
+    {
+      size_t room = s->buf + s->size - s->pos;
+      size_t chunk = size < room ? size : room;
+
+      if (s->pos == s->buf && size >= s->size)
+        {
+          int n = write (s->fd, data, size);
+          if (n <= 0)
+            return;
+          chunk = n;
+        }
+      else
+        {
+          memcpy (s->pos, data, chunk);
+          s->pos += chunk;
+          if (s->pos >= s->buf + s->size)
+            flush_locked (s);
+        }
+      data += chunk;
+      size -= chunk;
+    }
+}
+
+/* Starts an output operation on S by acquiring its lock. */
+static void
+begin_output (struct stream *s)
+{
+  if (s == stderr)
+    fflush (stdout);
+  mutex_lock (&s->lock);
+}
+
+/* Ends an output operation on S, which wrote a new-line
+   character if NEWLINE is true, by flushing S as its mode
+   requires and releasing its lock.  Returns 0 if successful, EOF
+   if the flush failed. */
+static int
+end_output (struct stream *s, bool newline)
+{
+  int retval = 0;
+
+  if (s->mode == _IONBF || (s->mode == _IOLBF && newline))
+    retval = flush_locked (s);
+  mutex_unlock (&s->lock);
+  return retval;
+}
+
+/* Auxiliary data for vfprintf_helper(). */
+struct vfprintf_aux
+  {
+    struct stream *stream;      /* Output stream. */
+    int char_cnt;               /* Total characters written so far. */
+    bool newline;               /* Wrote a new-line character? */
+  };
+
+/* Adds C to the stream in AUX. */
+static void
+vfprintf_helper (char c, void *aux_)
+{
+  struct vfprintf_aux *aux = aux_;
+  struct stream *s = aux->stream;
+
+  if (s->pos >= s->buf + s->size)
+    flush_locked (s);
+  *s->pos++ = c;
+  if (c == '\n')
+    aux->newline = true;
+  aux->char_cnt++;
+}
+
+/* Formats the printf() format specification FORMAT with
+   arguments given in ARGS and writes the output to STREAM. */
+int
+vfprintf (FILE *stream, const char *format, va_list args)
+{
+  struct vfprintf_aux aux;
+
+  aux.stream = stream;
+  aux.char_cnt = 0;
+  aux.newline = false;
+  begin_output (stream);
+  __vprintf (format, args, vfprintf_helper, &aux);
+  end_output (stream, aux.newline);
+  return aux.char_cnt;
+}
+
+/* Like printf(), but writes output to STREAM. */
+int
+fprintf (FILE *stream, const char *format, ...)
+{
+  va_list args;
+  int retval;
+
+  va_start (args, format);
+  retval = vfprintf (stream, format, args);
+  va_end (args);
+
+  return retval;
+}
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list. */
 int
-vprintf (const char *format, va_list args) 
+vprintf (const char *format, va_list args)
 {
-  return vhprintf (STDOUT_FILENO, format, args);
+  return vfprintf (stdout, format, args);
 }
 
 /* Like printf(), but writes output to the given HANDLE. */
 int
-hprintf (int handle, const char *format, ...) 
+hprintf (int handle, const char *format, ...)
 {
   va_list args;
   int retval;
@@ -25,28 +193,183 @@ hprintf (int handle, const char *format, ...)
   return retval;
 }
 
+/* Writes C to STREAM.  Returns C, or EOF on failure. */
+int
+fputc (int c, FILE *stream)
+{
+  char c2 = c;
+
+  begin_output (stream);
+  put_locked (stream, &c2, 1);
+  if (end_output (stream, c2 == '\n') == EOF)
+    return EOF;
+  return (unsigned char) c2;
+}
+
+/* Writes string S to STREAM.  Returns 0 if successful, EOF on
+   failure. */
+int
+fputs (const char *s, FILE *stream)
+{
+  begin_output (stream);
+  put_locked (stream, s, strlen (s));
+  return end_output (stream, strchr (s, '\n') != NULL);
+}
+
+/* Writes CNT elements of SIZE bytes each from BUF to STREAM.
+   Returns CNT, or 0 on failure. */
+size_t
+fwrite (const void *buf, size_t size, size_t cnt, FILE *stream)
+{
+  size_t total = size * cnt;
+
+  begin_output (stream);
+  put_locked (stream, buf, total);
+  if (end_output (stream, memchr (buf, '\n', total) != NULL) == EOF)
+    return 0;
+  return cnt;
+}
+
 /* Writes string S to the console, followed by a new-line
    character. */
 int
-puts (const char *s) 
+puts (const char *s)
 {
-  write (STDOUT_FILENO, s, strlen (s));
-  putchar ('\n');
-
-  return 0;
+  begin_output (stdout);
+  put_locked (stdout, s, strlen (s));
+  put_locked (stdout, "\n", 1);
+  return end_output (stdout, true);
 }
 
 /* Writes C to the console. */
 int
-putchar (int c) 
+putchar (int c)
 {
-  char c2 = c;
-  write (STDOUT_FILENO, &c2, 1);
+  return fputc (c, stdout);
+}
+
+/* Writes out any output buffered in STREAM, or in stdout and
+   stderr if STREAM is a null pointer.  Buffered input is kept.
+   Returns 0 if successful, EOF on failure. */
+int
+fflush (FILE *stream)
+{
+  int retval;
+
+  if (stream == NULL)
+    return fflush (stdout) | fflush (stderr);
+  if (!stream->output)
+    return 0;
+
+  mutex_lock (&stream->lock);
+  retval = flush_locked (stream);
+  mutex_unlock (&stream->lock);
+  return retval;
+}
+
+/* Sets STREAM's buffering MODE, one of _IOFBF, _IOLBF, or _IONBF.
+   If BUF is nonnull, STREAM uses the SIZE bytes there as its
+   buffer from now on; otherwise it keeps its current buffer.
+   Flushes STREAM's output first.  Input streams can only change
+   buffers while they hold no unread input.  Returns 0 if
+   successful, EOF on failure. */
+int
+setvbuf (FILE *stream, char *buf, int mode, size_t size)
+{
+  int retval = 0;
+
+  if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF)
+    return EOF;
+
+  mutex_lock (&stream->lock);
+  if (stream->output)
+    flush_locked (stream);
+  stream->mode = mode;
+  if (buf != NULL && size > 0)
+    {
+      if (stream->output || stream->pos == stream->end)
+        {
+          stream->buf = stream->pos = stream->end = buf;
+          stream->size = size;
+        }
+      else
+        retval = EOF;
+    }
+  mutex_unlock (&stream->lock);
+  return retval;
+}
+
+/* Returns the next byte from input stream S, or EOF at end of
+   file or on error.  S's lock must be held. */
+static int
+get_locked (struct stream *s)
+{
+  if (s->pos >= s->end)
+    {
+      int n;
+
+      if (s == stdin)
+        fflush (stdout);
+      n = read (s->fd, s->buf, s->mode == _IONBF ? 1 : s->size);
+      if (n <= 0)
+        return EOF;
+      s->pos = s->buf;
+      s->end = s->buf + n;
+    }
+  return (unsigned char) *s->pos++;
+}
+
+/* Reads and returns the next byte from STREAM, or EOF at end of
+   file or on error. */
+int
+fgetc (FILE *stream)
+{
+  int c;
+
+  mutex_lock (&stream->lock);
+  c = get_locked (stream);
+  mutex_unlock (&stream->lock);
   return c;
 }
-
+
+/* Reads and returns the next byte from stdin, or EOF at end of
+   file or on error. */
+int
+getchar (void)
+{
+  return fgetc (stdin);
+}
+
+/* Reads a line from STREAM into S, which has room for SIZE bytes,
+   stopping after a new-line character, which is kept, or at end
+   of file.  S is always null-terminated.  Returns S, or a null
+   pointer if end of file or an error came before any byte. */
+char *
+fgets (char *s, int size, FILE *stream)
+{
+  char *p = s;
+
+  if (size <= 0)
+    return NULL;
+
+  mutex_lock (&stream->lock);
+  while (p < s + size - 1)
+    {
+      int c = get_locked (stream);
+      if (c == EOF)
+        break;
+      *p++ = c;
+      if (c == '\n')
+        break;
+    }
+  mutex_unlock (&stream->lock);
+
+  *p = '\0';
+  return p > s ? s : NULL;
+}
+
 /* Auxiliary data for vhprintf_helper(). */
-struct vhprintf_aux 
+struct vhprintf_aux
   {
     char buf[64];       /* Character buffer. */
     char *p;            /* Current position in buffer. */
@@ -59,11 +382,16 @@ static void flush (struct vhprintf_aux *);
 
 /* Formats the printf() format specification FORMAT with
    arguments given in ARGS and writes the output to the given
-   HANDLE. */
+   HANDLE.  Output to STDOUT_FILENO goes through stdout, so that
+   it stays in order with printf(). */
 int
-vhprintf (int handle, const char *format, va_list args) 
+vhprintf (int handle, const char *format, va_list args)
 {
   struct vhprintf_aux aux;
+
+  if (handle == STDOUT_FILENO)
+    return vfprintf (stdout, format, args);
+
   aux.p = aux.buf;
   aux.char_cnt = 0;
   aux.handle = handle;
@@ -75,7 +403,7 @@ vhprintf (int handle, const char *format, va_list args)
 /* Adds C to the buffer in AUX, flushing it if the buffer fills
    up. */
 static void
-add_char (char c, void *aux_) 
+add_char (char c, void *aux_)
 {
   struct vhprintf_aux *aux = aux_;
   *aux->p++ = c;
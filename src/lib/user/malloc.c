@@ -0,0 +1,396 @@
+#include <malloc.h>
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <synch.h>
+#include <syscall.h>
+#include <uthread.h>
+
+/* A size-class allocator for user programs, on memory from
+   sbrk().
+
+   The heap is carved into 16 kB chunks, each aligned on its own
+   size, so that the chunk holding a block is found by masking
+   the block's address.  A chunk starts with a `struct span'
+   header.
+
+   A block of up to MAX_SMALL bytes is rounded up to one of
+   CLASS_CNT size classes, spaced at most 25% apart, and comes
+   from a chunk that holds only blocks of its class.  Free small
+   blocks are kept on per-class lists, first in the cache of the
+   thread that freed them and then, in batches, on central lists
+   shared by all threads.  Allocating and freeing from a thread's
+   cache takes no lock.  Each thread finds its cache from its
+   stack pointer (see lib/uthread.h), since there is no
+   thread-local storage; a cache outlives its thread and passes to
+   the next thread on the same stack.  Chunks of small blocks are
+   never given back.
+
+   A bigger block takes a run of whole chunks, with the span
+   header in front.  Freed runs are merged with free neighbors,
+   reused first fit, and returned to the kernel when they are at
+   the top of the heap. */
+
+/* Size of a chunk.  A power of 2. */
+#define CHUNK_SIZE 16384
+
+/* Largest small block. */
+#define MAX_SMALL 2048
+
+/* Number of size classes. */
+#define CLASS_CNT 24
+
+/* Identifies a span header. */
+#define SPAN_MAGIC 0x9a548eed
+
+/* Header at the start of a chunk or run of chunks.  Its size is
+   a multiple of 16, so that blocks after it stay aligned. */
+struct span
+  {
+    unsigned magic;             /* SPAN_MAGIC. */
+    int class;                  /* Size class, or -1 for a large block. */
+    size_t chunk_cnt;           /* Number of chunks in a run. */
+    struct span *next;          /* Next free run, by address. */
+  };
+
+/* A free small block. */
+struct block
+  {
+    struct block *next;
+  };
+
+/* Free small blocks of each class for one thread. */
+struct cache
+  {
+    struct block *lists[CLASS_CNT];
+    unsigned short counts[CLASS_CNT];
+  };
+
+/* One cache for the first thread, one per stack slot. */
+static struct cache caches[UTHREAD_SLOTS + 1];
+
+/* Protects everything below. */
+static struct mutex heap_lock = MUTEX_INITIALIZER;
+static struct block *central[CLASS_CNT]; /* Free blocks per class. */
+static struct span *free_runs;           /* Free runs, by address. */
+
+/* Returns the size of blocks in CLASS. */
+static size_t
+class_size (int class)
+{
+  if (class < 8)
+    return 16 * (class + 1);
+  return (size_t) (4 + (class - 8) % 4 + 1) << ((class - 8) / 4 + 5);
+}
+
+/* Returns the smallest class whose blocks hold SIZE bytes, which
+   must be between 1 and MAX_SMALL. */
+static int
+size_class (size_t size)
+{
+  int bits;
+
+  if (size <= 128)
+    return (size - 1) / 16;
+  bits = 31 - __builtin_clz (size - 1);
+  return 8 + (bits - 7) * 4 + ((size - 1) >> (bits - 2)) - 4;
+}
+
+/* Number of blocks of CLASS moved between a cache and the central
+   list at a time.  A cache holds up to twice as many. */
+static unsigned
+batch_size (int class)
+{
+  size_t cnt = 4096 / class_size (class);
+  return cnt < 4 ? 4 : cnt > 64 ? 64 : cnt;
+}
+
+/* Returns the running thread's cache. */
+static struct cache *
+my_cache (void)
+{
+  int marker;
+  return &caches[uthread_slot ((uintptr_t) &marker) + 1];
+}
+
+/* Returns the span header of the chunk holding P. */
+static struct span *
+span_of (const void *p)
+{
+  struct span *s = (struct span *) ((uintptr_t) p & ~(CHUNK_SIZE - 1));
+  ASSERT (s->magic == SPAN_MAGIC);
+  return s;
+}
+
+/* Returns a run of CNT chunks, taking it from the free runs if
+   possible and from the kernel otherwise, or a null pointer if
+   memory is exhausted.  The caller must hold heap_lock. */
+static struct span *
+alloc_run (size_t cnt)
+{
+  struct span **prev, *s;
+  uintptr_t brk, pad;
+
+  for (prev = &free_runs; (s = *prev) != NULL; prev = &s->next)
+    if (s->chunk_cnt >= cnt)
+      {
+        if (s->chunk_cnt > cnt)
+          {
+            struct span *rest = (struct span *) ((uint8_t *) s
+                                                 + cnt * CHUNK_SIZE);
+            rest->magic = SPAN_MAGIC;
+            rest->class = -1;
+            rest->chunk_cnt = s->chunk_cnt - cnt;
+            rest->next = s->next;
+            *prev = rest;
+          }
+        else
+          *prev = s->next;
+        s->chunk_cnt = cnt;
+        return s;
+      }
+
+  /* Keep chunks aligned, even if the program has moved the break
+     itself. */
+  brk = (uintptr_t) sbrk (0);
+  pad = -brk & (CHUNK_SIZE - 1);
+  if (cnt > (SIZE_MAX - pad) / CHUNK_SIZE
+      || sbrk (pad + cnt * CHUNK_SIZE) == (void *) -1)
+    return NULL;
+  s = (struct span *) (brk + pad);
+  s->magic = SPAN_MAGIC;
+  s->chunk_cnt = cnt;
+  return s;
+}
+
+/* Returns run S to the free runs, merging it with its neighbors,
+   and gives it back to the kernel if it ends the heap.  The
+   caller must hold heap_lock. */
+static void
+free_run (struct span *s)
+{
+  struct span **prev, *next;
+
+  for (prev = &free_runs; *prev != NULL && *prev < s; prev = &(*prev)->next)
+    continue;
+  next = *prev;
+  s->class = -1;
+  s->next = next;
+  *prev = s;
+
+  /* Merge with the following run, then the preceding one. */
+  if (next != NULL && (uint8_t *) s + s->chunk_cnt * CHUNK_SIZE
+                      == (uint8_t *) next)
+    {
+      s->chunk_cnt += next->chunk_cnt;
+      s->next = next->next;
+    }
+  if (prev != &free_runs)
+    {
+      struct span *before = (struct span *) ((uint8_t *) prev
+                                             - offsetof (struct span, next));
+      if ((uint8_t *) before + before->chunk_cnt * CHUNK_SIZE
+          == (uint8_t *) s)
+        {
+          before->chunk_cnt += s->chunk_cnt;
+          before->next = s->next;
+          s = before;
+        }
+    }
+
+  /* S is now the last free run if it ends the heap. */
+  if (s->next == NULL
+      && (uint8_t *) s + s->chunk_cnt * CHUNK_SIZE == sbrk (0)
+      && sbrk (-(intptr_t) (s->chunk_cnt * CHUNK_SIZE)) != (void *) -1)
+    {
+      for (prev = &free_runs; *prev != s; prev = &(*prev)->next)
+        continue;
+      *prev = NULL;
+    }
+}
+
+/* Moves up to a batch of free blocks of CLASS from the central
+   list into cache C, first carving a new chunk into blocks if the
+   central list is empty.  Returns false if memory is
+   exhausted. */
+static bool
+refill (struct cache *c, int class)
+{
+  unsigned batch = batch_size (class);
+  bool success = true;
+
+  mutex_lock (&heap_lock);
+  if (central[class] == NULL)
+    {
+      struct span *s = alloc_run (1);
+      if (s != NULL)
+        {
+          size_t size = class_size (class);
+          uint8_t *p;
+
+          s->class = class;
+          for (p = (uint8_t *) s + CHUNK_SIZE - size;
+               p >= (uint8_t *) (s + 1); p -= size)
+            {
+              struct block *b = (struct block *) p;
+              b->next = central[class];
+              central[class] = b;
+            }
+        }
+      else
+        success = false;
+    }
+  while (c->counts[class] < batch && central[class] != NULL)
+    {
+      struct block *b = central[class];
+      central[class] = b->next;
+      b->next = c->lists[class];
+      c->lists[class] = b;
+      c->counts[class]++;
+    }
+  mutex_unlock (&heap_lock);
+  return success || c->lists[class] != NULL;
+}
+
+/* Moves a batch of free blocks of CLASS from cache C to the
+   central list. */
+static void
+drain (struct cache *c, int class)
+{
+  unsigned batch = batch_size (class);
+
+  mutex_lock (&heap_lock);
+  while (batch-- > 0 && c->lists[class] != NULL)
+    {
+      struct block *b = c->lists[class];
+      c->lists[class] = b->next;
+      c->counts[class]--;
+      b->next = central[class];
+      central[class] = b;
+    }
+  mutex_unlock (&heap_lock);
+}
+
+/* Obtains and returns a new block of at least SIZE bytes, aligned
+   on 16 bytes.  Returns a null pointer if memory is
+   exhausted. */
+void *
+malloc (size_t size)
+{
+  struct cache *c;
+  struct block *b;
+  int class;
+
+  if (size == 0)
+    size = 1;
+  if (size > MAX_SMALL)
+    {
+      struct span *s;
+
+      if (size > SIZE_MAX - sizeof *s - CHUNK_SIZE)
+        return NULL;
+      mutex_lock (&heap_lock);
+      s = alloc_run ((size + sizeof *s + CHUNK_SIZE - 1) / CHUNK_SIZE);
+      mutex_unlock (&heap_lock);
+      if (s == NULL)
+        return NULL;
+      s->class = -1;
+      return s + 1;
+    }
+
+  class = size_class (size);
+  c = my_cache ();
+  if (c->lists[class] == NULL && !refill (c, class))
+    return NULL;
+  b = c->lists[class];
+  c->lists[class] = b->next;
+  c->counts[class]--;
+  return b;
+}
+
+/* Allocates and returns A times B bytes initialized to zeros.
+   Returns a null pointer if memory is exhausted. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+
+  if (b != 0 && a > SIZE_MAX / b)
+    return NULL;
+  p = malloc (a * b);
+  if (p != NULL)
+    memset (p, 0, a * b);
+  return p;
+}
+
+/* Returns the number of bytes usable in block P. */
+static size_t
+block_size (const void *p)
+{
+  struct span *s = span_of (p);
+  return (s->class >= 0
+          ? class_size (s->class)
+          : s->chunk_cnt * CHUNK_SIZE - sizeof *s);
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  void *new_block;
+  size_t old_size;
+
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+  if (old_block == NULL)
+    return malloc (new_size);
+
+  old_size = block_size (old_block);
+  if (new_size <= old_size && new_size > old_size / 2)
+    return old_block;
+  new_block = malloc (new_size);
+  if (new_block != NULL)
+    {
+      memcpy (new_block, old_block,
+              old_size < new_size ? old_size : new_size);
+      free (old_block);
+    }
+  return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc().  P may be null. */
+void
+free (void *p)
+{
+  struct span *s;
+  struct cache *c;
+  struct block *b = p;
+
+  if (p == NULL)
+    return;
+  s = span_of (p);
+  if (s->class < 0)
+    {
+      ASSERT (p == s + 1);
+      mutex_lock (&heap_lock);
+      free_run (s);
+      mutex_unlock (&heap_lock);
+      return;
+    }
+
+  c = my_cache ();
+  b->next = c->lists[s->class];
+  c->lists[s->class] = b;
+  if (++c->counts[s->class] > 2 * batch_size (s->class))
+    drain (c, s->class);
+}
@@ -1,7 +1,39 @@
 #ifndef __LIB_USER_STDIO_H
 #define __LIB_USER_STDIO_H
 
+/* A buffered stream, opaque outside lib/user/console.c. */
+typedef struct stream FILE;
+
+/* Standard streams.  stdout is line buffered.  stderr also goes
+   to the console, unbuffered, and flushes stdout before each
+   write so that the two come out in order.  Reading stdin
+   flushes stdout first, so that a prompt appears before the
+   program waits for its answer. */
+extern FILE *stdin, *stdout, *stderr;
+
+/* Buffering modes for setvbuf(). */
+#define _IOFBF 0                /* Flush when the buffer fills. */
+#define _IOLBF 1                /* Also flush after each new-line. */
+#define _IONBF 2                /* Flush at the end of each call. */
+
+/* Size of the standard streams' buffers. */
+#define BUFSIZ 1024
+
+/* Returned at end of file or on error. */
+#define EOF (-1)
+
 int hprintf (int, const char *, ...) PRINTF_FORMAT (2, 3);
 int vhprintf (int, const char *, va_list) PRINTF_FORMAT (2, 0);
 
+int fprintf (FILE *, const char *, ...) PRINTF_FORMAT (2, 3);
+int vfprintf (FILE *, const char *, va_list) PRINTF_FORMAT (2, 0);
+int fputc (int, FILE *);
+int fputs (const char *, FILE *);
+size_t fwrite (const void *, size_t, size_t, FILE *);
+int fgetc (FILE *);
+int getchar (void);
+char *fgets (char *, int, FILE *);
+int fflush (FILE *);
+int setvbuf (FILE *, char *, int mode, size_t);
+
 #endif /* lib/user/stdio.h */
@@ -0,0 +1,122 @@
+#include <synch.h>
+#include <futex.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* Atomically replaces *P by NEW if it equals OLD, and returns
+   the value *P had. */
+static inline int
+compare_exchange (volatile int *p, int old, int new)
+{
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "+a" (old), "+m" (*p) : "r" (new) : "memory");
+  return old;
+}
+
+/* Atomically stores NEW in *P and returns the value it had. */
+static inline int
+exchange (volatile int *p, int new)
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Atomically adds DELTA to *P and returns the value it had. */
+static inline int
+fetch_add (volatile int *p, int delta)
+{
+  asm volatile ("lock xaddl %0, %1" : "+r" (delta), "+m" (*p) : : "memory");
+  return delta;
+}
+
+/* Initializes M as free. */
+void
+mutex_init (struct mutex *m)
+{
+  m->state = 0;
+}
+
+/* Acquires M, which the caller must not hold, given that it is
+   held already, marking it as having waiters. */
+static void
+mutex_lock_contended (struct mutex *m)
+{
+  while (exchange (&m->state, 2) != 0)
+    futex ((int *) &m->state, FUTEX_WAIT, 2);
+}
+
+/* Acquires M, sleeping until it is free if necessary. */
+void
+mutex_lock (struct mutex *m)
+{
+  if (compare_exchange (&m->state, 0, 1) != 0)
+    mutex_lock_contended (m);
+}
+
+/* Tries to acquire M without sleeping.  Returns true if
+   successful, false if M is held. */
+bool
+mutex_trylock (struct mutex *m)
+{
+  return compare_exchange (&m->state, 0, 1) == 0;
+}
+
+/* Releases M, which the caller must hold, and wakes a waiter if
+   there may be one. */
+void
+mutex_unlock (struct mutex *m)
+{
+  if (fetch_add (&m->state, -1) != 1)
+    {
+      m->state = 0;
+      futex ((int *) &m->state, FUTEX_WAKE, 1);
+    }
+}
+
+/* Initializes condition variable C. */
+void
+cond_init (struct cond *c)
+{
+  c->seq = 0;
+  c->waiters = 0;
+}
+
+/* Atomically releases M and waits for C to be signaled, then
+   reacquires M.  M must be held.  As with any condition
+   variable, the caller must recheck its condition on return. */
+void
+cond_wait (struct cond *c, struct mutex *m)
+{
+  int seq = c->seq;
+
+  c->waiters++;
+  mutex_unlock (m);
+  futex ((int *) &c->seq, FUTEX_WAIT, seq);
+
+  /* Others may be waiting for M too, since a broadcast wakes all
+     of C's waiters at once. */
+  mutex_lock_contended (m);
+  c->waiters--;
+}
+
+/* Wakes one thread waiting on C, if any.  The caller must hold
+   the mutex that the waiters use with C. */
+void
+cond_signal (struct cond *c)
+{
+  if (c->waiters == 0)
+    return;
+  fetch_add (&c->seq, 1);
+  futex ((int *) &c->seq, FUTEX_WAKE, 1);
+}
+
+/* Wakes all threads waiting on C.  The caller must hold the
+   mutex that the waiters use with C. */
+void
+cond_broadcast (struct cond *c)
+{
+  if (c->waiters == 0)
+    return;
+  fetch_add (&c->seq, 1);
+  futex ((int *) &c->seq, FUTEX_WAKE, INT_MAX);
+}
@@ -0,0 +1,40 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* A mutual exclusion lock for threads that share memory.
+
+   Locking and unlocking a mutex that no other thread wants takes
+   one atomic instruction, without entering the kernel.  Only a
+   thread that must wait for the mutex, or must wake a waiter,
+   calls futex().  See Ulrich Drepper, "Futexes Are Tricky". */
+struct mutex
+  {
+    volatile int state;         /* 0: free, 1: held, 2: held, waiters. */
+  };
+
+/* A condition variable, for use with a mutex.  Signaling a
+   condition variable with no waiters does not enter the
+   kernel. */
+struct cond
+  {
+    volatile int seq;           /* Bumped by each signal or broadcast. */
+    volatile int waiters;       /* Threads in cond_wait(). */
+  };
+
+/* Initializers for static mutexes and condition variables. */
+#define MUTEX_INITIALIZER {0}
+#define COND_INITIALIZER {0, 0}
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+void cond_init (struct cond *);
+void cond_wait (struct cond *, struct mutex *);
+void cond_signal (struct cond *);
+void cond_broadcast (struct cond *);
+
+#endif /* lib/user/synch.h */
@@ -1,43 +1,69 @@
 #include <syscall.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
 
+/* Nonzero if the CPU supports SYSENTER, set by syscall_init(). */
+static unsigned char fast_syscalls;
+
+void syscall_init (void);
+
+/* Traps into the kernel for a system call whose number and
+   arguments have been pushed on the stack, then pops ARGS bytes
+   of them.  Uses SYSENTER if the CPU has it, which passes the
+   stack pointer in ECX and the return address in EDX and is
+   several times faster than "int $0x30".  See
+   userprog/sysenter.S for the kernel side.
+
+   The callers below list ECX and EDX as outputs rather than
+   clobbers, so that the compiler may still pass arguments in
+   them: the arguments are all pushed before either is
+   overwritten. */
+#define SYSCALL_TRAP(ARGS)                                      \
+        "cmpb $0, %[fast]; je 2f; "                             \
+        "movl %%esp, %%ecx; movl $1f, %%edx; sysenter; "        \
+        "2: int $0x30; 1: addl $" #ARGS ", %%esp"
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
-          int retval;                                           \
+          int retval, ecx, edx;                                 \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER)                          \
+            ("pushl %[number]; " SYSCALL_TRAP (4)               \
+               : "=a" (retval), "=c" (ecx), "=d" (edx)          \
+               : [number] "i" (NUMBER),                         \
+                 [fast] "m" (fast_syscalls)                     \
                : "memory");                                     \
           retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
+#define syscall1(NUMBER, ARG0)                                  \
+        ({                                                      \
+          int retval, ecx, edx;                                 \
+          asm volatile                                          \
+            ("pushl %[arg0]; pushl %[number]; "                 \
+             SYSCALL_TRAP (8)                                   \
+               : "=a" (retval), "=c" (ecx), "=d" (edx)          \
+               : [number] "i" (NUMBER),                         \
+                 [fast] "m" (fast_syscalls),                    \
+                 [arg0] "g" (ARG0)                              \
+               : "memory");                                     \
+          retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
    returns the return value as an `int'. */
 #define syscall2(NUMBER, ARG0, ARG1)                            \
         ({                                                      \
-          int retval;                                           \
+          int retval, ecx, edx;                                 \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
-               : "=a" (retval)                                  \
+             "pushl %[number]; " SYSCALL_TRAP (12)              \
+               : "=a" (retval), "=c" (ecx), "=d" (edx)          \
                : [number] "i" (NUMBER),                         \
+                 [fast] "m" (fast_syscalls),                    \
                  [arg0] "r" (ARG0),                             \
                  [arg1] "r" (ARG1)                              \
                : "memory");                                     \
@@ -48,12 +74,13 @@
    ARG2, and returns the return value as an `int'. */
 #define syscall3(NUMBER, ARG0, ARG1, ARG2)                      \
         ({                                                      \
-          int retval;                                           \
+          int retval, ecx, edx;                                 \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
-               : "=a" (retval)                                  \
+             "pushl %[number]; " SYSCALL_TRAP (16)              \
+               : "=a" (retval), "=c" (ecx), "=d" (edx)          \
                : [number] "i" (NUMBER),                         \
+                 [fast] "m" (fast_syscalls),                    \
                  [arg0] "r" (ARG0),                             \
                  [arg1] "r" (ARG1),                             \
                  [arg2] "r" (ARG2)                              \
@@ -61,6 +88,43 @@
           retval;                                               \
         })
 
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval, ecx, edx;                                 \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; pushl %[number]; "                 \
+             SYSCALL_TRAP (20)                                  \
+               : "=a" (retval), "=c" (ecx), "=d" (edx)          \
+               : [number] "i" (NUMBER),                         \
+                 [fast] "m" (fast_syscalls),                    \
+                 [arg0] "r" (ARG0),                             \
+                 [arg1] "r" (ARG1),                             \
+                 [arg2] "r" (ARG2),                             \
+                 [arg3] "r" (ARG3)                              \
+               : "memory");                                     \
+          retval;                                               \
+        })
+
+/* Decides whether system calls use SYSENTER.  Called once by
+   _start() before main().  Early Pentium Pro processors report
+   SYSENTER support in CPUID but do not have it. */
+void
+syscall_init (void)
+{
+  unsigned eax = 1, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+  fast_syscalls = ((edx & 0x800) != 0
+                   && !(family == 6 && model < 3 && stepping < 3));
+}
+
 void
 halt (void) 
 {
@@ -68,9 +132,12 @@ halt (void)
   NOT_REACHED ();
 }
 
+/* Like the standard exit(), writes out buffered output first,
+   including when main() returns to lib/user/entry.c. */
 void
 exit (int status)
 {
+  fflush (NULL);
   syscall1 (SYS_EXIT, status);
   NOT_REACHED ();
 }
@@ -87,6 +154,12 @@ wait (pid_t pid)
   return syscall1 (SYS_WAIT, pid);
 }
 
+pid_t
+waitany (int *status)
+{
+  return (pid_t) syscall1 (SYS_WAITANY, status);
+}
+
 bool
 create (const char *file, unsigned initial_size)
 {
@@ -182,3 +255,169 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+pid_t
+getpid (void)
+{
+  return (pid_t) syscall0 (SYS_GETPID);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+ring_setup (void *addr, unsigned entries, unsigned flags)
+{
+  return syscall3 (SYS_RING_SETUP, addr, entries, flags);
+}
+
+int
+ring_enter (unsigned to_submit, unsigned min_complete)
+{
+  return syscall2 (SYS_RING_ENTER, to_submit, min_complete);
+}
+
+int
+pipe (int fds[2])
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+int
+splice (int fd_in, int fd_out, unsigned length)
+{
+  return syscall3 (SYS_SPLICE, fd_in, fd_out, length);
+}
+
+int
+copy_file_range (int fd_in, int fd_out, unsigned length)
+{
+  return syscall3 (SYS_COPY_FILE_RANGE, fd_in, fd_out, length);
+}
+
+int
+sendfile (int fd_out, int fd_in, unsigned length)
+{
+  return syscall3 (SYS_SENDFILE, fd_out, fd_in, length);
+}
+
+int
+dup (int fd)
+{
+  return syscall1 (SYS_DUP, fd);
+}
+
+int
+dup2 (int old_fd, int new_fd)
+{
+  return syscall2 (SYS_DUP2, old_fd, new_fd);
+}
+
+int
+futex (int *addr, int op, int val)
+{
+  return syscall3 (SYS_FUTEX, addr, op, val);
+}
+
+/* Runs FUNC(AUX) in a new thread, then ends the thread with
+   FUNC's return value. */
+static void
+thread_start (int (*func) (void *), void *aux)
+{
+  thread_exit (func (aux));
+}
+
+tid_t
+thread_create (int (*func) (void *), void *aux)
+{
+  return syscall3 (SYS_THREAD_CREATE, thread_start, func, aux);
+}
+
+int
+thread_join (tid_t tid)
+{
+  return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+thread_exit (int status)
+{
+  syscall1 (SYS_THREAD_EXIT, status);
+  NOT_REACHED ();
+}
+
+void *
+sbrk (intptr_t increment)
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+pid_t
+spawn (const char *file, char *const argv[],
+       const struct spawn_action *actions, int action_cnt)
+{
+  return (pid_t) syscall4 (SYS_SPAWN, file, argv, actions, action_cnt);
+}
+
+int
+poll (struct pollfd *fds, int nfds, int timeout)
+{
+  return syscall3 (SYS_POLL, fds, nfds, timeout);
+}
+
+int
+shm_open (const char *name, size_t size)
+{
+  return syscall2 (SYS_SHM_OPEN, name, size);
+}
+
+void *
+shm_map (int shmid, void *addr)
+{
+  return (void *) syscall2 (SYS_SHM_MAP, shmid, addr);
+}
+
+bool
+shm_unmap (void *addr)
+{
+  return syscall1 (SYS_SHM_UNMAP, addr);
+}
+
+bool
+shm_unlink (const char *name)
+{
+  return syscall1 (SYS_SHM_UNLINK, name);
+}
+
+int
+getrusage (int who, struct rusage *usage)
+{
+  return syscall2 (SYS_GETRUSAGE, who, usage);
+}
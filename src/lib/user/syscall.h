@@ -3,11 +3,20 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <iovec.h>
+#include <poll.h>
+#include <rusage.h>
+#include <spawn.h>
+#include <stdint.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
 /* Map region identifier. */
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
@@ -24,6 +33,7 @@ void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 pid_t exec (const char *file);
 int wait (pid_t);
+pid_t waitany (int *status);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
@@ -45,4 +55,33 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+pid_t fork (void);
+pid_t getpid (void);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int ring_setup (void *addr, unsigned entries, unsigned flags);
+int ring_enter (unsigned to_submit, unsigned min_complete);
+int pipe (int fds[2]);
+int splice (int fd_in, int fd_out, unsigned length);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+int sendfile (int fd_out, int fd_in, unsigned length);
+int dup (int fd);
+int dup2 (int old_fd, int new_fd);
+int futex (int *addr, int op, int val);
+tid_t thread_create (int (*func) (void *), void *aux);
+int thread_join (tid_t);
+void thread_exit (int status) NO_RETURN;
+void *sbrk (intptr_t increment);
+pid_t spawn (const char *file, char *const argv[],
+             const struct spawn_action *, int action_cnt);
+int poll (struct pollfd *, int nfds, int timeout);
+int shm_open (const char *name, size_t size);
+void *shm_map (int shmid, void *addr);
+bool shm_unmap (void *addr);
+bool shm_unlink (const char *name);
+int getrusage (int who, struct rusage *);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,87 @@
+#include <time.h>
+#include <barrier.h>
+#include <clock.h>
+
+/* Reading the clock page; see lib/clock.h.  None of these
+   functions makes a system call. */
+
+/* The clock page. */
+static const volatile struct clock_page *const page =
+  (const volatile struct clock_page *) CLOCK_PAGE_ADDR;
+
+/* Returns the nanoseconds since boot. */
+static int64_t
+read_ns (void)
+{
+  uint32_t seq;
+  int64_t ns;
+
+  do
+    {
+      int64_t tick_ns;
+      uint64_t cycles;
+
+      seq = page->seq;
+      barrier ();
+      tick_ns = 1000000000 / page->freq;
+      cycles = clock_rdtsc () - page->tsc;
+      ns = page->ns;
+
+      /* Never count past the next tick, so that the time does not
+         jump backward when it comes.  Comparing first also keeps
+         the multiplication from overflowing. */
+      if (page->ns_mult != 0)
+        {
+          if (cycles >= ((uint64_t) tick_ns << 32) / page->ns_mult)
+            ns += tick_ns;
+          else
+            ns += (cycles * page->ns_mult) >> 32;
+        }
+      barrier ();
+    }
+  while ((seq & 1) != 0 || seq != page->seq);
+  return ns;
+}
+
+/* Stores the current time on CLOCK, CLOCK_REALTIME or
+   CLOCK_MONOTONIC, in *TS.  Returns 0 if successful, -1 if CLOCK
+   is not a valid clock. */
+int
+clock_gettime (int clock, struct timespec *ts)
+{
+  int64_t ns;
+
+  if (clock != CLOCK_REALTIME && clock != CLOCK_MONOTONIC)
+    return -1;
+  ns = read_ns ();
+  ts->tv_sec = ns / 1000000000;
+  ts->tv_nsec = ns % 1000000000;
+  if (clock == CLOCK_REALTIME)
+    ts->tv_sec += page->boot_time;
+  return 0;
+}
+
+/* Returns the number of timer ticks since boot. */
+int64_t
+clock_ticks (void)
+{
+  uint32_t seq;
+  int64_t ticks;
+
+  do
+    {
+      seq = page->seq;
+      barrier ();
+      ticks = page->ticks;
+      barrier ();
+    }
+  while ((seq & 1) != 0 || seq != page->seq);
+  return ticks;
+}
+
+/* Returns the system load average, times 100. */
+int
+clock_load_avg (void)
+{
+  return page->load_avg;
+}
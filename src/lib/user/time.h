@@ -0,0 +1,21 @@
+#ifndef __LIB_USER_TIME_H
+#define __LIB_USER_TIME_H
+
+#include <stdint.h>
+
+/* A time, in seconds and nanoseconds. */
+struct timespec
+  {
+    int64_t tv_sec;             /* Seconds. */
+    long tv_nsec;               /* Nanoseconds, 0 to 999,999,999. */
+  };
+
+/* Clocks for clock_gettime(). */
+#define CLOCK_REALTIME 0        /* Time since the epoch. */
+#define CLOCK_MONOTONIC 1       /* Time since boot. */
+
+int clock_gettime (int clock, struct timespec *);
+int64_t clock_ticks (void);
+int clock_load_avg (void);
+
+#endif /* lib/user/time.h */
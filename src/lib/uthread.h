@@ -0,0 +1,38 @@
+#ifndef __LIB_UTHREAD_H
+#define __LIB_UTHREAD_H
+
+/* Layout of the user stacks of a process's threads.
+
+   The first thread of a process runs on the stack at the top of
+   user memory.  Each thread made by thread_create() runs on a
+   stack in one of UTHREAD_SLOTS fixed slots below that, the
+   first just under UTHREAD_STACKS_TOP.  A slot holds
+   UTHREAD_STACK_PAGES pages of stack with a guard page below.
+
+   The kernel maps the stacks, and the user library tells which
+   thread is running from its stack pointer, without a system
+   call. */
+
+#include <stdint.h>
+
+#define UTHREAD_SLOTS 32
+#define UTHREAD_STACK_PAGES 16
+#define UTHREAD_SLOT_SIZE ((UTHREAD_STACK_PAGES + 1) * 4096)
+
+/* 8 MB below PHYS_BASE, leaving room for the first thread's
+   stack to grow. */
+#define UTHREAD_STACKS_TOP 0xbf800000u
+#define UTHREAD_STACKS_BOTTOM \
+        (UTHREAD_STACKS_TOP - UTHREAD_SLOTS * UTHREAD_SLOT_SIZE)
+
+/* Returns the slot of the stack containing SP, or -1 if SP is on
+   the first thread's stack. */
+static inline int
+uthread_slot (uintptr_t sp)
+{
+  if (sp >= UTHREAD_STACKS_TOP || sp < UTHREAD_STACKS_BOTTOM)
+    return -1;
+  return (UTHREAD_STACKS_TOP - 1 - sp) / UTHREAD_SLOT_SIZE;
+}
+
+#endif /* lib/uthread.h */
@@ -0,0 +1,54 @@
+/* Reads the clock page: checks that the monotonic clock never
+   goes backward and keeps up with the tick count, that the
+   real-time clock is past boot, and that a process that writes
+   to the page is killed. */
+
+#include <clock.h>
+#include <syscall.h>
+#include <time.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static const struct clock_page *const page =
+  (const struct clock_page *) CLOCK_PAGE_ADDR;
+
+/* Returns TS in nanoseconds. */
+static int64_t
+ts_ns (const struct timespec *ts)
+{
+  return ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+void
+test_main (void) 
+{
+  struct timespec ts, prev, rt;
+  int64_t start;
+  bool monotonic = true;
+  pid_t pid;
+
+  CHECK (clock_gettime (CLOCK_MONOTONIC, &prev) == 0, "clock_gettime");
+  start = clock_ticks ();
+  while (clock_ticks () < start + 3)
+    {
+      clock_gettime (CLOCK_MONOTONIC, &ts);
+      if (ts_ns (&ts) < ts_ns (&prev) || ts.tv_nsec >= 1000000000)
+        monotonic = false;
+      prev = ts;
+    }
+  CHECK (monotonic, "monotonic clock never goes backward");
+  CHECK (ts_ns (&prev) >= (start + 2) * (1000000000 / page->freq),
+         "monotonic clock advances with the ticks");
+
+  CHECK (clock_gettime (CLOCK_REALTIME, &rt) == 0
+         && rt.tv_sec > prev.tv_sec, "real-time clock is past boot");
+  CHECK (clock_gettime (7, &ts) == -1, "bad clock id fails");
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      *(volatile uint32_t *) CLOCK_PAGE_ADDR = 0;
+      exit (0);
+    }
+  CHECK (wait (pid) == -1, "writing the clock page kills the process");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(clock-simple) begin
+(clock-simple) clock_gettime
+(clock-simple) monotonic clock never goes backward
+(clock-simple) monotonic clock advances with the ticks
+(clock-simple) real-time clock is past boot
+(clock-simple) bad clock id fails
+(clock-simple) writing the clock page kills the process
+(clock-simple) end
+EOF
+pass;
@@ -0,0 +1,28 @@
+/* Copies sample.txt to a new file with copy_file_range(), in
+   two pieces, the first of which ends in the middle of a disk
+   sector, and checks the copy. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (sizeof sample - 1)
+
+void
+test_main (void) 
+{
+  int in, out;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\"");
+  CHECK (copy_file_range (in, out, 100) == 100, "copy_file_range 100 bytes");
+  CHECK (copy_file_range (in, out, SIZE) == (int) SIZE - 100,
+         "copy_file_range rest of file");
+  CHECK (copy_file_range (in, out, SIZE) == 0, "copy_file_range at end");
+  CHECK (copy_file_range (in, 1234, SIZE) == -1, "copy_file_range bad fd");
+  close (in);
+  close (out);
+  check_file ("test.txt", sample, SIZE);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range) begin
+(copy-range) open "sample.txt"
+(copy-range) create "test.txt"
+(copy-range) open "test.txt"
+(copy-range) copy_file_range 100 bytes
+(copy-range) copy_file_range rest of file
+(copy-range) copy_file_range at end
+(copy-range) copy_file_range bad fd
+(copy-range) open "test.txt" for verification
+(copy-range) verified contents of "test.txt"
+(copy-range) close "test.txt"
+(copy-range) end
+copy-range: exit(0)
+EOF
+pass;
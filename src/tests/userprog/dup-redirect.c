@@ -0,0 +1,48 @@
+/* Duplicates a file descriptor enough times to grow the table
+   well past its initial size, checks that duplicates share a
+   file position, and redirects standard output into a file with
+   dup2(). */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (sizeof sample - 1)
+#define DUPS 1000
+
+void
+test_main (void) 
+{
+  char buf[SIZE];
+  int handle, saved, i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  for (i = 1; i <= DUPS; i++)
+    if (dup (handle) != handle + i)
+      fail ("dup #%d did not return the lowest free descriptor", i);
+  msg ("dup %d times", DUPS);
+
+  CHECK (read (handle, buf, 10) == 10, "read 10 bytes");
+  CHECK (read (handle + DUPS, buf + 10, SIZE - 10) == (int) SIZE - 10,
+         "read rest through duplicate");
+  if (memcmp (buf, sample, SIZE))
+    fail ("data read through duplicates differs from sample.txt");
+
+  for (i = 1; i <= DUPS; i++)
+    close (handle + i);
+  CHECK (dup (handle) == handle + 1, "dup after close");
+  close (handle + 1);
+
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  CHECK ((saved = dup (STDOUT_FILENO)) > 1, "dup stdout");
+  dup2 (handle, STDOUT_FILENO);
+  write (STDOUT_FILENO, sample, SIZE);
+  dup2 (saved, STDOUT_FILENO);
+  close (saved);
+  close (handle);
+  check_file ("test.txt", sample, SIZE);
+}
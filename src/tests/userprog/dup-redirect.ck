@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dup-redirect) begin
+(dup-redirect) open "sample.txt"
+(dup-redirect) dup 1000 times
+(dup-redirect) read 10 bytes
+(dup-redirect) read rest through duplicate
+(dup-redirect) dup after close
+(dup-redirect) create "test.txt"
+(dup-redirect) open "test.txt"
+(dup-redirect) dup stdout
+(dup-redirect) open "test.txt" for verification
+(dup-redirect) verified contents of "test.txt"
+(dup-redirect) close "test.txt"
+(dup-redirect) end
+dup-redirect: exit(0)
+EOF
+pass;
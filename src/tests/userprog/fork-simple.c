@@ -0,0 +1,26 @@
+/* Forks a child, which checks that it sees the parent's memory
+   and then modifies its copy.  The parent must not see the
+   child's writes. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int global = 42;
+
+void
+test_main (void) 
+{
+  int local = 7;
+  pid_t pid = fork ();
+
+  if (pid == 0)
+    {
+      msg ("child sees global=%d local=%d", global, local);
+      global = 1;
+      local = 2;
+      exit (81);
+    }
+  msg ("wait(fork()) = %d", wait (pid));
+  msg ("parent sees global=%d local=%d", global, local);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-simple) begin
+(fork-simple) child sees global=42 local=7
+fork-simple: exit(81)
+(fork-simple) wait(fork()) = 81
+(fork-simple) parent sees global=42 local=7
+(fork-simple) end
+fork-simple: exit(0)
+EOF
+pass;
@@ -0,0 +1,29 @@
+/* Checks the futex() system call's behavior when there is
+   nothing to wait for, and the user-space mutex built on it. */
+
+#include <futex.h>
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int word = 5;
+static struct mutex mutex = MUTEX_INITIALIZER;
+static struct cond cond = COND_INITIALIZER;
+
+void
+test_main (void) 
+{
+  CHECK (futex (&word, FUTEX_WAIT, 6) == -1, "futex wait on changed word");
+  CHECK (futex (&word, FUTEX_WAKE, 1) == 0, "futex wake with no waiters");
+  CHECK (futex (&word, 1234, 0) == -1, "futex bad operation");
+
+  mutex_lock (&mutex);
+  CHECK (!mutex_trylock (&mutex), "trylock held mutex");
+  cond_signal (&cond);
+  cond_broadcast (&cond);
+  mutex_unlock (&mutex);
+  CHECK (mutex_trylock (&mutex), "trylock free mutex");
+  mutex_unlock (&mutex);
+  CHECK (mutex.state == 0, "mutex free");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-simple) begin
+(futex-simple) futex wait on changed word
+(futex-simple) futex wake with no waiters
+(futex-simple) futex bad operation
+(futex-simple) trylock held mutex
+(futex-simple) trylock free mutex
+(futex-simple) mutex free
+(futex-simple) end
+futex-simple: exit(0)
+EOF
+pass;
@@ -0,0 +1,60 @@
+/* Grows and shrinks the heap with sbrk(), and checks malloc(),
+   calloc(), realloc() and free() on top of it. */
+
+#include <malloc.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_CNT 64
+
+void
+test_main (void) 
+{
+  char *brk, *p, *q;
+  char *blocks[BLOCK_CNT];
+  int i, j;
+
+  brk = sbrk (0);
+  CHECK (sbrk (8192) == brk, "sbrk grows heap");
+  CHECK (brk[0] == 0 && brk[8191] == 0, "new heap is zeroed");
+  memset (brk, 'x', 8192);
+  CHECK (sbrk (-8192) == brk + 8192, "sbrk shrinks heap");
+  CHECK (sbrk (0) == brk, "break restored");
+  CHECK (sbrk (-(intptr_t) 4096) == (void *) -1,
+         "sbrk below heap start fails");
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      blocks[i] = malloc (i * 37 + 1);
+      if (blocks[i] == NULL || (uintptr_t) blocks[i] % 16 != 0)
+        fail ("malloc %d failed or misaligned", i);
+      memset (blocks[i], i, i * 37 + 1);
+    }
+  for (i = 0; i < BLOCK_CNT; i++)
+    for (j = 0; j < i * 37 + 1; j++)
+      if (blocks[i][j] != i)
+        fail ("block %d overwritten", i);
+  msg ("small blocks intact");
+  for (i = 0; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+  for (i = 1; i < BLOCK_CNT; i += 2)
+    free (blocks[i]);
+
+  p = malloc (100000);
+  CHECK (p != NULL, "large malloc");
+  memset (p, 'y', 100000);
+  q = realloc (p, 200000);
+  CHECK (q != NULL && q[0] == 'y' && q[99999] == 'y', "realloc keeps data");
+  free (q);
+
+  p = calloc (1000, 10);
+  CHECK (p != NULL, "calloc");
+  for (i = 0; i < 10000; i++)
+    if (p[i] != 0)
+      fail ("calloc'd byte %d is nonzero", i);
+  free (p);
+  free (NULL);
+}
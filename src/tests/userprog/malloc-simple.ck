@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-simple) begin
+(malloc-simple) sbrk grows heap
+(malloc-simple) new heap is zeroed
+(malloc-simple) sbrk shrinks heap
+(malloc-simple) break restored
+(malloc-simple) sbrk below heap start fails
+(malloc-simple) small blocks intact
+(malloc-simple) large malloc
+(malloc-simple) realloc keeps data
+(malloc-simple) calloc
+(malloc-simple) end
+malloc-simple: exit(0)
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Sends sample.txt's contents through a pipe with write() and
+   read(), then splices them from the pipe into a file and back
+   from the file into the pipe, and checks that a read from the
+   pipe after its write end is closed returns end of file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (sizeof sample - 1)
+
+static char buf[SIZE];
+
+void
+test_main (void) 
+{
+  int fds[2];
+  int handle;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (write (fds[1], sample, SIZE) == (int) SIZE, "write to pipe");
+  CHECK (read (fds[0], buf, SIZE) == (int) SIZE, "read from pipe");
+  if (memcmp (buf, sample, SIZE))
+    fail ("data read from pipe differs from data written");
+
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  CHECK (write (fds[1], sample, SIZE) == (int) SIZE, "write to pipe");
+  CHECK (splice (fds[0], handle, SIZE) == (int) SIZE,
+         "splice from pipe to file");
+  check_file ("test.txt", sample, SIZE);
+
+  seek (handle, 0);
+  CHECK (splice (handle, fds[1], SIZE) == (int) SIZE,
+         "splice from file to pipe");
+  memset (buf, 0, SIZE);
+  CHECK (read (fds[0], buf, SIZE) == (int) SIZE, "read from pipe");
+  if (memcmp (buf, sample, SIZE))
+    fail ("data spliced through pipe differs from file");
+
+  close (fds[1]);
+  CHECK (read (fds[0], buf, SIZE) == 0, "read end of file from pipe");
+  close (fds[0]);
+  close (handle);
+}
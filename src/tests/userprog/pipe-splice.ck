@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-splice) begin
+(pipe-splice) pipe
+(pipe-splice) write to pipe
+(pipe-splice) read from pipe
+(pipe-splice) create "test.txt"
+(pipe-splice) open "test.txt"
+(pipe-splice) write to pipe
+(pipe-splice) splice from pipe to file
+(pipe-splice) open "test.txt" for verification
+(pipe-splice) verified contents of "test.txt"
+(pipe-splice) close "test.txt"
+(pipe-splice) splice from file to pipe
+(pipe-splice) read from pipe
+(pipe-splice) read end of file from pipe
+(pipe-splice) end
+pipe-splice: exit(0)
+EOF
+pass;
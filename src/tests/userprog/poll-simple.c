@@ -0,0 +1,55 @@
+/* Polls the ends of a pipe and the caller's children: checks
+   that an empty pipe times out, that a write wakes a blocked
+   poller, that closing the write end reports a hang-up, and that
+   a child's exit is reported before waitany() collects it. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct pollfd pfds[2];
+  int fds[2];
+  int status;
+  pid_t pid;
+  char c;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  pfds[0].fd = fds[0];
+  pfds[0].events = POLLIN;
+  pfds[1].fd = 99;
+  pfds[1].events = POLLIN;
+  CHECK (poll (pfds, 2, 10) == 1, "poll() finds one bad descriptor");
+  CHECK (pfds[0].revents == 0 && pfds[1].revents == POLLNVAL,
+         "empty pipe is not readable");
+  CHECK (poll (pfds, 1, 10) == 0, "poll() on empty pipe times out");
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      write (fds[1], "x", 1);
+      exit (7);
+    }
+  CHECK (poll (pfds, 1, -1) == 1 && pfds[0].revents == POLLIN,
+         "child's write wakes poll()");
+  CHECK (read (fds[0], &c, 1) == 1 && c == 'x', "read from pipe");
+
+  pfds[0].fd = POLL_CHILDREN;
+  CHECK (poll (pfds, 1, -1) == 1 && pfds[0].revents == POLLIN,
+         "child's exit wakes poll()");
+  CHECK (waitany (&status) == pid && status == 7, "waitany() = %d", status);
+  CHECK (poll (pfds, 1, -1) == 1 && pfds[0].revents == POLLHUP,
+         "no children left");
+
+  pfds[0].fd = fds[1];
+  pfds[0].events = POLLOUT;
+  CHECK (poll (pfds, 1, 0) == 1 && pfds[0].revents == POLLOUT,
+         "pipe is writable");
+  close (fds[1]);
+  pfds[0].fd = fds[0];
+  pfds[0].events = POLLIN;
+  CHECK (poll (pfds, 1, 0) == 1 && pfds[0].revents == POLLHUP,
+         "closed pipe hangs up");
+}
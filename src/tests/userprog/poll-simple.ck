@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(poll-simple) begin
+(poll-simple) pipe
+(poll-simple) poll() finds one bad descriptor
+(poll-simple) empty pipe is not readable
+(poll-simple) poll() on empty pipe times out
+(poll-simple) child's write wakes poll()
+(poll-simple) read from pipe
+(poll-simple) child's exit wakes poll()
+(poll-simple) waitany() = 7
+(poll-simple) no children left
+(poll-simple) pipe is writable
+(poll-simple) closed pipe hangs up
+(poll-simple) end
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Runs with the kernel's -profile option.  Forks a child that
+   spins in user mode for a while, then checks the profile that
+   the kernel wrote when the child exited. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include <time.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HEADER "pintos-profile 1\nprogram profile-simple\n"
+
+void
+test_main (void) 
+{
+  char name[16], buf[512];
+  const char *samples;
+  int fd, size;
+  pid_t pid;
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      int64_t start = clock_ticks ();
+      while (clock_ticks () < start + 10)
+        continue;
+      exit (0);
+    }
+  CHECK (wait (pid) == 0, "wait for child");
+
+  snprintf (name, sizeof name, "prof-%d", pid);
+  CHECK ((fd = open (name)) > 1, "open child's profile");
+  size = read (fd, buf, sizeof buf - 1);
+  buf[size > 0 ? size : 0] = '\0';
+  CHECK (!memcmp (buf, HEADER, strlen (HEADER)), "profile names the program");
+  samples = strstr (buf, "\nsamples ");
+  CHECK (samples != NULL && atoi (samples + 9) >= 5, "child was sampled");
+  close (fd);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The sample counts vary from run to run.
+@output = grep (!/^profile-simple: profile: \d+ samples written to prof-\d+$/,
+		@output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(profile-simple) begin
+(profile-simple) wait for child
+(profile-simple) open child's profile
+(profile-simple) profile names the program
+(profile-simple) child was sampled
+(profile-simple) end
+EOF
+pass;
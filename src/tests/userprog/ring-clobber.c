@@ -0,0 +1,38 @@
+/* Overwrites the fields of a submission ring's header that the
+   kernel owns before calling ring_enter(), and checks that the
+   kernel still posts the completion where it belongs instead of
+   following the bogus values. */
+
+#include <ring.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ENTRIES 8
+
+void
+test_main (void) 
+{
+  struct ring *r = (struct ring *) 0x20000000;
+  struct ring_sqe *sqe;
+  struct ring_cqe *cqe;
+
+  CHECK (ring_setup (r, ENTRIES, 0) == 0, "ring_setup");
+  sqe = ring_next_sqe (r);
+  sqe->op = RING_NOP;
+  sqe->user_data = 42;
+  ring_push_sqe (r);
+
+  /* Point the CQ far outside the ring, and scramble the kernel's
+     indexes. */
+  r->entries = 0x10000000;
+  r->sq_head = 12345;
+  r->cq_tail = 54321;
+  CHECK (ring_enter (1, 1) == 1, "ring_enter with clobbered header");
+
+  r->entries = ENTRIES;
+  CHECK (r->sq_head == 1 && r->cq_tail == 1, "kernel indexes restored");
+  cqe = ring_peek_cqe (r);
+  CHECK (cqe != NULL && cqe->user_data == 42 && cqe->res == 0,
+         "completion posted in the ring");
+}
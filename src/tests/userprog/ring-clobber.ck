@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-clobber) begin
+(ring-clobber) ring_setup
+(ring-clobber) ring_enter with clobbered header
+(ring-clobber) kernel indexes restored
+(ring-clobber) completion posted in the ring
+(ring-clobber) end
+ring-clobber: exit(0)
+EOF
+pass;
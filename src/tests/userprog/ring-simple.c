@@ -0,0 +1,78 @@
+/* Opens, writes, reads back and closes a file through a
+   submission ring, with all requests but the open submitted in
+   a single ring_enter() call. */
+
+#include <ring.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (sizeof sample - 1)
+
+static char buf[SIZE];
+
+/* Queues a request in R. */
+static void
+submit (struct ring *r, enum ring_op op, int fd, void *buffer, size_t len,
+        unsigned user_data)
+{
+  struct ring_sqe *sqe = ring_next_sqe (r);
+
+  if (sqe == NULL)
+    fail ("submission queue full");
+  sqe->op = op;
+  sqe->flags = RING_F_OFFSET;
+  sqe->fd = fd;
+  sqe->buf = buffer;
+  sqe->len = len;
+  sqe->offset = 0;
+  sqe->user_data = user_data;
+  ring_push_sqe (r);
+}
+
+/* Returns the result of the next completion in R, which must be
+   for the request with USER_DATA. */
+static int
+complete (struct ring *r, unsigned user_data)
+{
+  struct ring_cqe *cqe = ring_peek_cqe (r);
+  int res;
+
+  if (cqe == NULL)
+    fail ("completion queue empty");
+  if (cqe->user_data != user_data)
+    fail ("completion for %u, expected %u", cqe->user_data, user_data);
+  res = cqe->res;
+  ring_pop_cqe (r);
+  return res;
+}
+
+void
+test_main (void) 
+{
+  struct ring *r = (struct ring *) 0x20000000;
+  int fd;
+
+  CHECK (create ("test.txt", SIZE), "create \"test.txt\"");
+  CHECK (ring_setup (r, 8, 0) == 0, "ring_setup");
+
+  submit (r, RING_OPEN, 0, "test.txt", 0, 1);
+  CHECK (ring_enter (1, 1) == 1, "ring_enter open");
+  CHECK ((fd = complete (r, 1)) > 1, "open \"test.txt\"");
+
+  submit (r, RING_WRITE, fd, sample, SIZE, 2);
+  submit (r, RING_READ, fd, buf, SIZE, 3);
+  submit (r, RING_FSYNC, fd, NULL, 0, 4);
+  submit (r, RING_CLOSE, fd, NULL, 0, 5);
+  CHECK (ring_enter (4, 4) == 4, "ring_enter write, read, fsync, close");
+  CHECK (complete (r, 2) == (int) SIZE, "write");
+  CHECK (complete (r, 3) == (int) SIZE, "read");
+  CHECK (complete (r, 4) == 0, "fsync");
+  CHECK (complete (r, 5) == 0, "close");
+  CHECK (ring_peek_cqe (r) == NULL, "completion queue empty");
+  if (memcmp (buf, sample, SIZE))
+    fail ("read data differs from data written");
+  check_file ("test.txt", sample, SIZE);
+}
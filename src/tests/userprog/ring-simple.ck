@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-simple) begin
+(ring-simple) create "test.txt"
+(ring-simple) ring_setup
+(ring-simple) ring_enter open
+(ring-simple) open "test.txt"
+(ring-simple) ring_enter write, read, fsync, close
+(ring-simple) write
+(ring-simple) read
+(ring-simple) fsync
+(ring-simple) close
+(ring-simple) completion queue empty
+(ring-simple) open "test.txt" for verification
+(ring-simple) verified contents of "test.txt"
+(ring-simple) close "test.txt"
+(ring-simple) end
+ring-simple: exit(0)
+EOF
+pass;
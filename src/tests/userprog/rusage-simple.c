@@ -0,0 +1,46 @@
+/* Checks that getrusage() counts the caller's system calls,
+   bytes moved through a pipe, and time in user mode, and that
+   the usage of a child shows up once it has been waited for. */
+
+#include <syscall.h>
+#include <time.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage before, after;
+  char buf[100];
+  int fds[2];
+  int64_t start;
+  pid_t pid;
+
+  CHECK (getrusage (RUSAGE_SELF, &before) == 0, "getrusage");
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (write (fds[1], buf, 10) == 10, "write 10 bytes");
+  CHECK (read (fds[0], buf, 10) == 10, "read 10 bytes");
+  getrusage (RUSAGE_SELF, &after);
+  CHECK (after.nsyscalls >= before.nsyscalls + 4, "system calls counted");
+  CHECK (after.write_bytes >= before.write_bytes + 10, "bytes written counted");
+  CHECK (after.read_bytes == before.read_bytes + 10, "bytes read counted");
+
+  start = clock_ticks ();
+  while (clock_ticks () < start + 5)
+    continue;
+  getrusage (RUSAGE_SELF, &after);
+  CHECK (after.utime > before.utime, "user time counted");
+
+  getrusage (RUSAGE_CHILDREN, &before);
+  pid = fork ();
+  if (pid == 0)
+    exit (write (fds[1], buf, sizeof buf) == sizeof buf ? 0 : 1);
+  CHECK (wait (pid) == 0, "wait for child");
+  getrusage (RUSAGE_CHILDREN, &after);
+  CHECK (after.write_bytes == before.write_bytes + sizeof buf,
+         "child's bytes written counted");
+  CHECK (after.nsyscalls >= before.nsyscalls + 2,
+         "child's system calls counted");
+
+  CHECK (getrusage (7, &after) == -1, "bad argument fails");
+}
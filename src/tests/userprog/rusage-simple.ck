@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rusage-simple) begin
+(rusage-simple) getrusage
+(rusage-simple) pipe
+(rusage-simple) write 10 bytes
+(rusage-simple) read 10 bytes
+(rusage-simple) system calls counted
+(rusage-simple) bytes written counted
+(rusage-simple) bytes read counted
+(rusage-simple) user time counted
+(rusage-simple) wait for child
+(rusage-simple) child's bytes written counted
+(rusage-simple) child's system calls counted
+(rusage-simple) bad argument fails
+(rusage-simple) end
+EOF
+pass;
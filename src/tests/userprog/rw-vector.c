@@ -0,0 +1,56 @@
+/* Writes sample.txt's contents to a new file with writev(),
+   in three pieces, and reads them back with readv() and with
+   pread() and pwrite(), which must not move the file
+   position. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (sizeof sample - 1)
+
+void
+test_main (void) 
+{
+  char buf[SIZE];
+  struct iovec iov[3];
+  int handle;
+
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 10;
+  iov[1].iov_base = sample + 10;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = sample + 10;
+  iov[2].iov_len = SIZE - 10;
+  CHECK (writev (handle, iov, 3) == (int) SIZE, "writev");
+  check_file ("test.txt", sample, SIZE);
+
+  seek (handle, 0);
+  memset (buf, 0, sizeof buf);
+  iov[0].iov_base = buf + SIZE - 7;
+  iov[0].iov_len = 7;
+  iov[1].iov_base = buf;
+  iov[1].iov_len = SIZE - 7;
+  CHECK (readv (handle, iov, 2) == (int) SIZE, "readv");
+  if (memcmp (buf + SIZE - 7, sample, 7)
+      || memcmp (buf, sample + 7, SIZE - 7))
+    fail ("readv read wrong data");
+
+  seek (handle, 3);
+  CHECK (pread (handle, buf, 20, SIZE - 20) == 20, "pread");
+  if (memcmp (buf, sample + SIZE - 20, 20))
+    fail ("pread read wrong data");
+  CHECK (pread (handle, buf, 20, SIZE + 5) == 0, "pread past end of file");
+  CHECK (pwrite (handle, "ABC", 3, 0) == 3, "pwrite");
+  CHECK (tell (handle) == 3, "tell");
+  CHECK (read (handle, buf, 3) == 3, "read");
+  if (memcmp (buf, sample + 3, 3))
+    fail ("read read wrong data");
+  CHECK (pread (handle, buf, 3, 0) == 3 && !memcmp (buf, "ABC", 3),
+         "pread after pwrite");
+}
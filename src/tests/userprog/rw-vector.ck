@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rw-vector) begin
+(rw-vector) create "test.txt"
+(rw-vector) open "test.txt"
+(rw-vector) writev
+(rw-vector) open "test.txt" for verification
+(rw-vector) verified contents of "test.txt"
+(rw-vector) close "test.txt"
+(rw-vector) readv
+(rw-vector) pread
+(rw-vector) pread past end of file
+(rw-vector) pwrite
+(rw-vector) tell
+(rw-vector) read
+(rw-vector) pread after pwrite
+(rw-vector) end
+rw-vector: exit(0)
+EOF
+pass;
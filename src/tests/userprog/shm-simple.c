@@ -0,0 +1,47 @@
+/* Maps a shared memory segment, forks a child that writes into
+   it and maps it a second time, and checks that the parent sees
+   the child's writes.  Also checks that a segment cannot be
+   mapped over pages in use and that an unlinked name is gone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE 8192
+#define ADDR ((char *) 0x10000000)
+#define ADDR2 ((char *) 0x10100000)
+#define HALF (SIZE / 2)
+
+void
+test_main (void) 
+{
+  int shmid;
+  pid_t pid;
+
+  CHECK ((shmid = shm_open ("test-seg", SIZE)) >= 0, "shm_open");
+  CHECK (shm_map (shmid, ADDR) == ADDR, "shm_map");
+  CHECK (ADDR[0] == 0 && ADDR[SIZE - 1] == 0, "segment starts zeroed");
+  strlcpy (ADDR, "parent", SIZE);
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      if (shm_map (shm_open ("test-seg", 0), ADDR2) != ADDR2)
+        exit (1);
+      if (strcmp (ADDR2, "parent"))
+        exit (2);
+      strlcpy (ADDR + HALF, "child", HALF);
+      exit (ADDR2[HALF] == 'c' ? 0 : 3);
+    }
+  CHECK (wait (pid) == 0, "child saw the parent's data");
+  CHECK (!strcmp (ADDR + HALF, "child"), "parent sees the child's data");
+
+  CHECK (shm_map (shmid, (void *) 0x08048000) == NULL,
+         "shm_map over code fails");
+  CHECK (shm_unlink ("test-seg"), "shm_unlink");
+  CHECK (shm_open ("test-seg", 0) == -1, "unlinked segment is gone");
+  CHECK (!strcmp (ADDR, "parent"), "mapping outlives the name");
+  CHECK (shm_unmap (ADDR), "shm_unmap");
+  CHECK (!shm_unmap (ADDR), "second shm_unmap fails");
+}
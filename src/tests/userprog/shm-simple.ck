@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(shm-simple) begin
+(shm-simple) shm_open
+(shm-simple) shm_map
+(shm-simple) segment starts zeroed
+(shm-simple) child saw the parent's data
+(shm-simple) parent sees the child's data
+(shm-simple) shm_map over code fails
+(shm-simple) shm_unlink
+(shm-simple) unlinked segment is gone
+(shm-simple) mapping outlives the name
+(shm-simple) shm_unmap
+(shm-simple) second shm_unmap fails
+(shm-simple) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* Spawns a copy of itself with 2,000 arguments, about 100 kB of
+   them in all, far more than fit in a page, and has the copy
+   check that they all arrived intact. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define ARG_CNT 2000
+#define ARG_LEN 50
+
+static char args[ARG_CNT][ARG_LEN + 1];
+static char *child_argv[ARG_CNT + 2];
+
+/* Fills in argument I, counting from 1. */
+static void
+make_arg (char arg[ARG_LEN + 1], int i)
+{
+  memset (arg, 'a' + i % 26, ARG_LEN);
+  arg[ARG_LEN] = '\0';
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  int i;
+
+  test_name = "spawn-args";
+
+  if (argc > 1)
+    {
+      char expected[ARG_LEN + 1];
+
+      if (argc != ARG_CNT + 1 || argv[argc] != NULL)
+        fail ("child got %d arguments", argc - 1);
+      for (i = 1; i < argc; i++)
+        {
+          make_arg (expected, i);
+          if (strcmp (argv[i], expected))
+            fail ("argument %d is wrong", i);
+        }
+      msg ("child got %d arguments", argc - 1);
+      return 0;
+    }
+
+  msg ("begin");
+  child_argv[0] = "spawn-args";
+  for (i = 1; i <= ARG_CNT; i++)
+    {
+      make_arg (args[i - 1], i);
+      child_argv[i] = args[i - 1];
+    }
+  child_argv[ARG_CNT + 1] = NULL;
+  msg ("wait(spawn()) = %d",
+       wait (spawn ("spawn-args", child_argv, NULL, 0)));
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-args) begin
+(spawn-args) child got 2000 arguments
+spawn-args: exit(0)
+(spawn-args) wait(spawn()) = 0
+(spawn-args) end
+spawn-args: exit(0)
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Starts child-simple with spawn(), first as is and then with
+   its standard output redirected into a file, and checks that
+   spawning a missing program fails in the child. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char *child_argv[] = {"child-simple", NULL};
+static char *missing_argv[] = {"no-such-file", NULL};
+
+void
+test_main (void) 
+{
+  static const char expected[] = "(child-simple) run\n";
+  struct spawn_action action;
+  char buf[sizeof expected - 1];
+  int handle;
+
+  msg ("wait(spawn()) = %d",
+       wait (spawn ("child-simple", child_argv, NULL, 0)));
+
+  CHECK (create ("out.txt", sizeof buf), "create \"out.txt\"");
+  CHECK ((handle = open ("out.txt")) > 1, "open \"out.txt\"");
+  action.op = SPAWN_DUP2;
+  action.fd = handle;
+  action.new_fd = STDOUT_FILENO;
+  msg ("wait(spawn()) with redirected output = %d",
+       wait (spawn ("child-simple", child_argv, &action, 1)));
+  seek (handle, 0);
+  if (read (handle, buf, sizeof buf) != sizeof buf
+      || memcmp (buf, expected, sizeof buf))
+    fail ("child's output did not go to \"out.txt\"");
+  msg ("output redirected into \"out.txt\"");
+  close (handle);
+
+  msg ("wait(spawn(\"no-such-file\")) = %d",
+       wait (spawn ("no-such-file", missing_argv, NULL, 0)));
+
+  action.fd = 99;
+  CHECK (spawn ("child-simple", child_argv, &action, 1) == PID_ERROR,
+         "spawn() with bad action fails");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-simple) begin
+(child-simple) run
+child-simple: exit(81)
+(spawn-simple) wait(spawn()) = 81
+(spawn-simple) create "out.txt"
+(spawn-simple) open "out.txt"
+child-simple: exit(81)
+(spawn-simple) wait(spawn()) with redirected output = 81
+(spawn-simple) output redirected into "out.txt"
+load: no-such-file: open failed
+no-such-file: exit(-1)
+(spawn-simple) wait(spawn("no-such-file")) = -1
+(spawn-simple) spawn() with bad action fails
+(spawn-simple) end
+spawn-simple: exit(0)
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Checks when stdout's buffer reaches the console, by
+   interleaving printf() with write() calls that bypass it. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void
+direct (const char *s)
+{
+  write (STDOUT_FILENO, s, strlen (s));
+}
+
+void
+test_main (void) 
+{
+  /* Line buffered: held until the new-line. */
+  printf ("(stdio-buffer) held");
+  direct ("(stdio-buffer) direct\n");
+  printf (" until new-line\n");
+
+  /* Unbuffered: written at the end of each call. */
+  setvbuf (stdout, NULL, _IONBF, 0);
+  printf ("(stdio-buffer) unbuffered");
+  direct (" write\n");
+
+  /* stderr flushes stdout first. */
+  setvbuf (stdout, NULL, _IOLBF, 0);
+  printf ("(stdio-buffer) stdout, then ");
+  fputs ("stderr\n", stderr);
+
+  /* Fully buffered: held past new-lines, until fflush(). */
+  setvbuf (stdout, NULL, _IOFBF, 0);
+  puts ("(stdio-buffer) flushed");
+  direct ("(stdio-buffer) before fflush\n");
+  fflush (stdout);
+
+  /* Written by exit(), after main() returns. */
+  printf ("(stdio-buffer) flushed at exit\n");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stdio-buffer) begin
+(stdio-buffer) direct
+(stdio-buffer) held until new-line
+(stdio-buffer) unbuffered write
+(stdio-buffer) stdout, then stderr
+(stdio-buffer) before fflush
+(stdio-buffer) flushed
+(stdio-buffer) end
+(stdio-buffer) flushed at exit
+stdio-buffer: exit(0)
+EOF
+pass;
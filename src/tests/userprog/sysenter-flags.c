@@ -0,0 +1,61 @@
+/* Enters the kernel with SYSENTER with NT set, which must not
+   survive into the kernel, and then, in a child process, with TF
+   set, which makes the CPU trap on the first instruction of the
+   kernel's entry stub.  The kernel must survive both, and the
+   child must die of the trap it asked for once it is back in
+   user mode.  Does nothing interesting on a CPU without
+   SYSENTER. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FLAG_TF 0x00000100
+#define FLAG_NT 0x00004000
+
+/* Calls getpid() through SYSENTER with FLAGS set in EFLAGS.  The
+   POPFL just before SYSENTER sets the flags, so that a TF trap
+   comes only after SYSENTER. */
+#define SYSENTER_GETPID(FLAGS)                                  \
+        ({                                                      \
+          int retval, ecx, edx;                                 \
+          asm volatile                                          \
+            ("pushl %[number]; "                                \
+             "movl %%esp, %%ecx; movl $1f, %%edx; "             \
+             "pushfl; orl %[flags], (%%esp); popfl; "           \
+             "sysenter; 1: addl $4, %%esp"                      \
+               : "=a" (retval), "=c" (ecx), "=d" (edx)          \
+               : [number] "i" (SYS_GETPID), [flags] "i" (FLAGS) \
+               : "memory", "cc");                               \
+          retval;                                               \
+        })
+
+/* Returns true if the CPU supports SYSENTER. */
+static bool
+has_sysenter (void)
+{
+  unsigned eax = 1, ebx, ecx, edx;
+
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return (edx & 0x800) != 0;
+}
+
+void
+test_main (void) 
+{
+  bool sep = has_sysenter ();
+  pid_t pid;
+
+  CHECK (!sep || SYSENTER_GETPID (FLAG_NT) == getpid (),
+         "getpid with NT set");
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      if (sep)
+        SYSENTER_GETPID (FLAG_TF);
+      exit (-1);
+    }
+  CHECK (wait (pid) == -1, "child with TF set dies in user mode");
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The child's debug trap is reported with a register dump.
+@output = grep (!/: dying due to interrupt 0x01 \(.*\).$/
+		&& !/^Interrupt 0x01 \(.*\) at eip=/
+		&& !/^ cr2=.* error=.*/
+		&& !/^ eax=.* ebx=.* ecx=.* edx=.*/
+		&& !/^ esi=.* edi=.* esp=.* ebp=.*/
+		&& !/^ cs=.* ds=.* es=.* ss=.*/, @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(sysenter-flags) begin
+(sysenter-flags) getpid with NT set
+(sysenter-flags) child with TF set dies in user mode
+(sysenter-flags) end
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Forks a child that calls exit() while one of its threads spins
+   in user mode and another is blocked reading from an empty pipe
+   whose write end is still open.  Both threads must give up, so
+   that the child ends with exit()'s status. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int fds[2];
+static volatile bool spinner_started, reader_started;
+static volatile bool spinning = true;
+
+static int
+spinner (void *aux UNUSED)
+{
+  spinner_started = true;
+  while (spinning)
+    continue;
+  return 0;
+}
+
+static int
+reader (void *aux UNUSED)
+{
+  char byte;
+
+  reader_started = true;
+  read (fds[0], &byte, 1);
+  return 0;
+}
+
+void
+test_main (void) 
+{
+  pid_t pid;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  pid = fork ();
+  if (pid == 0)
+    {
+      if (thread_create (spinner, NULL) == TID_ERROR
+          || thread_create (reader, NULL) == TID_ERROR)
+        exit (-1);
+      while (!spinner_started || !reader_started)
+        continue;
+
+      /* Give the reader time to block. */
+      poll (NULL, 0, 100);
+      exit (57);
+    }
+  msg ("wait(fork()) = %d", wait (pid));
+}
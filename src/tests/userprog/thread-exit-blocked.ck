@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-exit-blocked) begin
+(thread-exit-blocked) pipe
+thread-exit-blocked: exit(57)
+(thread-exit-blocked) wait(fork()) = 57
+(thread-exit-blocked) end
+thread-exit-blocked: exit(0)
+EOF
+pass;
@@ -0,0 +1,69 @@
+/* Starts several threads in one process, which share its memory
+   and its file descriptors but have stacks of their own, and
+   joins them. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITERATIONS 1000
+
+static struct mutex mutex = MUTEX_INITIALIZER;
+static struct cond cond = COND_INITIALIZER;
+static int counter;
+static int started;
+static int fd;
+static void *stacks[THREAD_CNT];
+
+static int
+worker (void *aux)
+{
+  int id = (int) aux;
+  char byte;
+  int i;
+
+  stacks[id] = &byte;
+  mutex_lock (&mutex);
+  started++;
+  cond_signal (&cond);
+  mutex_unlock (&mutex);
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      mutex_lock (&mutex);
+      counter++;
+      mutex_unlock (&mutex);
+    }
+  return read (fd, &byte, 1) == 1 ? id * 10 : -1;
+}
+
+void
+test_main (void) 
+{
+  tid_t tids[THREAD_CNT];
+  int i, j;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_create (worker, (void *) i)) != TID_ERROR,
+           "create thread %d", i);
+
+  mutex_lock (&mutex);
+  while (started < THREAD_CNT)
+    cond_wait (&cond, &mutex);
+  mutex_unlock (&mutex);
+  msg ("all threads started");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (thread_join (tids[i]) == i * 10, "join thread %d", i);
+  CHECK (thread_join (tids[0]) == -1, "join thread 0 again");
+  CHECK (counter == THREAD_CNT * ITERATIONS, "counter is %d", counter);
+  CHECK (tell (fd) == THREAD_CNT, "threads share the file position");
+  for (i = 0; i < THREAD_CNT; i++)
+    for (j = 0; j < i; j++)
+      if (stacks[i] == stacks[j])
+        fail ("threads %d and %d share a stack", j, i);
+  CHECK (getpid () != tids[0], "threads are not processes");
+}
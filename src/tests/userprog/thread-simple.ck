@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-simple) begin
+(thread-simple) open "sample.txt"
+(thread-simple) create thread 0
+(thread-simple) create thread 1
+(thread-simple) create thread 2
+(thread-simple) create thread 3
+(thread-simple) all threads started
+(thread-simple) join thread 0
+(thread-simple) join thread 1
+(thread-simple) join thread 2
+(thread-simple) join thread 3
+(thread-simple) join thread 0 again
+(thread-simple) counter is 4000
+(thread-simple) threads share the file position
+(thread-simple) threads are not processes
+(thread-simple) end
+thread-simple: exit(0)
+EOF
+pass;
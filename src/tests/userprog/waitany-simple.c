@@ -0,0 +1,49 @@
+/* Forks several children that exit with different statuses, then
+   reaps them all with waitany(), checking that each child turns
+   up exactly once with its own status, that waitany() fails once
+   none are left, and that wait() no longer finds a reaped
+   child. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+
+void
+test_main (void) 
+{
+  pid_t pids[CHILD_CNT];
+  bool reaped[CHILD_CNT];
+  int i, j;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pids[i] = fork ();
+      if (pids[i] == 0)
+        exit (10 + i);
+      CHECK (pids[i] != PID_ERROR, "fork child %d", i);
+      reaped[i] = false;
+    }
+
+  for (j = 0; j < CHILD_CNT; j++)
+    {
+      int status = -1;
+      pid_t pid = waitany (&status);
+
+      for (i = 0; i < CHILD_CNT; i++)
+        if (pids[i] == pid)
+          break;
+      if (i >= CHILD_CNT)
+        fail ("waitany() returned unknown pid %d", pid);
+      if (reaped[i])
+        fail ("waitany() returned child %d twice", i);
+      if (status != 10 + i)
+        fail ("child %d exited with %d, expected %d", i, status, 10 + i);
+      reaped[i] = true;
+    }
+  msg ("reaped all children");
+
+  CHECK (waitany (NULL) == PID_ERROR, "waitany() with no children fails");
+  CHECK (wait (pids[0]) == -1, "wait() for a reaped child fails");
+}
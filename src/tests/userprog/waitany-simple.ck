@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(waitany-simple) begin
+(waitany-simple) fork child 0
+(waitany-simple) fork child 1
+(waitany-simple) fork child 2
+(waitany-simple) fork child 3
+(waitany-simple) reaped all children
+(waitany-simple) waitany() with no children fails
+(waitany-simple) wait() for a reaped child fails
+(waitany-simple) end
+EOF
+pass;
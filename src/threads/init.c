@@ -17,6 +17,7 @@
 #include "devices/rtc.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/kprofile.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
@@ -26,11 +27,17 @@
 #include "userprog/process.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
+#include "userprog/profile.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
 #include "tests/threads/tests.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
@@ -57,8 +64,17 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -kprofile: Number of kernel profile samples to keep, or 0 to
+   not profile the kernel. */
+static size_t kprofile_samples;
+
+/* Global page support.  See [IA32-v3a] 2.5 "Control Registers". */
+#define CR4_PGE 0x00000080   /* CR4: Page Global Enable. */
+#define CPUID_PGE 0x00002000 /* CPUID.1:EDX: Global pages supported. */
+
 static void bss_init(void);
 static void paging_init(void);
+static bool cpu_has_pge(void);
 
 static char **read_command_line(void);
 static char **parse_options(char **argv);
@@ -97,6 +113,9 @@ int main(void)
   palloc_init(user_page_limit);
   malloc_init();
   paging_init();
+#ifdef VM
+  frame_init();
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -107,10 +126,13 @@ int main(void)
   /* Initialize interrupt handlers. */
   intr_init();
   timer_init();
+  if (kprofile_samples > 0)
+    kprofile_init(kprofile_samples);
   kbd_init();
   input_init();
 #ifdef USERPROG
   exception_init();
+  process_init();
   syscall_init();
 #endif
 
@@ -126,6 +148,11 @@ int main(void)
   filesys_init(format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize swap, which may use the swap block device. */
+  swap_init();
+#endif
+
   printf("Boot complete.\n");
 
   /* Run actions specified on kernel command line. */
@@ -176,7 +203,7 @@ paging_init(void)
       pd[pde_idx] = pde_create(pt);
     }
 
-    pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text);
+    pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text) | PTE_G;
   }
 
   /* Store the physical address of the page directory into CR3
@@ -187,6 +214,29 @@ paging_init(void)
   asm volatile("movl %0, %%cr3"
                :
                : "r"(vtop(init_page_dir)));
+
+  /* The kernel mapping is the same in every page directory, so
+     if the CPU supports global pages, have its TLB entries
+     survive CR3 loads on process switches.  The PTE_G bits set
+     above are ignored otherwise.  See [IA32-v3a] 3.12 "Global
+     Pages". */
+  if (cpu_has_pge())
+  {
+    uint32_t cr4;
+    asm volatile("movl %%cr4, %0" : "=r"(cr4));
+    asm volatile("movl %0, %%cr4" : : "r"(cr4 | CR4_PGE) : "memory");
+  }
+}
+
+/* Returns true if the CPU supports global pages, according to
+   CPUID.  See [IA32-v2a] "CPUID--CPU Identification". */
+static bool
+cpu_has_pge(void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+
+  asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+  return (edx & CPUID_PGE) != 0;
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -257,9 +307,27 @@ parse_options(char **argv)
       random_init(atoi(value));
     else if (!strcmp(name, "-mlfqs"))
       thread_mlfqs = true;
+    else if (!strcmp(name, "-kprofile"))
+      kprofile_samples = value != NULL && atoi(value) > 0
+                             ? (size_t)atoi(value)
+                             : KPROFILE_DEFAULT_SAMPLES;
 #ifdef USERPROG
     else if (!strcmp(name, "-ul"))
       user_page_limit = atoi(value);
+    else if (!strcmp(name, "-rusage"))
+      process_print_rusage = true;
+    else if (!strcmp(name, "-profile"))
+      profile_user = true;
+#endif
+#ifdef VM
+    else if (!strcmp(name, "-fault-around"))
+      page_fault_around = atoi(value) > 0 ? atoi(value) : 1;
+    else if (!strcmp(name, "-readahead"))
+      page_readahead_max = atoi(value) > 0 ? atoi(value) : 1;
+    else if (!strcmp(name, "-swap-pool"))
+      swap_pool_pages = atoi(value);
+    else if (!strcmp(name, "-stack"))
+      page_stack_max = atoi(value) > 0 ? atoi(value) : 1;
 #endif
     else
       PANIC("unknown option `%s' (use -h for help)", name);
@@ -379,8 +447,18 @@ usage(void)
 #endif
          "  -rs=SEED           Set random number seed to SEED.\n"
          "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+         "  -kprofile[=N]      Sample the kernel, printing the last N samples\n"
+         "                     at power off.\n"
 #ifdef USERPROG
          "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+         "  -rusage            Print each process's resource usage at exit.\n"
+         "  -profile           Sample user eips, writing prof-PID at exit.\n"
+#endif
+#ifdef VM
+         "  -fault-around=N    Map N pages around each page fault.\n"
+         "  -readahead=N       Read up to N pages ahead of sequential faults.\n"
+         "  -swap-pool=N       Keep up to N pages of compressed swap in memory.\n"
+         "  -stack=N           Limit user stacks to N pages.\n"
 #endif
   );
   shutdown_power_off();
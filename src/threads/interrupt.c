@@ -384,6 +384,14 @@ void intr_handler(struct intr_frame *frame)
     if (yield_on_return)
       thread_yield();
   }
+
+  /* An interrupted thread exits instead of returning to user
+     mode.  See thread_interrupt(). */
+  if ((frame->cs & 3) == 3 && thread_current()->interrupted)
+  {
+    intr_enable();
+    thread_exit();
+  }
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -0,0 +1,127 @@
+#include "threads/kprofile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Sampling profile of the kernel.
+
+   With "-kprofile", the timer interrupt records the kernel eip
+   that it interrupted, along with the return addresses of up to
+   KPROFILE_DEPTH - 1 of its callers, found by following the
+   saved frame pointers.  Samples go into a ring buffer, which
+   keeps the most recent ones once it fills.  There is only one
+   CPU, so one buffer suffices.
+
+   At power off, kprofile_print() prints the samples, oldest
+   first, one per line:
+
+        kprofile: EIP CALLER CALLER...
+
+   utils/pintos-kprof turns these lines, taken from the kernel's
+   output, into folded stacks for flame graphs. */
+
+/* One sample: the interrupted eip, then return addresses from
+   the innermost caller outward, ending early at a null. */
+struct sample
+  {
+    uintptr_t pcs[KPROFILE_DEPTH];
+  };
+
+static struct sample *samples;  /* Ring buffer, or null if off. */
+static size_t sample_cnt;       /* Size of `samples'. */
+static size_t page_cnt;         /* Pages in `samples'. */
+static size_t head;             /* Next sample to fill in. */
+static uint64_t taken;          /* Samples taken in all. */
+
+/* Starts sampling the kernel, keeping the last SAMPLE_CNT
+   samples. */
+void
+kprofile_init (size_t sample_cnt_)
+{
+  ASSERT (sample_cnt_ > 0);
+
+  page_cnt = DIV_ROUND_UP (sample_cnt_ * sizeof *samples, PGSIZE);
+  samples = palloc_get_multiple (PAL_ZERO, page_cnt);
+  if (samples == NULL)
+    {
+      printf ("kprofile: no memory for %zu samples, not profiling\n",
+              sample_cnt_);
+      return;
+    }
+  sample_cnt = sample_cnt_;
+}
+
+/* Records a sample of the kernel code that F interrupted, if the
+   kernel profile is on and F interrupted the kernel.  Called
+   from the timer interrupt.
+
+   The interrupted code ran on the same kernel stack as this
+   handler, so the chain of frame pointers is followed only
+   while it stays within that stack's page, and only upward. */
+void
+kprofile_sample (const struct intr_frame *f)
+{
+  struct sample *s;
+  uint8_t *stack = pg_round_down (f);
+  uint32_t *fp;
+  int i;
+
+  if (samples == NULL || (f->cs & 3) != 0)
+    return;
+
+  s = &samples[head];
+  head = (head + 1) % sample_cnt;
+  taken++;
+  s->pcs[0] = (uintptr_t) f->eip;
+  fp = (uint32_t *) f->ebp;
+  for (i = 1; i < KPROFILE_DEPTH; i++)
+    {
+      uint32_t *next;
+
+      if ((uint8_t *) fp < stack || (uint8_t *) (fp + 2) > stack + PGSIZE
+          || fp[1] == 0)
+        break;
+      s->pcs[i] = fp[1];
+      next = (uint32_t *) fp[0];
+      if (next <= fp)
+        {
+          i++;
+          break;
+        }
+      fp = next;
+    }
+  for (; i < KPROFILE_DEPTH; i++)
+    s->pcs[i] = 0;
+}
+
+/* Prints the samples in the ring buffer, oldest first. */
+void
+kprofile_print (void)
+{
+  size_t first, cnt, i;
+
+  if (samples == NULL)
+    return;
+
+  /* Once the buffer has filled, the oldest sample is the one
+     that would be overwritten next. */
+  first = taken > sample_cnt ? head : 0;
+  cnt = taken > sample_cnt ? sample_cnt : taken;
+  printf ("kprofile: %"PRIu64" samples, %"PRIu64" overwritten\n",
+          taken, taken - cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      const struct sample *s = &samples[(first + i) % sample_cnt];
+      int j;
+
+      printf ("kprofile:");
+      for (j = 0; j < KPROFILE_DEPTH && s->pcs[j] != 0; j++)
+        printf (" %#"PRIxPTR, s->pcs[j]);
+      printf ("\n");
+    }
+}
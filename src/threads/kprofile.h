@@ -0,0 +1,19 @@
+#ifndef THREADS_KPROFILE_H
+#define THREADS_KPROFILE_H
+
+#include <stddef.h>
+
+struct intr_frame;
+
+/* Samples kept by "-kprofile" without a count. */
+#define KPROFILE_DEFAULT_SAMPLES 2048
+
+/* Return addresses recorded per sample, including the
+   interrupted eip. */
+#define KPROFILE_DEPTH 8
+
+void kprofile_init (size_t sample_cnt);
+void kprofile_sample (const struct intr_frame *);
+void kprofile_print (void);
+
+#endif /* threads/kprofile.h */
@@ -0,0 +1,171 @@
+#include "threads/pollq.h"
+#include <debug.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Pollers waiting with a deadline, soonest first. */
+static struct list timed_pollers = LIST_INITIALIZER (timed_pollers);
+
+static list_less_func deadline_less;
+
+/* Initializes Q as an empty poll queue. */
+void
+pollq_init (struct pollq *q)
+{
+  list_init (&q->entries);
+}
+
+/* Wakes up the pollers watching Q's object, which may have
+   become ready.  May be called from an interrupt handler. */
+void
+pollq_wake (struct pollq *q)
+{
+  enum intr_level old_level = intr_disable ();
+  struct list_elem *e;
+
+  for (e = list_begin (&q->entries); e != list_end (&q->entries);
+       e = list_next (e))
+    {
+      struct poll_entry *pe = list_entry (e, struct poll_entry, queue_elem);
+      struct poller *p = pe->poller;
+
+      if (!pe->ready)
+        {
+          pe->ready = true;
+          list_push_back (&p->ready, &pe->ready_elem);
+        }
+      if (p->waiter != NULL)
+        {
+          thread_unblock (p->waiter);
+          p->waiter = NULL;
+        }
+    }
+  intr_set_level (old_level);
+}
+
+/* Initializes P as a poller for the running thread, watching
+   nothing. */
+void
+poller_init (struct poller *p)
+{
+  p->waiter = NULL;
+  list_init (&p->ready);
+  p->deadline = -1;
+}
+
+/* Adds E to P, watching the object whose poll queue is Q.  Q may
+   be null for an object that is always ready, in which case E
+   never becomes ready by itself.  The caller should check the
+   object's state after adding E, so that a change that races
+   with the check still wakes P. */
+void
+poller_add (struct poller *p, struct poll_entry *e, struct pollq *q)
+{
+  enum intr_level old_level;
+
+  e->poller = p;
+  e->queue = q;
+  e->ready = false;
+  if (q == NULL)
+    return;
+  old_level = intr_disable ();
+  list_push_back (&q->entries, &e->queue_elem);
+  intr_set_level (old_level);
+}
+
+/* Removes E from its poller and from its object's queue. */
+void
+poller_remove (struct poll_entry *e)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (e->queue != NULL)
+    list_remove (&e->queue_elem);
+  if (e->ready)
+    list_remove (&e->ready_elem);
+  e->queue = NULL;
+  e->ready = false;
+  intr_set_level (old_level);
+}
+
+/* Takes the next entry off P's ready list and returns it.  If
+   the list is empty, waits for an entry to become ready until
+   timer tick DEADLINE, or forever if DEADLINE is negative, and
+   returns a null pointer if DEADLINE passes first or the running
+   thread is interrupted by thread_interrupt().  A DEADLINE that
+   has already passed does not wait at all. */
+struct poll_entry *
+poller_wait (struct poller *p, int64_t deadline)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  struct poll_entry *e = NULL;
+
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  while (list_empty (&p->ready))
+    {
+      if (cur->interrupted)
+        break;
+      if (deadline >= 0)
+        {
+          if (timer_ticks () >= deadline)
+            break;
+          p->deadline = deadline;
+          list_insert_ordered (&timed_pollers, &p->timer_elem,
+                               deadline_less, NULL);
+        }
+      p->waiter = cur;
+      cur->sleep_poller = p;
+      thread_block ();
+      cur->sleep_poller = NULL;
+      if (p->deadline >= 0)
+        {
+          list_remove (&p->timer_elem);
+          p->deadline = -1;
+        }
+    }
+  if (!list_empty (&p->ready))
+    {
+      e = list_entry (list_pop_front (&p->ready),
+                      struct poll_entry, ready_elem);
+      e->ready = false;
+    }
+  intr_set_level (old_level);
+  return e;
+}
+
+/* Wakes up the pollers whose deadlines have come by timer tick
+   NOW.  Called by the timer interrupt handler. */
+void
+poller_tick (int64_t now)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&timed_pollers))
+    {
+      struct poller *p = list_entry (list_front (&timed_pollers),
+                                     struct poller, timer_elem);
+      if (p->deadline > now)
+        break;
+      list_pop_front (&timed_pollers);
+      p->deadline = -1;
+      if (p->waiter != NULL)
+        {
+          thread_unblock (p->waiter);
+          p->waiter = NULL;
+        }
+    }
+}
+
+/* Returns true if the poller containing A has an earlier
+   deadline than the one containing B. */
+static bool
+deadline_less (const struct list_elem *a, const struct list_elem *b,
+               void *aux UNUSED)
+{
+  return (list_entry (a, struct poller, timer_elem)->deadline
+          < list_entry (b, struct poller, timer_elem)->deadline);
+}
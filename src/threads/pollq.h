@@ -0,0 +1,56 @@
+#ifndef THREADS_POLLQ_H
+#define THREADS_POLLQ_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Poll queues.
+
+   An object that a thread may watch along with others in poll(),
+   such as a pipe or the keyboard's input queue, has a poll queue,
+   which it wakes with pollq_wake() whenever it may have become
+   ready.  A thread that polls has a poller, and adds one entry
+   per object it watches to that object's queue.  Waking a queue
+   moves its entries onto their pollers' ready lists, so that a
+   woken poller need look again only at the objects that changed,
+   not at every one it watches.
+
+   Queues may be woken by interrupt handlers, so they are
+   protected by turning interrupts off, not by locks. */
+
+/* An object's queue of poll entries. */
+struct pollq
+  {
+    struct list entries;        /* Entries watching the object. */
+  };
+
+/* A thread waiting for any of several objects. */
+struct poller
+  {
+    struct thread *waiter;      /* Sleeping thread, or null. */
+    struct list ready;          /* Entries whose objects changed. */
+    int64_t deadline;           /* Tick to wake up at, or -1. */
+    struct list_elem timer_elem; /* Element in list of timed pollers. */
+  };
+
+/* One object watched by a poller. */
+struct poll_entry
+  {
+    struct poller *poller;      /* Owner. */
+    struct pollq *queue;        /* Object's queue, or null. */
+    bool ready;                 /* On the poller's ready list? */
+    struct list_elem queue_elem; /* Element in `queue'. */
+    struct list_elem ready_elem; /* Element in poller's `ready'. */
+  };
+
+void pollq_init (struct pollq *);
+void pollq_wake (struct pollq *);
+
+void poller_init (struct poller *);
+void poller_add (struct poller *, struct poll_entry *, struct pollq *);
+void poller_remove (struct poll_entry *);
+struct poll_entry *poller_wait (struct poller *, int64_t deadline);
+void poller_tick (int64_t now);
+
+#endif /* threads/pollq.h */
@@ -77,6 +77,40 @@ void sema_down(struct semaphore *sema)
   intr_set_level(old_level);
 }
 
+/* Like sema_down(), but gives up if the running thread is
+   interrupted by thread_interrupt(), before or while it waits.
+   Returns true if SEMA was decremented, false if the thread was
+   interrupted first. */
+bool sema_down_interruptible(struct semaphore *sema)
+{
+  enum intr_level old_level;
+  bool success = true;
+
+  ASSERT(sema != NULL);
+  ASSERT(!intr_context());
+
+  struct thread *current = thread_current();
+
+  old_level = intr_disable();
+  while (sema->value == 0)
+  {
+    if (current->interrupted)
+    {
+      success = false;
+      break;
+    }
+    /* thread_interrupt() takes us off the list to wake us. */
+    list_push_back(&sema->waiters, &current->wait_elem);
+    current->sleep_sema = sema;
+    thread_block();
+    current->sleep_sema = NULL;
+  }
+  if (success)
+    sema->value--;
+  intr_set_level(old_level);
+  return success;
+}
+
 /* Down or "P" operation on a semaphore, but only if the
    semaphore is not already 0.  Returns true if the semaphore is
    decremented, false otherwise.
@@ -403,6 +437,40 @@ void cond_wait(struct condition *cond, struct lock *lock)
   lock_acquire(lock);
 }
 
+/* Like cond_wait(), but gives up if the running thread is
+   interrupted by thread_interrupt().  Either way, LOCK is held
+   again on return.  Returns true if COND was signaled, false if
+   the thread was interrupted first. */
+bool cond_wait_interruptible(struct condition *cond, struct lock *lock)
+{
+  struct semaphore_elem waiter;
+
+  ASSERT(cond != NULL);
+  ASSERT(lock != NULL);
+  ASSERT(!intr_context());
+  ASSERT(lock_held_by_current_thread(lock));
+
+  sema_init(&waiter.semaphore, 0);
+  waiter.t = thread_current();
+  list_push_back(&cond->waiters, &waiter.elem);
+  lock_release(lock);
+  if (sema_down_interruptible(&waiter.semaphore))
+  {
+    lock_acquire(lock);
+    return true;
+  }
+  lock_acquire(lock);
+
+  /* cond_signal() takes a waiter off the list before upping its
+     semaphore, so a waiter not yet upped is still on it. */
+  if (waiter.semaphore.value == 0)
+  {
+    list_remove(&waiter.elem);
+    return false;
+  }
+  return true;
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
    this function signals one of them to wake up from its wait.
    LOCK must be held before calling this function.
@@ -1,6 +1,7 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <barrier.h>
 #include <list.h>
 #include <stdbool.h>
 #include "fixed_point.h"
@@ -16,6 +17,7 @@ struct semaphore
 
 void sema_init(struct semaphore *, unsigned value);
 void sema_down(struct semaphore *);
+bool sema_down_interruptible(struct semaphore *);
 bool sema_try_down(struct semaphore *);
 void sema_up(struct semaphore *);
 void sema_self_test(void);
@@ -42,17 +44,8 @@ struct condition
 
 void cond_init(struct condition *);
 void cond_wait(struct condition *, struct lock *);
+bool cond_wait_interruptible(struct condition *, struct lock *);
 void cond_signal(struct condition *, struct lock *);
 void cond_broadcast(struct condition *, struct lock *);
 
-/* Optimization barrier.
-
-   The compiler will not reorder operations across an
-   optimization barrier.  See "Optimization Barriers" in the
-   reference guide for more information.*/
-#define barrier() asm volatile("" \
-                               :  \
-                               :  \
-                               : "memory")
-
 #endif /* threads/synch.h */
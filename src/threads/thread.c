@@ -15,6 +15,7 @@
 #include "threads/fixed_point.h"
 #ifdef USERPROG
 #include "userprog/process.h"
+#include "userprog/profile.h"
 #endif
 
 /* Random value for struct thread's `magic' member.
@@ -129,21 +130,32 @@ void thread_start(void)
   sema_down(&idle_started);
 }
 
-/* Called by the timer interrupt handler at each timer tick.
+/* Called by the timer interrupt handler at each timer tick, with
+   the frame of the code that the tick interrupted.
    Thus, this function runs in an external interrupt context. */
-void thread_tick(void)
+void thread_tick(const struct intr_frame *f)
 {
   struct thread *t = thread_current();
+  bool user = (f->cs & 3) == 3;
 
   /* Update statistics. */
   if (t == idle_thread)
     idle_ticks++;
-#ifdef USERPROG
-  else if (t->pagedir != NULL)
+  else if (user)
     user_ticks++;
-#endif
   else
     kernel_ticks++;
+#ifdef USERPROG
+  if (t->process != NULL)
+  {
+    if (user)
+      t->process->usage.utime++;
+    else
+      t->process->usage.stime++;
+    if (user && t->process->profile != NULL)
+      profile_sample(t->process->profile, (uint32_t)f->eip);
+  }
+#endif
 
   t->fp_recent_cpu += fraction_base;
 
@@ -323,6 +335,35 @@ void thread_unblock(struct thread *t)
   intr_set_level(old_level);
 }
 
+/* Interrupts thread T, which must exit before it next returns
+   to user mode.  If T is in an interruptible sleep, in
+   sema_down_interruptible() or poller_wait(), wakes it up, and
+   makes any such sleep it starts later return at once. */
+void thread_interrupt(struct thread *t)
+{
+  enum intr_level old_level;
+
+  ASSERT(is_thread(t));
+
+  old_level = intr_disable();
+  t->interrupted = true;
+
+  /* Wake T, unless sema_up() or pollq_wake() already has. */
+  if (t->sleep_sema != NULL && t->status == THREAD_BLOCKED)
+  {
+    list_remove(&t->wait_elem);
+    t->sleep_sema = NULL;
+    thread_unblock(t);
+  }
+  else if (t->sleep_poller != NULL && t->sleep_poller->waiter == t)
+  {
+    t->sleep_poller->waiter = NULL;
+    t->sleep_poller = NULL;
+    thread_unblock(t);
+  }
+  intr_set_level(old_level);
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name(void)
@@ -591,6 +632,15 @@ init_thread(struct thread *t, const char *name, int priority)
   //增加的属性 nice
   t->nice = 0;
 
+#ifdef USERPROG
+  t->process = NULL;
+  t->uthread = NULL;
+  list_init(&t->children);
+  list_init(&t->zombies);
+  cond_init(&t->child_exited);
+  pollq_init(&t->child_pollers);
+#endif
+
   old_level = intr_disable();
   list_push_back(&all_list, &t->allelem);
   intr_set_level(old_level);
@@ -705,6 +755,18 @@ schedule(void)
   ASSERT(cur->status != THREAD_RUNNING);
   ASSERT(is_thread(next));
 
+#ifdef USERPROG
+  /* A thread that blocked gave up the CPU; one that is still
+     ready had it taken away. */
+  if (cur != next && cur->process != NULL)
+  {
+    if (cur->status == THREAD_BLOCKED)
+      cur->process->usage.nvcsw++;
+    else if (cur->status == THREAD_READY)
+      cur->process->usage.nivcsw++;
+  }
+#endif
+
   if (cur != next)
     prev = switch_threads(cur, next);
   thread_schedule_tail(prev);
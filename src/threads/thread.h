@@ -5,6 +5,8 @@
 #include <list.h>
 #include <stdint.h>
 #include "fixed_point.h"
+#include "threads/pollq.h"
+#include "threads/synch.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -115,9 +117,23 @@ struct thread
    //添加的属性，等待队列迭代器（暂时不知道 对于elem 是不是冗余的）
    struct list_elem wait_elem;
 
+   /* Shared between thread.c, synch.c, and pollq.c. */
+   bool interrupted;              /* Set by thread_interrupt(). */
+   struct semaphore *sleep_sema;  /* Semaphore in interruptible sleep. */
+   struct poller *sleep_poller;   /* Poller in interruptible sleep. */
+
 #ifdef USERPROG
    /* Owned by userprog/process.c. */
-   uint32_t *pagedir; /* Page directory. */
+   uint32_t *pagedir;          /* Active page directory, or null. */
+   struct process *process;    /* Process this thread belongs to. */
+   struct uthread *uthread;    /* This thread's record in `process'. */
+   struct list children;       /* Running processes started here. */
+   struct list zombies;        /* Exited ones not yet waited for. */
+   struct condition child_exited; /* Signaled when a child exits. */
+   struct pollq child_pollers;  /* Woken when a child exits. */
+
+   /* Owned by userprog/syscall.c. */
+   struct intr_frame *syscall_frame; /* User registers in a syscall. */
 #endif
 
    /* Owned by thread.c. */
@@ -129,10 +145,12 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+struct intr_frame;
+
 void thread_init(void);
 void thread_start(void);
 
-void thread_tick(void);
+void thread_tick(const struct intr_frame *);
 void thread_print_stats(void);
 
 typedef void thread_func(void *aux);
@@ -140,6 +158,7 @@ tid_t thread_create(const char *name, int priority, thread_func *, void *);
 
 void thread_block(void);
 void thread_unblock(struct thread *);
+void thread_interrupt(struct thread *);
 
 struct thread *thread_current(void);
 tid_t thread_tid(void);
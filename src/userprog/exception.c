@@ -2,14 +2,20 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/tss.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
+static void debug_exception (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -43,7 +49,8 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
+  intr_register_int (1, 0, INTR_OFF, debug_exception,
+                     "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
   intr_register_int (7, 0, INTR_ON, kill,
                      "#NM Device Not Available Exception");
@@ -108,6 +115,23 @@ kill (struct intr_frame *f)
     }
 }
 
+/* Debug exception handler.  A user program that sets TF and
+   then executes SYSENTER single-steps through the start of the
+   entry stub, in the kernel, until the stub has saved the
+   user's flags and loaded clean ones at sysenter_clean.  Those
+   traps are ignored; the stub returns to the user with TF set
+   again.  Any other debug exception is handled like other
+   exceptions. */
+static void
+debug_exception (struct intr_frame *f)
+{
+  if (f->cs == SEL_KCSEG
+      && (uintptr_t) f->eip >= (uintptr_t) sysenter_entry
+      && (uintptr_t) f->eip <= (uintptr_t) sysenter_clean)
+    return;
+  kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -148,6 +172,35 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* Faults on user addresses, whether by the process itself or by
+     the kernel on its behalf, may just need the page brought in,
+     or, for a write to a page shared copy-on-write after fork(),
+     a private copy of it.  A fault by the kernel takes the user
+     stack pointer from the system call's frame. */
+  if (is_user_vaddr (fault_addr) && thread_current ()->pagedir != NULL)
+    {
+      struct intr_frame *sf = thread_current ()->syscall_frame;
+      void *esp = user ? f->esp : sf != NULL ? sf->esp : NULL;
+
+      if (not_present
+          ? page_in (fault_addr, write, esp)
+          : write && page_unshare (pg_round_down (fault_addr)))
+        return;
+    }
+#endif
+
+  /* A fault by the kernel on a user address is a bad pointer
+     passed to a system call.  The user memory accessors in
+     userprog/syscall.c leave the address to resume at in EAX and
+     expect to find -1 there afterward. */
+  if (!user && is_user_vaddr (fault_addr))
+    {
+      f->eip = (void (*) (void)) f->eax;
+      f->eax = 0xffffffff;
+      return;
+    }
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
@@ -0,0 +1,221 @@
+#include "userprog/futex.h"
+#include <futex.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include "userprog/syscall.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Fast user-space locking.
+
+   A user program synchronizes through ordinary memory and calls
+   futex() only to sleep when it must wait, or to wake sleepers.
+   Sleepers are kept in queues in a hash table keyed on the page
+   directory and user address they sleep on, so that threads that
+   share an address space meet on the same queue, while the same
+   address in different processes names different queues.  Each
+   queue exists only while some thread sleeps on it.
+
+   A single lock protects the table.  FUTEX_WAIT reads the user's
+   word while holding it, which may fault, so it must never be
+   acquired by the page fault path. */
+
+/* A queue of threads waiting on one address. */
+struct futex_queue
+  {
+    struct hash_elem elem;      /* Element in `futexes'. */
+    uint32_t *pagedir;          /* Address space. */
+    int *uaddr;                 /* User address. */
+    struct list waiters;        /* List of struct futex_waiter. */
+  };
+
+/* A sleeping thread. */
+struct futex_waiter
+  {
+    struct list_elem elem;      /* Element in queue's `waiters'. */
+    struct semaphore sema;      /* Upped to wake the thread. */
+  };
+
+/* All queues, and a lock to protect them. */
+static struct hash futexes;
+static struct lock futex_lock;
+
+static hash_hash_func futex_hash;
+static hash_less_func futex_less;
+
+/* Initializes the futex table. */
+void
+futex_init (void)
+{
+  hash_init (&futexes, futex_hash, futex_less, NULL);
+  lock_init (&futex_lock);
+}
+
+/* Returns the queue for UADDR in the running process's address
+   space, or a null pointer if there is none.  The caller must
+   hold futex_lock. */
+static struct futex_queue *
+queue_find (int *uaddr)
+{
+  struct futex_queue key;
+  struct hash_elem *e;
+
+  key.pagedir = thread_current ()->pagedir;
+  key.uaddr = uaddr;
+  e = hash_find (&futexes, &key.elem);
+  return e != NULL ? hash_entry (e, struct futex_queue, elem) : NULL;
+}
+
+/* Sleeps on UADDR if it holds VAL.  Returns 0 after being woken,
+   -1 if UADDR did not hold VAL or memory is exhausted. */
+static int
+futex_wait (int *uaddr, int val)
+{
+  struct futex_waiter w;
+  struct futex_queue *q;
+  int cur;
+
+  lock_acquire (&futex_lock);
+  if (!copy_in (&cur, uaddr, sizeof cur))
+    {
+      lock_release (&futex_lock);
+      thread_exit ();
+    }
+  if (cur != val)
+    {
+      lock_release (&futex_lock);
+      return -1;
+    }
+
+  /* A thread of a process that is ending must not sleep past
+     futex_exit(), which may already have run. */
+  if (thread_current ()->interrupted)
+    {
+      lock_release (&futex_lock);
+      return -1;
+    }
+
+  q = queue_find (uaddr);
+  if (q == NULL)
+    {
+      q = malloc (sizeof *q);
+      if (q == NULL)
+        {
+          lock_release (&futex_lock);
+          return -1;
+        }
+      q->pagedir = thread_current ()->pagedir;
+      q->uaddr = uaddr;
+      list_init (&q->waiters);
+      hash_insert (&futexes, &q->elem);
+    }
+  sema_init (&w.sema, 0);
+  list_push_back (&q->waiters, &w.elem);
+  lock_release (&futex_lock);
+
+  sema_down (&w.sema);
+  return 0;
+}
+
+/* Wakes up to CNT threads sleeping on UADDR, in the order they
+   went to sleep, and returns the number woken. */
+static int
+futex_wake (int *uaddr, int cnt)
+{
+  struct futex_queue *q;
+  int woken = 0;
+
+  lock_acquire (&futex_lock);
+  q = queue_find (uaddr);
+  if (q != NULL)
+    {
+      while (woken < cnt && !list_empty (&q->waiters))
+        {
+          struct futex_waiter *w = list_entry (list_pop_front (&q->waiters),
+                                               struct futex_waiter, elem);
+          sema_up (&w->sema);
+          woken++;
+        }
+      if (list_empty (&q->waiters))
+        {
+          hash_delete (&futexes, &q->elem);
+          free (q);
+        }
+    }
+  lock_release (&futex_lock);
+  return woken;
+}
+
+/* Wakes every thread sleeping in address space PAGEDIR, whose
+   process is ending, so that they can exit. */
+void
+futex_exit (uint32_t *pagedir)
+{
+  struct hash_iterator i;
+  bool found;
+
+  lock_acquire (&futex_lock);
+  do
+    {
+      found = false;
+      hash_first (&i, &futexes);
+      while (hash_next (&i))
+        {
+          struct futex_queue *q = hash_entry (hash_cur (&i),
+                                              struct futex_queue, elem);
+          if (q->pagedir == pagedir)
+            {
+              while (!list_empty (&q->waiters))
+                sema_up (&list_entry (list_pop_front (&q->waiters),
+                                      struct futex_waiter, elem)->sema);
+              hash_delete (&futexes, &q->elem);
+              free (q);
+              found = true;
+              break;
+            }
+        }
+    }
+  while (found);
+  lock_release (&futex_lock);
+}
+
+/* Futex system call. */
+int
+futex (int *uaddr, int op, int val)
+{
+  if ((uintptr_t) uaddr % sizeof *uaddr != 0)
+    return -1;
+  switch (op)
+    {
+    case FUTEX_WAIT:
+      return futex_wait (uaddr, val);
+    case FUTEX_WAKE:
+      return futex_wake (uaddr, val);
+    default:
+      return -1;
+    }
+}
+
+/* Returns a hash value for the queue containing E. */
+static unsigned
+futex_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct futex_queue *q = hash_entry (e, struct futex_queue, elem);
+  return hash_int ((uintptr_t) q->pagedir ^ (uintptr_t) q->uaddr);
+}
+
+/* Returns true if the queue containing A precedes the one
+   containing B. */
+static bool
+futex_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct futex_queue *a = hash_entry (a_, struct futex_queue, elem);
+  const struct futex_queue *b = hash_entry (b_, struct futex_queue, elem);
+
+  if (a->pagedir != b->pagedir)
+    return a->pagedir < b->pagedir;
+  return a->uaddr < b->uaddr;
+}
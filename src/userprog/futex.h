@@ -0,0 +1,10 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdint.h>
+
+void futex_init (void);
+int futex (int *uaddr, int op, int val);
+void futex_exit (uint32_t *pagedir);
+
+#endif /* userprog/futex.h */
@@ -10,6 +10,8 @@
 #define SEL_TSS         0x28    /* Task-state segment. */
 #define SEL_CNT         6       /* Number of segments. */
 
+#ifndef __ASSEMBLER__
 void gdt_init (void);
+#endif
 
 #endif /* userprog/gdt.h */
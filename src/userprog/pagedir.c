@@ -1,24 +1,90 @@
 #include "userprog/pagedir.h"
+#include <clock.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/swap.h"
+#endif
+
+/* Software PTE bit, taken from PTE_AVL, marking a user page that
+   is shared copy-on-write.  Such a page is mapped read-only even
+   though the process may write it; see pagedir_unshare_page(). */
+#define PTE_COW 0x200
+
+/* Software PTE bit, taken from PTE_AVL, marking a user page that
+   was mapped ahead of use by fault-around, so that we can tell
+   later whether mapping it paid off. */
+#define PTE_AHEAD 0x400
+
+/* Software PTE bit, taken from PTE_AVL, marking a not-present
+   user page whose contents are in swap.  The swap slot is kept
+   in the address bits. */
+#define PTE_SWAP 0x800
+
+/* Software PTE bit marking a present user page that belongs to a
+   shared memory segment or a submission ring rather than to the
+   process alone, so that pagedir_fork() passes over it.  It is
+   the same bit as PTE_SWAP, which only not-present PTEs use. */
+#define PTE_SHARED 0x800
+
+/* A batch of TLB invalidations for one page directory.
+
+   Each INVLPG is much cheaper than reloading CR3, which drops
+   every non-global TLB entry, but only up to a point.  A batch
+   collects the pages modified by an operation on a range of
+   PTEs and invalidates them individually, unless there are more
+   than BATCH_PAGES of them, in which case it flushes the whole
+   TLB once instead. */
+#define BATCH_PAGES 16
+struct tlb_batch
+  {
+    uint32_t *pd;                       /* Page directory modified. */
+    size_t cnt;                         /* Number of pages added. */
+    const void *pages[BATCH_PAGES];     /* First BATCH_PAGES added. */
+  };
 
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
+#ifdef VM
+static void flush_tlb (void);
+static void batch_init (struct tlb_batch *, uint32_t *pd);
+static void batch_add (struct tlb_batch *, const void *upage);
+static void batch_flush (struct tlb_batch *);
+static void protect_cow (uint32_t *pd);
+#endif
+static uint32_t *lookup_page (uint32_t *pd, const void *vaddr, bool create);
 
 /* Creates a new page directory that has mappings for kernel
-   virtual addresses, but none for user virtual addresses.
+   virtual addresses, and for user virtual addresses only the
+   clock page, read-only at CLOCK_PAGE_ADDR (see lib/clock.h).
    Returns the new page directory, or a null pointer if memory
-   allocation fails. */
+   allocation fails.
+
+   The clock page belongs to the timer, so pagedir_destroy() and
+   pagedir_fork() pass over it. */
 uint32_t *
 pagedir_create (void) 
 {
   uint32_t *pd = palloc_get_page (0);
-  if (pd != NULL)
-    memcpy (pd, init_page_dir, PGSIZE);
+  uint32_t *pte;
+
+  if (pd == NULL)
+    return NULL;
+  memcpy (pd, init_page_dir, PGSIZE);
+  pte = lookup_page (pd, (void *) CLOCK_PAGE_ADDR, true);
+  if (pte == NULL)
+    {
+      palloc_free_page (pd);
+      return NULL;
+    }
+  *pte = pte_create_user (timer_clock_page (), false);
   return pd;
 }
 
@@ -41,12 +107,111 @@ pagedir_destroy (uint32_t *pd)
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+            {
+              if (pte_get_page (*pte) == timer_clock_page ())
+                continue;
+#ifdef VM
+              frame_free (pte_get_page (*pte));
+#else
+              palloc_free_page (pte_get_page (*pte));
+#endif
+            }
+#ifdef VM
+          else if (*pte & PTE_SWAP)
+            swap_free (*pte >> PGBITS);
+#endif
         palloc_free_page (pt);
       }
   palloc_free_page (pd);
 }
 
+/* Creates and returns a page directory for a child of the
+   process that owns PD, as fork() requires, or returns a null
+   pointer if memory allocation fails.
+
+   With virtual memory, the child shares every user frame with PD.
+   Writable pages are write-protected in both directories and
+   marked copy-on-write, so that the first write by either
+   process faults into pagedir_unshare_page().  Pages in swap are
+   shared the same way.  The caller must hold the vm_lock of PD's
+   process, so that none of its pages come or go during the walk.
+   Without virtual memory, every user page is copied eagerly.
+
+   Either way, pages mapped with pagedir_set_shared_page() are
+   left out of the child. */
+uint32_t *
+pagedir_fork (uint32_t *pd) 
+{
+  uint32_t *child, *pde;
+
+  child = pagedir_create ();
+  if (child == NULL)
+    return NULL;
+#ifdef VM
+  protect_cow (pd);
+#endif
+
+  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P) 
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        size_t i;
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++) 
+          {
+            uint32_t *pte = &pt[i];
+            void *upage = (void *) (((uintptr_t) (pde - pd) << PDSHIFT)
+                                   | (i << PTSHIFT));
+            void *kpage = pte_get_page (*pte);
+#ifdef VM
+            uint32_t *child_pte;
+#else
+            void *copy;
+#endif
+
+            if ((*pte & PTE_P)
+                && (kpage == timer_clock_page () || (*pte & PTE_SHARED)))
+              continue;
+
+#ifdef VM
+            if ((*pte & (PTE_P | PTE_SWAP)) == 0)
+              continue;
+            child_pte = lookup_page (child, upage, true);
+            if (child_pte == NULL)
+              goto fail;
+            if (*pte & PTE_SWAP)
+              {
+                *child_pte = *pte;
+                swap_ref (*pte >> PGBITS);
+                continue;
+              }
+            /* The dirty bit stays, because eviction only writes
+               dirty pages to swap. */
+            *child_pte = *pte & ~(uint32_t) PTE_A;
+            frame_ref (kpage);
+#else
+            if ((*pte & PTE_P) == 0)
+              continue;
+            copy = palloc_get_page (PAL_USER);
+            if (copy == NULL)
+              goto fail;
+            memcpy (copy, kpage, PGSIZE);
+            if (!pagedir_set_page (child, upage, copy, (*pte & PTE_W) != 0))
+              {
+                palloc_free_page (copy);
+                goto fail;
+              }
+#endif
+          }
+      }
+
+  return child;
+
+ fail:
+  pagedir_destroy (child);
+  return NULL;
+}
+
 /* Returns the address of the page table entry for virtual
    address VADDR in page directory PD.
    If PD does not have a page table for VADDR, behavior depends
@@ -118,6 +283,23 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     return false;
 }
 
+/* Adds a mapping in page directory PD from user virtual page
+   UPAGE to KPAGE, as pagedir_set_page() does, for a page that
+   the process shares with others, such as a page of a shared
+   memory segment.  pagedir_fork() does not copy such a mapping;
+   the caller is responsible for giving the child its own.
+   Returns true if successful, false if memory allocation
+   failed. */
+bool
+pagedir_set_shared_page (uint32_t *pd, void *upage, void *kpage,
+                         bool writable)
+{
+  if (!pagedir_set_page (pd, upage, kpage, writable))
+    return false;
+  *lookup_page (pd, upage, false) |= PTE_SHARED;
+  return true;
+}
+
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
@@ -138,7 +320,8 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
 
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
-   bits in the page table entry are preserved.
+   bits in the page table entry are preserved, except PTE_SHARED,
+   which would read as PTE_SWAP in a not-present entry.
    UPAGE need not be mapped. */
 void
 pagedir_clear_page (uint32_t *pd, void *upage) 
@@ -151,11 +334,103 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   pte = lookup_page (pd, upage, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
-      *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      *pte &= ~(uint32_t) (PTE_P | PTE_SHARED);
+      invalidate_page (pd, upage);
     }
 }
 
+#ifdef VM
+/* Resolves a write to copy-on-write page UPAGE in PD by giving
+   PD a private, writable frame for it.  Returns true if
+   successful, false if UPAGE is not a copy-on-write page or no
+   frame is available for the copy. */
+bool
+pagedir_unshare_page (uint32_t *pd, const void *upage) 
+{
+  uint32_t *pte;
+  void *kpage;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (pd, upage, false);
+  if (pte == NULL || (*pte & (PTE_P | PTE_COW)) != (PTE_P | PTE_COW))
+    return false;
+
+  kpage = frame_unshare (pte_get_page (*pte));
+  if (kpage == NULL)
+    return false;
+
+  /* The page may have been written before it was shared, so
+     treat it as dirty. */
+  *pte = pte_create_user (kpage, true) | PTE_D;
+  invalidate_page (pd, upage);
+  return true;
+}
+
+/* Marks user page UPAGE in PD, which must have been cleared by
+   pagedir_clear_page(), as swapped out to swap slot SLOT. */
+void
+pagedir_set_swap (uint32_t *pd, const void *upage, size_t slot) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  ASSERT (pte != NULL && (*pte & PTE_P) == 0);
+  ASSERT (slot < (1u << (32 - PGBITS)));
+  *pte = (slot << PGBITS) | PTE_SWAP;
+}
+
+/* Forgets that user page UPAGE in PD is swapped out, leaving it
+   unmapped.  The caller is responsible for the swap slot. */
+void
+pagedir_clear_swap (uint32_t *pd, const void *upage) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  if (pte != NULL && (*pte & (PTE_P | PTE_SWAP)) == PTE_SWAP)
+    *pte = 0;
+}
+
+/* Returns true if user page UPAGE in PD is swapped out, storing
+   its swap slot into *SLOT if SLOT is nonnull.  A page that
+   pagedir_set_page() maps again is no longer swapped out. */
+bool
+pagedir_get_swap (uint32_t *pd, const void *upage, size_t *slot) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  if (pte == NULL || (*pte & (PTE_P | PTE_SWAP)) != PTE_SWAP)
+    return false;
+  if (slot != NULL)
+    *slot = *pte >> PGBITS;
+  return true;
+}
+#endif
+
+/* Marks present user page UPAGE in PD as mapped ahead of use. */
+void
+pagedir_set_ahead (uint32_t *pd, const void *upage) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  ASSERT (pte != NULL && (*pte & PTE_P) != 0);
+  *pte |= PTE_AHEAD;
+}
+
+/* Returns true if present user page UPAGE in PD was marked by
+   pagedir_set_ahead(), clearing the mark.  Returns false
+   otherwise. */
+bool
+pagedir_clear_ahead (uint32_t *pd, const void *upage) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+
+  if (pte == NULL || (*pte & (PTE_P | PTE_AHEAD)) != (PTE_P | PTE_AHEAD))
+    return false;
+  *pte &= ~(uint32_t) PTE_AHEAD;
+  return true;
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
@@ -167,6 +442,16 @@ pagedir_is_dirty (uint32_t *pd, const void *vpage)
   return pte != NULL && (*pte & PTE_D) != 0;
 }
 
+/* Returns true if the PTE for virtual page VPAGE in PD is
+   present and writable, false otherwise.  A copy-on-write page
+   is not writable until it has been unshared. */
+bool
+pagedir_is_writable (uint32_t *pd, const void *vpage) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_W)) == (PTE_P | PTE_W);
+}
+
 /* Set the dirty bit to DIRTY in the PTE for virtual page VPAGE
    in PD. */
 void
@@ -180,7 +465,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,13 +494,20 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register, unless it is already loaded.
+
+   Reloading CR3 flushes every TLB entry that is not global.
+   Kernel mappings are global (see paging_init()), so they
+   survive a switch between processes, but there is still no
+   point in flushing user mappings on a switch between threads
+   that share a page directory, such as kernel threads, which
+   all run on the base page directory. */
 void
 pagedir_activate (uint32_t *pd) 
 {
@@ -227,7 +519,8 @@ pagedir_activate (uint32_t *pd)
      new page tables immediately.  See [IA32-v2a] "MOV--Move
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
      Address of the Page Directory". */
-  asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+  if (active_pd () != pd)
+    asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
 }
 
 /* Returns the currently active page directory. */
@@ -243,21 +536,102 @@ active_pd (void)
   return ptov (pd);
 }
 
-/* Seom page table changes can cause the CPU's translation
+#ifdef VM
+/* Flushes all non-global entries from the translation lookaside
+   buffer (TLB) by reloading CR3 with its current value.  See
+   [IA32-v3a] 3.12 "Translation Lookaside Buffers (TLBs)". */
+static void
+flush_tlb (void) 
+{
+  uintptr_t cr3;
+  asm volatile ("movl %%cr3, %0; movl %0, %%cr3" : "=r" (cr3) : : "memory");
+}
+#endif
+
+/* Some page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the stale
+   entry.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   This function invalidates the TLB entry for UPAGE if PD is the
+   active page directory.  (If PD is not active then its entries
+   are not in the TLB, so there is no need to invalidate
+   anything.)  See [IA32-v2a] "INVLPG". */
 static void
-invalidate_pagedir (uint32_t *pd) 
+invalidate_page (uint32_t *pd, const void *upage) 
 {
   if (active_pd () == pd) 
-    {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
-    } 
+    asm volatile ("invlpg (%0)" : : "r" (upage) : "memory");
+}
+
+#ifdef VM
+/* Initializes BATCH for changes to page directory PD. */
+static void
+batch_init (struct tlb_batch *batch, uint32_t *pd) 
+{
+  batch->pd = pd;
+  batch->cnt = 0;
+}
+
+/* Adds UPAGE, whose PTE has been modified, to BATCH. */
+static void
+batch_add (struct tlb_batch *batch, const void *upage) 
+{
+  if (batch->cnt < BATCH_PAGES)
+    batch->pages[batch->cnt] = upage;
+  batch->cnt++;
+}
+
+/* Invalidates the TLB entries for the pages added to BATCH. */
+static void
+batch_flush (struct tlb_batch *batch) 
+{
+  size_t i;
+
+  if (batch->cnt == 0 || active_pd () != batch->pd)
+    ;
+  else if (batch->cnt > BATCH_PAGES)
+    flush_tlb ();
+  else
+    for (i = 0; i < batch->cnt; i++)
+      invalidate_page (batch->pd, batch->pages[i]);
+  batch->cnt = 0;
+}
+
+/* Write-protects every writable user page in PD and marks it
+   copy-on-write, for pagedir_fork().
+
+   Other threads of PD's process share its TLB entries, because
+   switching between them does not reload CR3, so one that ran
+   before the flush could still write through a stale writable
+   entry into a frame that the child now shares.  Interrupts stay
+   off from the first change until the flush to prevent that. */
+static void
+protect_cow (uint32_t *pd) 
+{
+  struct tlb_batch batch;
+  enum intr_level old_level;
+  uint32_t *pde;
+
+  old_level = intr_disable ();
+  batch_init (&batch, pd);
+  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P) 
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        size_t i;
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+          if ((pt[i] & (PTE_P | PTE_W | PTE_SHARED)) == (PTE_P | PTE_W))
+            {
+              void *upage = (void *) (((uintptr_t) (pde - pd) << PDSHIFT)
+                                     | (i << PTSHIFT));
+
+              pt[i] = (pt[i] & ~(uint32_t) PTE_W) | PTE_COW;
+              batch_add (&batch, upage);
+            }
+      }
+  batch_flush (&batch);
+  intr_set_level (old_level);
 }
+#endif
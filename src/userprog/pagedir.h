@@ -2,13 +2,26 @@
 #define USERPROG_PAGEDIR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 uint32_t *pagedir_create (void);
 void pagedir_destroy (uint32_t *pd);
+uint32_t *pagedir_fork (uint32_t *pd);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_set_shared_page (uint32_t *pd, void *upage, void *kpage,
+                              bool rw);
 void *pagedir_get_page (uint32_t *pd, const void *upage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
+#ifdef VM
+bool pagedir_unshare_page (uint32_t *pd, const void *upage);
+void pagedir_set_swap (uint32_t *pd, const void *upage, size_t slot);
+bool pagedir_get_swap (uint32_t *pd, const void *upage, size_t *slot);
+void pagedir_clear_swap (uint32_t *pd, const void *upage);
+#endif
+void pagedir_set_ahead (uint32_t *pd, const void *upage);
+bool pagedir_clear_ahead (uint32_t *pd, const void *upage);
+bool pagedir_is_writable (uint32_t *pd, const void *upage);
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
@@ -0,0 +1,335 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/pollq.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Pipes.
+
+   A pipe is a ring buffer of PIPE_SIZE bytes in kernel memory
+   with a read end and a write end, each of which may be open in
+   any number of file descriptors.  A reader blocks while the
+   pipe is empty and a writer while it is full.  A read from an
+   empty pipe with no writers returns 0, for end of file, and a
+   write to a pipe with no readers fails.
+
+   The pipe_splice_*() functions move data between a pipe and a
+   file directly through the ring, so that it is copied once,
+   between the ring and the disk, instead of passing through a
+   user buffer on the way.  They hold the pipe's lock across the
+   file system call, so the lock order is pipe lock, then
+   filesys_lock. */
+
+/* Size of a pipe's buffer, a power of 2. */
+#define PIPE_PAGES 4
+#define PIPE_SIZE (PIPE_PAGES * PGSIZE)
+
+/* A pipe. */
+struct pipe
+  {
+    uint8_t *buf;               /* PIPE_SIZE bytes of data. */
+    uint32_t head;              /* Total bytes read. */
+    uint32_t tail;              /* Total bytes written. */
+    int readers;                /* Open read ends. */
+    int writers;                /* Open write ends. */
+    struct lock lock;           /* Protects all of the above. */
+    struct condition not_empty; /* Signaled when data arrives. */
+    struct condition not_full;  /* Signaled when data leaves. */
+    struct pollq pollers;       /* Woken along with either. */
+  };
+
+/* Creates and returns a new pipe, with its read and write ends
+   each open once, or returns a null pointer if memory is
+   exhausted. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+
+  if (p == NULL)
+    return NULL;
+  p->buf = palloc_get_multiple (0, PIPE_PAGES);
+  if (p->buf == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  p->head = p->tail = 0;
+  p->readers = p->writers = 1;
+  lock_init (&p->lock);
+  cond_init (&p->not_empty);
+  cond_init (&p->not_full);
+  pollq_init (&p->pollers);
+  return p;
+}
+
+/* Opens the write end of P again if WRITER is true, otherwise
+   the read end. */
+void
+pipe_open (struct pipe *p, bool writer)
+{
+  lock_acquire (&p->lock);
+  if (writer)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release (&p->lock);
+}
+
+/* Closes the write end of P if WRITER is true, otherwise the
+   read end, and frees P once both ends are fully closed. */
+void
+pipe_close (struct pipe *p, bool writer)
+{
+  bool dead;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writers > 0);
+      if (--p->writers == 0)
+        {
+          cond_broadcast (&p->not_empty, &p->lock);
+          pollq_wake (&p->pollers);
+        }
+    }
+  else
+    {
+      ASSERT (p->readers > 0);
+      if (--p->readers == 0)
+        {
+          cond_broadcast (&p->not_full, &p->lock);
+          pollq_wake (&p->pollers);
+        }
+    }
+  dead = p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+
+  if (dead)
+    {
+      palloc_free_multiple (p->buf, PIPE_PAGES);
+      free (p);
+    }
+}
+
+/* Waits until P holds data or has no writers, and returns the
+   number of bytes of data in it.  Gives up and returns 0 if the
+   running thread is interrupted first.  P's lock must be held. */
+static size_t
+wait_data (struct pipe *p)
+{
+  while (p->tail == p->head && p->writers > 0)
+    if (!cond_wait_interruptible (&p->not_empty, &p->lock))
+      return 0;
+  return p->tail - p->head;
+}
+
+/* Waits until P has room for data or has no readers, and
+   returns the number of bytes of room, which is 0 if there are
+   no readers.  Gives up and returns 0 if the running thread is
+   interrupted first.  P's lock must be held. */
+static size_t
+wait_space (struct pipe *p)
+{
+  while (p->tail - p->head == PIPE_SIZE && p->readers > 0)
+    if (!cond_wait_interruptible (&p->not_full, &p->lock))
+      return 0;
+  return p->readers > 0 ? PIPE_SIZE - (p->tail - p->head) : 0;
+}
+
+/* Returns the length of the run of bytes that starts at ring
+   index IDX, limited to SIZE bytes and to the end of the
+   buffer. */
+static size_t
+run_length (uint32_t idx, size_t size)
+{
+  size_t left = PIPE_SIZE - idx % PIPE_SIZE;
+  return size < left ? size : left;
+}
+
+/* Reads up to SIZE bytes from P into BUFFER, a kernel address,
+   waiting for data if P is empty.  Returns the number of bytes
+   read, which is 0 only if P is empty with no writers. */
+int
+pipe_read (struct pipe *p, void *buffer, size_t size)
+{
+  uint8_t *dst = buffer;
+  size_t done = 0;
+  size_t avail;
+
+  lock_acquire (&p->lock);
+  avail = wait_data (p);
+  if (size > avail)
+    size = avail;
+  while (done < size)
+    {
+      size_t run = run_length (p->head, size - done);
+      memcpy (dst + done, p->buf + p->head % PIPE_SIZE, run);
+      p->head += run;
+      done += run;
+    }
+  if (done > 0)
+    {
+      cond_broadcast (&p->not_full, &p->lock);
+      pollq_wake (&p->pollers);
+    }
+  lock_release (&p->lock);
+  return done;
+}
+
+/* Writes SIZE bytes from BUFFER, a kernel address, into P,
+   waiting for room as necessary.  Returns the number of bytes
+   written, which is short only if P loses its last reader, or
+   -1 if P has no readers to begin with. */
+int
+pipe_write (struct pipe *p, const void *buffer, size_t size)
+{
+  const uint8_t *src = buffer;
+  size_t done = 0;
+
+  lock_acquire (&p->lock);
+  while (done < size)
+    {
+      size_t space = wait_space (p);
+      size_t run;
+
+      if (space == 0)
+        break;
+      run = run_length (p->tail, space < size - done ? space : size - done);
+      memcpy (p->buf + p->tail % PIPE_SIZE, src + done, run);
+      p->tail += run;
+      done += run;
+      cond_broadcast (&p->not_empty, &p->lock);
+      pollq_wake (&p->pollers);
+    }
+  lock_release (&p->lock);
+  return done > 0 || size == 0 ? (int) done : -1;
+}
+
+/* Moves up to SIZE bytes from P to FILE at its current position,
+   or to the console if FILE is null, waiting for data if P is
+   empty.  Returns the number of bytes moved, which is 0 if P is
+   empty with no writers and short if FILE cannot grow. */
+int
+pipe_splice_out (struct pipe *p, struct file *file, size_t size)
+{
+  size_t done = 0;
+  size_t avail;
+
+  lock_acquire (&p->lock);
+  avail = wait_data (p);
+  if (size > avail)
+    size = avail;
+  while (done < size)
+    {
+      size_t run = run_length (p->head, size - done);
+      uint8_t *data = p->buf + p->head % PIPE_SIZE;
+      size_t moved;
+
+      if (file == NULL)
+        {
+          putbuf ((char *) data, run);
+          moved = run;
+        }
+      else
+        {
+          lock_acquire (&filesys_lock);
+          moved = file_write (file, data, run);
+          lock_release (&filesys_lock);
+        }
+      p->head += moved;
+      done += moved;
+      if (moved != run)
+        break;
+    }
+  if (done > 0)
+    {
+      cond_broadcast (&p->not_full, &p->lock);
+      pollq_wake (&p->pollers);
+    }
+  lock_release (&p->lock);
+  return done;
+}
+
+/* Moves up to SIZE bytes from FILE, at its current position,
+   into P, waiting for room if P is full.  Returns the number of
+   bytes moved, which is 0 at end of file, or -1 if P has no
+   readers. */
+int
+pipe_splice_in (struct pipe *p, struct file *file, size_t size)
+{
+  size_t done = 0;
+  size_t space;
+
+  lock_acquire (&p->lock);
+  space = wait_space (p);
+  if (space == 0)
+    {
+      lock_release (&p->lock);
+      return -1;
+    }
+  if (size > space)
+    size = space;
+  while (done < size)
+    {
+      size_t run = run_length (p->tail, size - done);
+      size_t moved;
+
+      lock_acquire (&filesys_lock);
+      moved = file_read (file, p->buf + p->tail % PIPE_SIZE, run);
+      lock_release (&filesys_lock);
+      p->tail += moved;
+      done += moved;
+      if (moved != run)
+        break;
+    }
+  if (done > 0)
+    {
+      cond_broadcast (&p->not_empty, &p->lock);
+      pollq_wake (&p->pollers);
+    }
+  lock_release (&p->lock);
+  return done;
+}
+
+/* Returns the poll() events that hold for the write end of P if
+   WRITER is true, otherwise for its read end. */
+int
+pipe_poll (struct pipe *p, bool writer)
+{
+  int events = 0;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      if (p->readers == 0)
+        events |= POLLERR;
+      else if (p->tail - p->head < PIPE_SIZE)
+        events |= POLLOUT;
+    }
+  else
+    {
+      if (p->tail != p->head)
+        events |= POLLIN;
+      if (p->writers == 0)
+        events |= POLLHUP;
+    }
+  lock_release (&p->lock);
+  return events;
+}
+
+/* Returns P's poll queue, which is woken whenever either end of P
+   may have become ready. */
+struct pollq *
+pipe_pollq (struct pipe *p)
+{
+  return &p->pollers;
+}
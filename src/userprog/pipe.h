@@ -0,0 +1,19 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct file;
+
+struct pipe *pipe_create (void);
+void pipe_open (struct pipe *, bool writer);
+void pipe_close (struct pipe *, bool writer);
+int pipe_read (struct pipe *, void *buffer, size_t size);
+int pipe_write (struct pipe *, const void *buffer, size_t size);
+int pipe_splice_out (struct pipe *, struct file *, size_t size);
+int pipe_splice_in (struct pipe *, struct file *, size_t size);
+int pipe_poll (struct pipe *, bool writer);
+struct pollq *pipe_pollq (struct pipe *);
+
+#endif /* userprog/pipe.h */
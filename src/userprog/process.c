@@ -1,68 +1,486 @@
 #include "userprog/process.h"
+#include <clock.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <uthread.h>
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/profile.h"
+#include "userprog/ring.h"
+#include "userprog/shm.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static thread_func start_fork NO_RETURN;
+static thread_func start_thread NO_RETURN;
+static bool load (const char *file_name, const struct exec_args *,
+                  void (**eip) (void), void **esp);
+static struct child *child_create (void);
+static void child_register (struct child *, tid_t);
+static void child_abandon (struct child *);
+static void child_exit (struct child *, int status,
+                        const struct rusage *);
+static void child_orphan_all (struct thread *);
+static struct child *child_find (tid_t);
+static void child_reap (struct child *);
+static hash_hash_func child_hash;
+static hash_less_func child_less;
+static void rusage_add (struct rusage *, const struct rusage *);
+static void print_rusage (const char *name, const struct rusage *);
+static struct process *process_create (void);
+static void process_free (struct process *);
+static void process_attach (struct process *, struct uthread *);
+static void process_kill (struct process *);
+static thread_action_func interrupt_thread;
+static bool alloc_thread_stack (struct process *, int slot,
+                                const void *args, size_t size);
+static void free_thread_stack (struct process *, int slot);
+#ifndef VM
+static bool resize_heap (struct process *, uint8_t *old_brk,
+                         uint8_t *new_brk);
+#endif
 
-/* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+/* Records of the children of all threads, keyed on their tids,
+   and the lock that protects them and the threads' lists of
+   children. */
+static struct hash children;
+static struct lock child_lock;
+
+/* Print each process's resource usage when it exits? */
+bool process_print_rusage;
+
+/* A thread of a user process.
+
+   The record stays in its process's `threads' list after the
+   thread exits, so that process_thread_join() can collect its
+   status, until it is joined or the process ends. */
+struct uthread
+  {
+    tid_t tid;                  /* Thread identifier. */
+    int slot;                   /* Stack slot, or -1 for the first thread. */
+    int status;                 /* Value passed to thread_exit(). */
+    bool alone;                 /* Exited without ending the process. */
+    bool joined;                /* Someone has claimed the status. */
+    struct semaphore exited;    /* Upped when the thread exits. */
+    struct list_elem elem;      /* Element in process's `threads'. */
+  };
+
+/* Returns the top of the stack in SLOT; see lib/uthread.h. */
+static uint8_t *
+thread_stack_top (int slot)
+{
+  return (uint8_t *) UTHREAD_STACKS_TOP - slot * UTHREAD_SLOT_SIZE;
+}
+
+/* Initializes the process module. */
+void
+process_init (void) 
+{
+  hash_init (&children, child_hash, child_less, NULL);
+  lock_init (&child_lock);
+}
+
+/* The initial contents of a new process's stack, built by its
+   parent: the argument strings and, word-aligned below them,
+   argv[] with its null sentinel, argv, argc, and a null return
+   address, as _start() in lib/user/entry.c expects.
+
+   The image is built at the end of BUF, which stands for the top
+   of the user stack at PHYS_BASE, so the parent can work out the
+   user address of each string in advance, and the child copies
+   the whole image into place with a single memcpy().  BUF
+   doubles in size as arguments are added, up to ARGS_MAX
+   bytes. */
+struct exec_args
+  {
+    uint8_t *buf;               /* PAGE_CNT contiguous pages. */
+    size_t page_cnt;            /* Size of BUF, in pages. */
+    size_t size;                /* Bytes of image at the end of BUF. */
+    int argc;                   /* Number of arguments. */
+  };
+
+/* Largest image of arguments, in bytes. */
+#define ARGS_MAX (128 * 1024)
+
+/* Handed from process_execute() or process_spawn() to
+   start_process(), in a page of its own, followed by the name of
+   the executable. */
+struct exec_info
+  {
+    struct process *process;    /* The new process. */
+    bool detached;              /* Parent does not wait for load()? */
+    struct semaphore loaded;    /* Upped when load() finishes. */
+    bool success;               /* Whether load() succeeded. */
+    struct exec_args *args;     /* Initial stack contents. */
+    char file[];                /* Executable's name. */
+  };
+
+/* Handed from process_fork() to start_fork(). */
+struct fork_info
+  {
+    struct intr_frame if_;      /* Parent's user registers. */
+    struct process *process;    /* Child's copy of the process. */
+  };
+
+/* Handed from process_thread_create() to start_thread(). */
+struct thread_info
+  {
+    struct intr_frame if_;      /* New thread's user registers. */
+    struct process *process;    /* Process the thread joins. */
+    struct uthread *uthread;    /* The thread's record. */
+  };
+
+/* Returns the end of ARGS's buffer, which stands for
+   PHYS_BASE. */
+static uint8_t *
+args_end (const struct exec_args *args)
+{
+  return args->buf + args->page_cnt * PGSIZE;
+}
+
+/* Returns the user address at which the byte at K in ARGS's
+   buffer will be once the image is in place. */
+static uint32_t
+args_user_addr (const struct exec_args *args, const void *k)
+{
+  return (uintptr_t) PHYS_BASE - (args_end (args) - (const uint8_t *) k);
+}
+
+/* Returns the size of the complete image for ARGC arguments
+   whose strings take STR_SIZE bytes in all. */
+static size_t
+args_image_size (size_t str_size, int argc)
+{
+  return (ROUND_UP (str_size, sizeof (uint32_t))
+          + (argc + 4) * sizeof (uint32_t));
+}
+
+/* Returns a new, empty set of arguments for a program, or a null
+   pointer if memory is exhausted. */
+struct exec_args *
+process_args_create (void)
+{
+  struct exec_args *args = malloc (sizeof *args);
+
+  if (args == NULL)
+    return NULL;
+  args->buf = palloc_get_page (0);
+  if (args->buf == NULL)
+    {
+      free (args);
+      return NULL;
+    }
+  args->page_cnt = 1;
+  args->size = 0;
+  args->argc = 0;
+  return args;
+}
+
+/* Appends an argument of LEN bytes to ARGS and returns the place
+   where the caller must put those bytes.  The null terminator is
+   already there.  Returns a null pointer if the image would
+   exceed ARGS_MAX bytes or memory is exhausted. */
+char *
+process_args_add (struct exec_args *args, size_t len)
+{
+  size_t need = args_image_size (args->size + len + 1, args->argc + 1);
+  char *arg;
+
+  if (need > ARGS_MAX)
+    return NULL;
+  if (need > args->page_cnt * PGSIZE)
+    {
+      size_t page_cnt = args->page_cnt * 2;
+      uint8_t *buf;
+
+      while (page_cnt * PGSIZE < need)
+        page_cnt *= 2;
+      buf = palloc_get_multiple (0, page_cnt);
+      if (buf == NULL)
+        return NULL;
+      memcpy (buf + page_cnt * PGSIZE - args->size,
+              args_end (args) - args->size, args->size);
+      palloc_free_multiple (args->buf, args->page_cnt);
+      args->buf = buf;
+      args->page_cnt = page_cnt;
+    }
+
+  args->size += len + 1;
+  args->argc++;
+  arg = (char *) args_end (args) - args->size;
+  arg[len] = '\0';
+  return arg;
+}
+
+/* Frees ARGS, which may be null. */
+void
+process_args_destroy (struct exec_args *args)
+{
+  if (args != NULL)
+    {
+      palloc_free_multiple (args->buf, args->page_cnt);
+      free (args);
+    }
+}
+
+/* Completes the image in ARGS by laying out argv[], argv, argc,
+   and the return address below the strings.  process_args_add()
+   has left room for them. */
+static void
+args_finish (struct exec_args *args)
+{
+  char *str = (char *) args_end (args) - args->size;
+  uint32_t *sp;
+  int i;
+
+  /* BUF ends on a page boundary, so aligning a kernel address in
+     it aligns the corresponding user address too.  The strings
+     were added from the top down, so the lowest is the last. */
+  sp = (uint32_t *) ROUND_DOWN ((uintptr_t) str, sizeof (uint32_t));
+  sp -= args->argc + 1;
+  sp[args->argc] = 0;
+  for (i = args->argc - 1; i >= 0; i--)
+    {
+      sp[i] = args_user_addr (args, str);
+      str += strlen (str) + 1;
+    }
+  sp -= 3;
+  sp[2] = args_user_addr (args, sp + 3);
+  sp[1] = args->argc;
+  sp[0] = 0;
+  args->size = args_end (args) - (uint8_t *) sp;
+}
+
+/* Returns a new exec_info for running FILE with ARGS, which it
+   takes over, or a null pointer if memory is exhausted.  Frees
+   ARGS on failure. */
+static struct exec_info *
+exec_info_create (const char *file, size_t len, struct exec_args *args)
+{
+  struct exec_info *info = palloc_get_page (0);
+
+  if (info == NULL || len >= PGSIZE - sizeof *info)
+    {
+      palloc_free_page (info);
+      process_args_destroy (args);
+      return NULL;
+    }
+  memcpy (info->file, file, len);
+  info->file[len] = '\0';
+  info->args = args;
+  return info;
+}
+
+/* Frees INFO. */
+static void
+exec_info_destroy (struct exec_info *info)
+{
+  process_args_destroy (info->args);
+  palloc_free_page (info);
+}
+
+static tid_t execute (struct exec_info *, const struct spawn_action *,
+                      int action_cnt);
+
+/* Starts a new thread running a user program loaded from the
+   first word of CMD_LINE, passing it the remaining words as
+   arguments.  Returns the new process's thread id, or TID_ERROR
+   if the thread cannot be created or the program cannot be
+   loaded. */
 tid_t
-process_execute (const char *file_name) 
+process_execute (const char *cmd_line) 
 {
-  char *fn_copy;
-  tid_t tid;
+  struct exec_args *args = process_args_create ();
+  struct exec_info *info;
+  const char *file = NULL;
+  size_t file_len = 0;
+
+  if (args == NULL)
+    return TID_ERROR;
+
+  /* Split the command line into words. */
+  for (;;)
+    {
+      size_t len;
+      char *arg;
+
+      while (*cmd_line == ' ')
+        cmd_line++;
+      len = strcspn (cmd_line, " ");
+      if (len == 0)
+        break;
+      arg = process_args_add (args, len);
+      if (arg == NULL)
+        {
+          process_args_destroy (args);
+          return TID_ERROR;
+        }
+      memcpy (arg, cmd_line, len);
+      if (file == NULL)
+        {
+          file = cmd_line;
+          file_len = len;
+        }
+      cmd_line += len;
+    }
+  if (file == NULL)
+    {
+      process_args_destroy (args);
+      return TID_ERROR;
+    }
 
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+  info = exec_info_create (file, file_len, args);
+  if (info == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+  info->detached = false;
+  return execute (info, NULL, 0);
+}
+
+/* Starts a new thread running the user program in FILE, passing
+   it ARGS, which this function takes over, as for the spawn()
+   system call.  The new process's file descriptors are set up by
+   the ACTION_CNT ACTIONS; see lib/spawn.h.
+
+   Unlike process_execute(), returns without waiting for the
+   program to be loaded, so that the caller can get on with its
+   work meanwhile.  If loading fails, the new process exits with
+   status -1.  Returns the new process's thread id, or TID_ERROR
+   if the process cannot be created at all. */
+tid_t
+process_spawn (const char *file, struct exec_args *args,
+               const struct spawn_action *actions, int action_cnt)
+{
+  struct exec_info *info = exec_info_create (file, strlen (file), args);
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
+  if (info == NULL)
+    return TID_ERROR;
+  info->detached = true;
+  return execute (info, actions, action_cnt);
+}
+
+/* Starts a new process as described by INFO, with file
+   descriptors set up by the ACTION_CNT ACTIONS, and returns its
+   thread id, or TID_ERROR on failure.  Unless INFO is detached,
+   waits for the new process to load its program, failing if it
+   cannot.  Frees INFO, or passes it on to the new process to
+   free. */
+static tid_t
+execute (struct exec_info *info, const struct spawn_action *actions,
+         int action_cnt)
+{
+  bool detached = info->detached;
+  struct process *p;
+  struct child *c;
+  char name[sizeof thread_current ()->name];
+  tid_t tid;
+
+  args_finish (info->args);
+  p = info->process = process_create ();
+  if (p != NULL)
+    {
+      p->child = child_create ();
+      p->files = syscall_create_files (actions, action_cnt);
+    }
+  if (p == NULL || p->child == NULL || p->files == NULL)
+    {
+      if (p != NULL)
+        {
+          free (p->child);
+          syscall_close_files (p->files);
+          process_free (p);
+        }
+      exec_info_destroy (info);
+      return TID_ERROR;
+    }
+  c = p->child;
+  sema_init (&info->loaded, 0);
+
+  /* The thread is named after the program. */
+  strlcpy (name, info->file, sizeof name);
+
+  /* Create a new thread to run the program.  Once it runs, the
+     new process belongs to the thread, and so does INFO if it is
+     detached.  Otherwise, wait for the thread to report whether
+     it could load the program. */
+  tid = thread_create (name, PRI_DEFAULT, start_process, info);
   if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
+    {
+      free (c);
+      syscall_close_files (p->files);
+      process_free (p);
+      exec_info_destroy (info);
+      return TID_ERROR;
+    }
+  if (!detached)
+    {
+      bool success;
+
+      sema_down (&info->loaded);
+      success = info->success;
+      exec_info_destroy (info);
+      if (!success)
+        {
+          child_abandon (c);
+          return TID_ERROR;
+        }
+    }
+  child_register (c, tid);
   return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *info_)
 {
-  char *file_name = file_name_;
+  struct exec_info *info = info_;
+  struct process *p = info->process;
   struct intr_frame if_;
   bool success;
 
+  process_attach (p, list_entry (list_front (&p->threads),
+                                 struct uthread, elem));
+
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = load (info->file, info->args, &if_.eip, &if_.esp);
+
+  /* Report the outcome.  Our parent frees INFO once it hears, so
+     we must not touch it after this. */
+  if (info->detached)
+    exec_info_destroy (info);
+  else
+    {
+      info->success = success;
+      sema_up (&info->loaded);
+    }
 
   /* If load failed, quit. */
-  palloc_free_page (file_name);
   if (!success) 
     thread_exit ();
 
@@ -76,33 +494,528 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* Creates a child of the running process that is a copy of it,
+   as for the fork() system call.  PARENT_IF holds the registers
+   with which the parent entered the kernel; the child resumes
+   from the same point with a return value of 0.  Returns the
+   child's thread id, or TID_ERROR if it cannot be created.
+
+   Only the calling thread is copied.  The stacks of the parent's
+   other threads stay reserved in the child, but nothing runs on
+   them.
+
+   With virtual memory the address space is shared copy-on-write,
+   so forking costs one page table walk rather than a copy of
+   every page; see pagedir_fork(). */
+tid_t
+process_fork (const struct intr_frame *parent_if)
+{
+  struct thread *cur = thread_current ();
+  struct process *parent = cur->process;
+  struct fork_info *info;
+  struct process *p;
+#ifdef VM
+  bool success;
+#endif
+  tid_t tid;
+
+  info = malloc (sizeof *info);
+  if (info == NULL)
+    return TID_ERROR;
+  p = info->process = process_create ();
+  if (p == NULL)
+    {
+      free (info);
+      return TID_ERROR;
+    }
+  info->if_ = *parent_if;
+  p->child = child_create ();
+  lock_acquire (&parent->lock);
+  p->stack_slots = parent->stack_slots;
+  lock_release (&parent->lock);
+  p->heap_start = parent->heap_start;
+  p->brk = parent->brk;
+  if (parent->profile != NULL)
+    p->profile = profile_fork (parent->profile);
+#ifdef VM
+  lock_acquire (&parent->vm_lock);
+#endif
+  p->pagedir = pagedir_fork (parent->pagedir);
+#ifdef VM
+  /* Copy the areas in the same snapshot as the pages, before
+     another thread can change them. */
+  success = p->pagedir != NULL && page_copy_areas (&p->vm_areas);
+  lock_release (&parent->vm_lock);
+  if (!success)
+    goto fail;
+#endif
+  if (p->child == NULL || p->pagedir == NULL)
+    goto fail;
+  if (!shm_fork (parent, p))
+    goto fail;
+  p->files = syscall_copy_files ();
+  if (p->files == NULL)
+    goto fail;
+
+  tid = thread_create (cur->name, cur->priority, start_fork, info);
+  if (tid == TID_ERROR)
+    goto fail;
+
+  /* START_FORK now owns INFO. */
+  child_register (p->child, tid);
+  return tid;
+
+ fail:
+  free (p->child);
+  shm_exit (p);
+  pagedir_destroy (p->pagedir);
+#ifdef VM
+  page_free_areas (&p->vm_areas);
+#endif
+  syscall_close_files (p->files);
+  process_free (p);
+  free (info);
+  return TID_ERROR;
+}
+
+/* A thread function that adopts the process prepared by
+   process_fork() and returns to user mode in the child. */
+static void
+start_fork (void *info_)
+{
+  struct fork_info *info = info_;
+  struct process *p = info->process;
+  struct intr_frame if_ = info->if_;
+
+  free (info);
+  process_attach (p, list_entry (list_front (&p->threads),
+                                 struct uthread, elem));
+  process_activate ();
+
+  /* fork() returns 0 in the child. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Starts a new thread in the running process, as for the
+   thread_create() system call.  The thread begins at user address
+   EIP on a stack of its own, as if called with ARG0 and ARG1 as
+   arguments, and must not return.  Returns the new thread's id,
+   or TID_ERROR if the process has no free stack slot or memory is
+   exhausted. */
+tid_t
+process_thread_create (void *eip, void *arg0, void *arg1)
+{
+  struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  void *args[3] = { NULL, arg0, arg1 };
+  struct thread_info *info;
+  struct uthread *ut;
+  tid_t tid;
+  int slot;
+
+  info = malloc (sizeof *info);
+  ut = malloc (sizeof *ut);
+  if (info == NULL || ut == NULL)
+    goto fail;
+
+  /* Claim a stack slot, and count the thread before it can run,
+     so that the process cannot end under it. */
+  lock_acquire (&p->lock);
+  for (slot = 0; slot < UTHREAD_SLOTS; slot++)
+    if ((p->stack_slots & (1u << slot)) == 0)
+      break;
+  if (slot < UTHREAD_SLOTS)
+    {
+      p->stack_slots |= 1u << slot;
+      p->thread_cnt++;
+      ut->tid = TID_ERROR;
+      ut->slot = slot;
+      ut->status = 0;
+      ut->alone = false;
+      ut->joined = false;
+      sema_init (&ut->exited, 0);
+      list_push_back (&p->threads, &ut->elem);
+    }
+  lock_release (&p->lock);
+  if (slot >= UTHREAD_SLOTS)
+    goto fail;
+
+  /* The new thread enters user mode as if returning from this
+     system call, but at EIP, on the new stack, with a null return
+     address and then the arguments on it. */
+  if (!alloc_thread_stack (p, slot, args, sizeof args))
+    goto undo;
+  info->if_ = *cur->syscall_frame;
+  info->if_.eip = (void (*) (void)) eip;
+  info->if_.esp = thread_stack_top (slot) - sizeof args;
+  info->if_.eax = 0;
+  info->process = p;
+  info->uthread = ut;
+
+  lock_acquire (&p->lock);
+  tid = thread_create (cur->name, cur->priority, start_thread, info);
+  if (tid != TID_ERROR)
+    {
+      ut->tid = tid;
+      lock_release (&p->lock);
+      return tid;
+    }
+  lock_release (&p->lock);
+  free_thread_stack (p, slot);
+
+ undo:
+  lock_acquire (&p->lock);
+  list_remove (&ut->elem);
+  p->thread_cnt--;
+  p->stack_slots &= ~(1u << slot);
+  lock_release (&p->lock);
+
+ fail:
+  free (info);
+  free (ut);
+  return TID_ERROR;
+}
+
+/* A thread function that joins the process set up by
+   process_thread_create() and enters user mode. */
+static void
+start_thread (void *info_)
+{
+  struct thread_info *info = info_;
+  struct intr_frame if_ = info->if_;
+
+  process_attach (info->process, info->uthread);
+  free (info);
+  process_activate ();
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Waits for thread TID of the running process to exit, as for
+   the thread_join() system call, and returns the status it passed
+   to thread_exit().  Returns -1 at once if TID is not a thread of
+   this process created by thread_create(), is the caller itself,
+   or has already been joined, and returns -1 without joining TID
+   if the caller is interrupted while it waits. */
+int
+process_thread_join (tid_t tid)
+{
+  struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  struct uthread *ut = NULL;
+  struct list_elem *e;
+  int status;
+
+  lock_acquire (&p->lock);
+  for (e = list_begin (&p->threads); e != list_end (&p->threads);
+       e = list_next (e))
+    {
+      struct uthread *u = list_entry (e, struct uthread, elem);
+      if (u->tid == tid && u->slot >= 0 && u != cur->uthread && !u->joined)
+        {
+          ut = u;
+          ut->joined = true;
+          break;
+        }
+    }
+  lock_release (&p->lock);
+  if (ut == NULL)
+    return -1;
+
+  if (!sema_down_interruptible (&ut->exited))
+    {
+      /* Leave UT for process_free(). */
+      lock_acquire (&p->lock);
+      ut->joined = false;
+      lock_release (&p->lock);
+      return -1;
+    }
+  lock_acquire (&p->lock);
+  list_remove (&ut->elem);
+  lock_release (&p->lock);
+  status = ut->status;
+  free (ut);
+  return status;
+}
+
+/* Ends the running thread with STATUS, for thread_join() to
+   collect, as for the thread_exit() system call.  The rest of the
+   process keeps running, unless this was its last thread. */
+void
+process_thread_exit (int status)
+{
+  struct uthread *ut = thread_current ()->uthread;
+
+  ut->status = status;
+  ut->alone = true;
+  thread_exit ();
+}
+
+/* Ends the running process with STATUS, as for the exit() system
+   call.  The calling thread exits at once, and the process's
+   other threads as soon as they would return to user mode; see
+   process_kill().  The process is torn down once the last of them
+   is gone. */
+void
+process_end (int status)
+{
+  struct process *p = thread_current ()->process;
+
+  lock_acquire (&p->lock);
+  if (!p->exiting)
+    {
+      p->exit_status = status;
+      process_kill (p);
+    }
+  lock_release (&p->lock);
+  thread_exit ();
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
+   immediately, without waiting.  If the calling thread is
+   interrupted while it waits, returns -1 and leaves the child
+   to be waited for.
 
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   Only the thread that started a child may wait for it. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
+{
+  struct thread *cur = thread_current ();
+  struct child *c;
+  int status = -1;
+
+  lock_acquire (&child_lock);
+  c = child_find (child_tid);
+  if (c != NULL && c->parent == cur)
+    {
+      while (!c->exited)
+        if (!cond_wait_interruptible (&cur->child_exited, &child_lock))
+          break;
+      if (c->exited)
+        {
+          status = c->exit_status;
+          if (cur->process != NULL)
+            rusage_add (&cur->process->child_usage, &c->usage);
+          child_reap (c);
+        }
+    }
+  lock_release (&child_lock);
+  return status;
+}
+
+/* Waits for whichever child of the calling thread exits first,
+   or takes one that already has, as for the waitany() system
+   call.  Stores its exit status in *STATUS and returns its thread
+   id.  Returns TID_ERROR at once if the thread has no children
+   left to wait for, or as soon as it is interrupted. */
+tid_t
+process_wait_any (int *status)
+{
+  struct thread *cur = thread_current ();
+  tid_t tid = TID_ERROR;
+
+  lock_acquire (&child_lock);
+  while (list_empty (&cur->zombies) && !list_empty (&cur->children))
+    if (!cond_wait_interruptible (&cur->child_exited, &child_lock))
+      break;
+  if (!list_empty (&cur->zombies))
+    {
+      struct child *c = list_entry (list_front (&cur->zombies),
+                                    struct child, elem);
+      tid = c->tid;
+      *status = c->exit_status;
+      if (cur->process != NULL)
+        rusage_add (&cur->process->child_usage, &c->usage);
+      child_reap (c);
+    }
+  lock_release (&child_lock);
+  return tid;
+}
+
+/* Returns the poll() events that hold for the calling thread's
+   children: POLLIN if one has exited and not been waited for,
+   POLLHUP if there are none at all. */
+int
+process_poll_children (void)
+{
+  struct thread *cur = thread_current ();
+  int events = 0;
+
+  lock_acquire (&child_lock);
+  if (!list_empty (&cur->zombies))
+    events |= POLLIN;
+  else if (list_empty (&cur->children))
+    events |= POLLHUP;
+  lock_release (&child_lock);
+  return events;
+}
+
+/* Stores the resource usage of WHO, RUSAGE_SELF or
+   RUSAGE_CHILDREN, in *USAGE, as for the getrusage() system
+   call.  The children's is the sum of those that the running
+   process has waited for, including what they had from theirs.
+   Returns false if WHO is neither. */
+bool
+process_get_rusage (int who, struct rusage *usage)
+{
+  struct process *p = thread_current ()->process;
+
+  if (who == RUSAGE_SELF)
+    *usage = p->usage;
+  else if (who == RUSAGE_CHILDREN)
+    *usage = p->child_usage;
+  else
+    return false;
+  return true;
+}
+
+/* Moves the running process's break, the end of its heap, by
+   INCREMENT bytes, as for the sbrk() system call, and returns the
+   old break.  New heap pages read as zeros; with virtual memory
+   they are brought in on first touch.  Returns (void *) -1,
+   leaving the break alone, if it would move below the start of
+   the heap or into the thread stacks, or if memory is exhausted. */
+void *
+process_sbrk (intptr_t increment)
 {
-  return -1;
+  struct process *p = thread_current ()->process;
+  uint8_t *old_brk, *new_brk;
+  bool success;
+
+#ifdef VM
+  lock_acquire (&p->vm_lock);
+#else
+  lock_acquire (&p->lock);
+#endif
+  old_brk = p->brk;
+  new_brk = old_brk + increment;
+  if (increment >= 0
+      ? (new_brk < old_brk
+         || (uintptr_t) new_brk > CLOCK_PAGE_ADDR)
+      : (new_brk > old_brk || new_brk < p->heap_start))
+    success = false;
+  else
+    {
+#ifdef VM
+      success = page_brk (p->heap_start, old_brk, new_brk);
+#else
+      success = resize_heap (p, old_brk, new_brk);
+#endif
+    }
+  if (success)
+    p->brk = new_brk;
+#ifdef VM
+  lock_release (&p->vm_lock);
+#else
+  lock_release (&p->lock);
+#endif
+  return success ? old_brk : (void *) -1;
 }
 
-/* Free the current process's resources. */
+/* Takes the running thread out of its process, if any, and frees
+   the process's resources if it was the last thread.  A thread
+   that leaves other than through process_thread_exit(), whether
+   by exit() or by being killed, ends the whole process. */
 void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  struct uthread *ut = cur->uthread;
   uint32_t *pd;
+  bool last;
+
+  /* Nobody will wait for our children any more. */
+  child_orphan_all (cur);
+  if (p == NULL)
+    return;
+
+  lock_acquire (&p->lock);
+  if (!ut->alone && !p->exiting)
+    process_kill (p);
+  lock_release (&p->lock);
+  if (p->exiting)
+    futex_exit (p->pagedir);
+
+  /* Give up our stack, then let a joiner have our status.  Once
+     we are no longer counted, the last thread may free the
+     process and its page directory at any time, so first detach
+     from both, leaving nothing for the scheduler to charge or
+     reload. */
+  if (ut->slot >= 0)
+    free_thread_stack (p, ut->slot);
+  lock_acquire (&p->lock);
+  if (ut->slot >= 0)
+    p->stack_slots &= ~(1u << ut->slot);
+  last = p->thread_cnt == 1;
+  if (!last)
+    {
+      cur->process = NULL;
+      cur->uthread = NULL;
+      cur->pagedir = NULL;
+      pagedir_activate (NULL);
+      p->thread_cnt--;
+      sema_up (&ut->exited);
+      lock_release (&p->lock);
+      return;
+    }
+  p->thread_cnt = 0;
+  lock_release (&p->lock);
+
+  /* A process whose threads all called thread_exit() succeeded. */
+  if (!p->exiting)
+    p->exit_status = 0;
+  if (p->pagedir != NULL)
+    {
+      printf ("%s: exit(%d)\n", cur->name, p->exit_status);
+      if (process_print_rusage)
+        print_rusage (cur->name, &p->usage);
+      if (p->profile != NULL)
+        profile_write (p->profile, cur->name, p->pid);
+    }
+
+  /* Tell our parent, if it is still listening. */
+  if (p->child != NULL)
+    {
+      struct rusage total = p->usage;
+
+      rusage_add (&total, &p->child_usage);
+      child_exit (p->child, p->exit_status, &total);
+      p->child = NULL;
+    }
+
+  /* Stop using our files from the submission ring's poller, then
+     close them, and allow writes to our executable. */
+  ring_exit ();
+  syscall_close_files (p->files);
+  p->files = NULL;
+  if (p->exec_file != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      file_close (p->exec_file);
+      lock_release (&filesys_lock);
+      p->exec_file = NULL;
+    }
 
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
-  pd = cur->pagedir;
+  pd = p->pagedir;
   if (pd != NULL) 
     {
+      /* Our shared memory frames are not ours alone to free. */
+      shm_exit (p);
+#ifdef VM
+      /* Nor is the clock page. */
+      pagedir_clear_page (pd, (void *) CLOCK_PAGE_ADDR);
+      page_exit ();
+#endif
+
       /* Correct ordering here is crucial.  We must set
          cur->pagedir to NULL before switching page directories,
          so that a timer interrupt can't switch back to the
@@ -110,10 +1023,271 @@ process_exit (void)
          directory before destroying the process's page
          directory, or our active page directory will be one
          that's been freed (and cleared). */
-      cur->pagedir = NULL;
+      cur->pagedir = p->pagedir = NULL;
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+
+  cur->process = NULL;
+  cur->uthread = NULL;
+  process_free (p);
+}
+
+/* Allocates a process with no address space or files, and a
+   record for its first thread.  Returns a null pointer if memory
+   is exhausted. */
+static struct process *
+process_create (void)
+{
+  struct process *p = malloc (sizeof *p);
+  struct uthread *ut = malloc (sizeof *ut);
+
+  if (p == NULL || ut == NULL)
+    {
+      free (p);
+      free (ut);
+      return NULL;
+    }
+  p->pid = TID_ERROR;
+  p->pagedir = NULL;
+  p->child = NULL;
+  p->exec_file = NULL;
+  p->heap_start = p->brk = NULL;
+  memset (&p->usage, 0, sizeof p->usage);
+  memset (&p->child_usage, 0, sizeof p->child_usage);
+  p->profile = NULL;
+  p->files = NULL;
+  p->ring = NULL;
+  list_init (&p->shm_maps);
+#ifdef VM
+  list_init (&p->vm_areas);
+  lock_init (&p->vm_lock);
+#endif
+  lock_init (&p->lock);
+  p->exit_status = -1;
+  p->exiting = false;
+  p->thread_cnt = 1;
+  list_init (&p->threads);
+  p->stack_slots = 0;
+
+  ut->tid = TID_ERROR;
+  ut->slot = -1;
+  ut->status = 0;
+  ut->alone = false;
+  ut->joined = false;
+  sema_init (&ut->exited, 0);
+  list_push_back (&p->threads, &ut->elem);
+  return p;
+}
+
+/* Frees P and its thread records.  P's resources must already
+   have been released. */
+static void
+process_free (struct process *p)
+{
+  while (!list_empty (&p->threads))
+    free (list_entry (list_pop_front (&p->threads), struct uthread, elem));
+  profile_destroy (p->profile);
+  free (p);
+}
+
+/* Makes the running thread the thread of P that UT describes. */
+static void
+process_attach (struct process *p, struct uthread *ut)
+{
+  struct thread *t = thread_current ();
+
+  t->process = p;
+  t->uthread = ut;
+  t->pagedir = p->pagedir;
+  if (ut->slot < 0)
+    p->pid = t->tid;
+  ut->tid = t->tid;
+
+  /* A thread that joins a process already ending ends too. */
+  if (p->exiting)
+    thread_interrupt (t);
+}
+
+/* Marks P as ending and interrupts all of its threads but the
+   running one, so that each exits instead of returning to user
+   mode and gives up any wait in the kernel that it is in or
+   starts on the way.  Threads asleep in futex() are woken by
+   futex_exit() instead.  P's lock must be held. */
+static void
+process_kill (struct process *p)
+{
+  enum intr_level old_level;
+
+  p->exiting = true;
+  old_level = intr_disable ();
+  thread_foreach (interrupt_thread, p);
+  intr_set_level (old_level);
+}
+
+/* Interrupts T if it is a thread of process P other than the
+   running thread. */
+static void
+interrupt_thread (struct thread *t, void *p)
+{
+  if (t->process == p && t != thread_current ())
+    thread_interrupt (t);
+}
+
+/* Allocates a record for a child of the running thread.  Until
+   child_register() is called, only the child can see it, and the
+   parent may free it with free() as long as the child never
+   ran.  Returns a null pointer if memory is exhausted. */
+static struct child *
+child_create (void)
+{
+  struct child *c = malloc (sizeof *c);
+  if (c != NULL)
+    {
+      c->tid = TID_ERROR;
+      c->parent = thread_current ();
+      c->exited = false;
+      c->exit_status = -1;
+    }
+  return c;
+}
+
+/* Makes C, the record of a child of the running thread that is
+   now running as thread TID, visible to process_wait(). */
+static void
+child_register (struct child *c, tid_t tid)
+{
+  struct thread *cur = thread_current ();
+
+  lock_acquire (&child_lock);
+  c->tid = tid;
+  hash_insert (&children, &c->hash_elem);
+  list_push_back (c->exited ? &cur->zombies : &cur->children, &c->elem);
+  lock_release (&child_lock);
+}
+
+/* Gives up on C, the record of a running child that was never
+   registered, which is freed once the child exits. */
+static void
+child_abandon (struct child *c)
+{
+  lock_acquire (&child_lock);
+  if (c->exited)
+    free (c);
+  else
+    c->parent = NULL;
+  lock_release (&child_lock);
+}
+
+/* Records that the child that C describes exited with STATUS,
+   having used USAGE along with its children, waking up its
+   parent, or frees C if the parent is gone. */
+static void
+child_exit (struct child *c, int status, const struct rusage *usage)
+{
+  lock_acquire (&child_lock);
+  c->exited = true;
+  c->exit_status = status;
+  c->usage = *usage;
+  if (c->parent == NULL)
+    free (c);
+  else if (c->tid != TID_ERROR)
+    {
+      list_remove (&c->elem);
+      list_push_back (&c->parent->zombies, &c->elem);
+      cond_signal (&c->parent->child_exited, &child_lock);
+      pollq_wake (&c->parent->child_pollers);
+    }
+  lock_release (&child_lock);
+}
+
+/* Frees the records of T's children that have exited and leaves
+   the rest to free their own when they do. */
+static void
+child_orphan_all (struct thread *t)
+{
+  lock_acquire (&child_lock);
+  while (!list_empty (&t->zombies))
+    child_reap (list_entry (list_front (&t->zombies), struct child, elem));
+  while (!list_empty (&t->children))
+    {
+      struct child *c = list_entry (list_pop_front (&t->children),
+                                    struct child, elem);
+      hash_delete (&children, &c->hash_elem);
+      c->parent = NULL;
+    }
+  lock_release (&child_lock);
+}
+
+/* Returns the registered record for the child with the given
+   TID, or a null pointer if there is none.  The child lock must
+   be held. */
+static struct child *
+child_find (tid_t tid)
+{
+  struct child key;
+  struct hash_elem *e;
+
+  key.tid = tid;
+  e = hash_find (&children, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct child, hash_elem) : NULL;
+}
+
+/* Frees C, the record of an exited child whose status has been
+   collected or is no longer wanted.  The child lock must be
+   held. */
+static void
+child_reap (struct child *c)
+{
+  list_remove (&c->elem);
+  hash_delete (&children, &c->hash_elem);
+  free (c);
+}
+
+/* Returns a hash value for the child record containing E. */
+static unsigned
+child_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct child, hash_elem)->tid);
+}
+
+/* Returns true if the child record containing A precedes the one
+   containing B. */
+static bool
+child_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct child, hash_elem)->tid
+          < hash_entry (b, struct child, hash_elem)->tid);
+}
+
+/* Adds the counts in B to those in A. */
+static void
+rusage_add (struct rusage *a, const struct rusage *b)
+{
+  a->utime += b->utime;
+  a->stime += b->stime;
+  a->minflt += b->minflt;
+  a->majflt += b->majflt;
+  a->nvcsw += b->nvcsw;
+  a->nivcsw += b->nivcsw;
+  a->nsyscalls += b->nsyscalls;
+  a->read_bytes += b->read_bytes;
+  a->write_bytes += b->write_bytes;
+}
+
+/* Prints USAGE, the resource usage of the process called NAME. */
+static void
+print_rusage (const char *name, const struct rusage *usage)
+{
+  printf ("%s: rusage: %"PRId64" user ticks, %"PRId64" kernel ticks, "
+          "%"PRId64" minor faults, %"PRId64" major faults, "
+          "%"PRId64" voluntary switches, %"PRId64" involuntary switches, "
+          "%"PRId64" syscalls, %"PRId64" bytes read, "
+          "%"PRId64" bytes written\n",
+          name, usage->utime, usage->stime, usage->minflt, usage->majflt,
+          usage->nvcsw, usage->nivcsw, usage->nsyscalls,
+          usage->read_bytes, usage->write_bytes);
 }
 
 /* Sets up the CPU for running user code in the current
@@ -124,7 +1298,10 @@ process_activate (void)
 {
   struct thread *t = thread_current ();
 
-  /* Activate thread's page tables. */
+  /* Activate thread's page tables.  This is free when switching
+     between threads that share page tables, and otherwise only
+     flushes user mappings from the TLB, since kernel mappings
+     are global. */
   pagedir_activate (t->pagedir);
 
   /* Set thread's kernel stack for use in processing
@@ -195,67 +1372,93 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp);
+/* Most loadable segments in an executable we can run. */
+#define IMAGE_MAX_SEGS 8
+
+/* Number of executables whose headers are cached. */
+#define IMAGE_CACHE_SIZE 8
+
+static bool setup_stack (void **esp, const struct exec_args *);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
-   Stores the executable's entry point into *EIP
-   and its initial stack pointer into *ESP.
-   Returns true if successful, false otherwise. */
-bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+/* An executable's entry point and loadable segments, as read
+   from its ELF headers by read_image(). */
+struct exec_image
+  {
+    Elf32_Addr entry;                   /* Entry point. */
+    int seg_cnt;                        /* Number of segments. */
+    struct Elf32_Phdr segs[IMAGE_MAX_SEGS]; /* PT_LOAD headers. */
+  };
+
+/* A recently loaded executable's image.
+
+   The entry holds INODE open, so that the inode stays in memory
+   and GENERATION can tell whether it has been written since.
+   This does not stop anyone from writing the file.  Removing it
+   must drop the entry with process_forget_image(), or else the
+   file's sectors would stay allocated until the entry is
+   evicted. */
+struct image_cache_entry
+  {
+    struct inode *inode;        /* Executable, or null if unused. */
+    unsigned generation;        /* inode_get_generation() when read. */
+    unsigned last_use;          /* image_clock when last used. */
+    struct exec_image image;    /* Parsed headers. */
+  };
+
+/* Images of the executables loaded most recently, so that
+   running the same program again skips reading and checking its
+   headers.  Protected by filesys_lock. */
+static struct image_cache_entry image_cache[IMAGE_CACHE_SIZE];
+static unsigned image_clock;
+
+/* Reads and checks the ELF headers of FILE into IMAGE.  Returns
+   true if successful, false if FILE is not an executable we can
+   load. */
+static bool
+read_image (struct file *file, struct exec_image *image)
 {
-  struct thread *t = thread_current ();
   struct Elf32_Ehdr ehdr;
-  struct file *file = NULL;
-  off_t file_ofs;
+  struct Elf32_Phdr *phdrs;
   bool success = false;
   int i;
 
-  /* Allocate and activate page directory. */
-  t->pagedir = pagedir_create ();
-  if (t->pagedir == NULL) 
-    goto done;
-  process_activate ();
-
-  /* Open executable file. */
-  file = filesys_open (file_name);
-  if (file == NULL) 
-    {
-      printf ("load: %s: open failed\n", file_name);
-      goto done; 
-    }
-
   /* Read and verify executable header. */
-  if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
+  if (file_read_at (file, &ehdr, sizeof ehdr, 0) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
       || ehdr.e_type != 2
       || ehdr.e_machine != 3
       || ehdr.e_version != 1
       || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
       || ehdr.e_phnum > 1024) 
-    {
-      printf ("load: %s: error loading executable\n", file_name);
-      goto done; 
-    }
+    return false;
 
-  /* Read program headers. */
-  file_ofs = ehdr.e_phoff;
+  /* Read the program headers, a page at a time, keeping the
+     loadable segments. */
+  phdrs = palloc_get_page (0);
+  if (phdrs == NULL)
+    return false;
+  image->entry = ehdr.e_entry;
+  image->seg_cnt = 0;
   for (i = 0; i < ehdr.e_phnum; i++) 
     {
-      struct Elf32_Phdr phdr;
+      const int per_page = PGSIZE / sizeof *phdrs;
+      struct Elf32_Phdr *phdr = &phdrs[i % per_page];
 
-      if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
-      file_seek (file, file_ofs);
+      if (i % per_page == 0)
+        {
+          int cnt = ehdr.e_phnum - i < per_page ? ehdr.e_phnum - i : per_page;
+          off_t ofs = ehdr.e_phoff + i * sizeof *phdrs;
+          off_t size = cnt * sizeof *phdrs;
 
-      if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
-      file_ofs += sizeof phdr;
-      switch (phdr.p_type) 
+          if (ofs < 0 || ofs > file_length (file)
+              || file_read_at (file, phdrs, size, ofs) != size)
+            goto done;
+        }
+      switch (phdr->p_type) 
         {
         case PT_NULL:
         case PT_NOTE:
@@ -269,57 +1472,236 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_SHLIB:
           goto done;
         case PT_LOAD:
-          if (validate_segment (&phdr, file)) 
+          if (!validate_segment (phdr, file)
+              || image->seg_cnt >= IMAGE_MAX_SEGS)
+            goto done;
+          image->segs[image->seg_cnt++] = *phdr;
+          break;
+        }
+    }
+  success = true;
+
+ done:
+  palloc_free_page (phdrs);
+  return success;
+}
+
+/* Obtains the image of executable FILE into IMAGE, from the
+   cache if FILE has not been written since it was last read, or
+   else with read_image(), caching the result.  Returns true if
+   successful, false if FILE is not an executable we can load.
+   The caller must hold filesys_lock. */
+static bool
+get_image (struct file *file, struct exec_image *image)
+{
+  struct inode *inode = file_get_inode (file);
+  struct image_cache_entry *e, *victim = NULL;
+
+  ASSERT (lock_held_by_current_thread (&filesys_lock));
+  for (e = image_cache; e < image_cache + IMAGE_CACHE_SIZE; e++)
+    {
+      if (e->inode == inode)
+        {
+          if (e->generation == inode_get_generation (inode))
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
-              uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
-              if (phdr.p_filesz > 0)
-                {
-                  /* Normal segment.
-                     Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
-                }
-              else 
-                {
-                  /* Entirely zero.
-                     Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
-                }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
+              e->last_use = ++image_clock;
+              *image = e->image;
+              return true;
             }
-          else
-            goto done;
+          victim = e;
           break;
         }
+      if (victim == NULL
+          || (victim->inode != NULL
+              && (e->inode == NULL || e->last_use < victim->last_use)))
+        victim = e;
+    }
+
+  if (!read_image (file, image))
+    return false;
+  if (victim->inode != inode)
+    {
+      inode_close (victim->inode);
+      victim->inode = inode_reopen (inode);
     }
+  victim->generation = inode_get_generation (inode);
+  victim->last_use = ++image_clock;
+  victim->image = *image;
+  return true;
+}
+
+/* Drops the cached image of the file named NAME, if any, closing
+   the inode that the cache holds open.  Call this before removing
+   the file, so that removal can free its sectors.  The caller
+   must hold filesys_lock. */
+void
+process_forget_image (const char *name)
+{
+  struct file *file;
+  struct inode *inode;
+  struct image_cache_entry *e;
+
+  ASSERT (lock_held_by_current_thread (&filesys_lock));
+  file = filesys_open (name);
+  if (file == NULL)
+    return;
+  inode = file_get_inode (file);
+  for (e = image_cache; e < image_cache + IMAGE_CACHE_SIZE; e++)
+    if (e->inode == inode)
+      {
+        inode_close (e->inode);
+        e->inode = NULL;
+      }
+  file_close (file);
+}
+
+/* Loads the ELF executable named FILE_NAME into the current
+   thread, passing it ARGS.
+   Stores the executable's entry point into *EIP
+   and its initial stack pointer into *ESP.
+   Returns true if successful, false otherwise. */
+static bool
+load (const char *file_name, const struct exec_args *args,
+      void (**eip) (void), void **esp) 
+{
+  struct thread *t = thread_current ();
+  struct exec_image image;
+  struct file *file = NULL;
+  bool success = false;
+  uint32_t code_low = UINT32_MAX, code_high = 0;
+  int i;
+
+  /* Allocate and activate page directory. */
+  t->pagedir = t->process->pagedir = pagedir_create ();
+  if (t->pagedir == NULL) 
+    return false;
+  process_activate ();
+#ifdef VM
+  /* Reserve the clock page, so that no area moves over it. */
+  if (page_add_area ((void *) CLOCK_PAGE_ADDR, 1, NULL, 0, 0, false)
+      == NULL)
+    goto done;
+#endif
+
+  /* Open executable file.  The file system lock is held until the
+     segments have all been set up. */
+  lock_acquire (&filesys_lock);
+  file = filesys_open (file_name);
+  if (file == NULL) 
+    {
+      printf ("load: %s: open failed\n", file_name);
+      goto done; 
+    }
+  if (!get_image (file, &image))
+    {
+      printf ("load: %s: error loading executable\n", file_name);
+      goto done; 
+    }
+
+  /* Set up the segments. */
+  for (i = 0; i < image.seg_cnt; i++) 
+    {
+      const struct Elf32_Phdr *phdr = &image.segs[i];
+      bool writable = (phdr->p_flags & PF_W) != 0;
+      uint32_t file_page = phdr->p_offset & ~PGMASK;
+      uint32_t mem_page = phdr->p_vaddr & ~PGMASK;
+      uint32_t page_offset = phdr->p_vaddr & PGMASK;
+      uint32_t read_bytes, zero_bytes;
+      if (phdr->p_filesz > 0)
+        {
+          /* Normal segment.
+             Read initial part from disk and zero the rest. */
+          read_bytes = page_offset + phdr->p_filesz;
+          zero_bytes = (ROUND_UP (page_offset + phdr->p_memsz, PGSIZE)
+                        - read_bytes);
+        }
+      else 
+        {
+          /* Entirely zero.
+             Don't read anything from disk. */
+          read_bytes = 0;
+          zero_bytes = ROUND_UP (page_offset + phdr->p_memsz, PGSIZE);
+        }
+      if (!load_segment (file, file_page, (void *) mem_page,
+                         read_bytes, zero_bytes, writable))
+        goto done;
+
+      /* Note the code's extent, for the profile. */
+      if ((phdr->p_flags & PF_X) != 0 && phdr->p_memsz > 0)
+        {
+          if (phdr->p_vaddr < code_low)
+            code_low = phdr->p_vaddr;
+          if (phdr->p_vaddr + phdr->p_memsz > code_high)
+            code_high = phdr->p_vaddr + phdr->p_memsz;
+        }
+
+      /* The heap starts after the last segment. */
+      if ((uint8_t *) mem_page + read_bytes + zero_bytes
+          > t->process->heap_start)
+        t->process->heap_start = t->process->brk
+          = (uint8_t *) mem_page + read_bytes + zero_bytes;
+    }
+
+  lock_release (&filesys_lock);
 
   /* Set up stack. */
-  if (!setup_stack (esp))
+  if (!setup_stack (esp, args))
     goto done;
 
   /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
+  *eip = (void (*) (void)) image.entry;
+
+  /* Start sampling, if asked.  A process that cannot get a
+     profile runs unprofiled. */
+  if (profile_user && code_low < code_high)
+    t->process->profile = profile_create (code_low, code_high);
 
   success = true;
 
  done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
+  /* We arrive here whether the load is successful or not.  The
+     executable stays open, denying writes, while it runs. */
+  if (!lock_held_by_current_thread (&filesys_lock))
+    lock_acquire (&filesys_lock);
+  if (success)
+    {
+      file_deny_write (file);
+      t->process->exec_file = file;
+    }
+  else
+    file_close (file);
+  lock_release (&filesys_lock);
   return success;
 }
-
+
 /* load() helpers. */
 
 static bool install_page (void *upage, void *kpage, bool writable);
 
+/* Obtains a page from the user pool, passing FLAGS on to the
+   allocator.  With virtual memory, the page is entered in the
+   frame table so that it can later be shared. */
+static void *
+alloc_user_page (enum palloc_flags flags) 
+{
+#ifdef VM
+  return frame_alloc (flags);
+#else
+  return palloc_get_page (PAL_USER | flags);
+#endif
+}
+
+/* Frees KPAGE, obtained from alloc_user_page(). */
+static void
+free_user_page (void *kpage) 
+{
+#ifdef VM
+  frame_free (kpage);
+#else
+  palloc_free_page (kpage);
+#endif
+}
+
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
 static bool
@@ -377,6 +1759,9 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With virtual memory, nothing is read yet: the segment becomes
+   an area whose pages page_in() brings in on first touch.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -387,6 +1772,23 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifdef VM
+  {
+    struct file *area_file = NULL;
+
+    bool success;
+
+    if (read_bytes > 0 && (area_file = file_reopen (file)) == NULL)
+      return false;
+
+    /* page_add_area() closes AREA_FILE itself on failure. */
+    lock_release (&filesys_lock);
+    success = page_add_area (upage, (read_bytes + zero_bytes) / PGSIZE,
+                             area_file, ofs, read_bytes, writable) != NULL;
+    lock_acquire (&filesys_lock);
+    return success;
+  }
+#else
   file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) 
     {
@@ -397,14 +1799,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
       /* Get a page of memory. */
-      uint8_t *kpage = palloc_get_page (PAL_USER);
+      uint8_t *kpage = alloc_user_page (0);
       if (kpage == NULL)
         return false;
 
       /* Load this page. */
       if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
         {
-          palloc_free_page (kpage);
+          free_user_page (kpage);
           return false; 
         }
       memset (kpage + page_read_bytes, 0, page_zero_bytes);
@@ -412,7 +1814,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       /* Add the page to the process's address space. */
       if (!install_page (upage, kpage, writable)) 
         {
-          palloc_free_page (kpage);
+          free_user_page (kpage);
           return false; 
         }
 
@@ -422,28 +1824,161 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       upage += PGSIZE;
     }
   return true;
+#endif
 }
 
-/* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+/* Creates the stack by mapping pages at the top of user virtual
+   memory, enough to hold ARGS, and copies its image there.  With
+   virtual memory, the stack grows from there on demand; see
+   page_add_stack(). */
 static bool
-setup_stack (void **esp) 
+setup_stack (void **esp, const struct exec_args *args) 
 {
+  size_t page_cnt = DIV_ROUND_UP (args->size, PGSIZE);
+  uint8_t *upage = PHYS_BASE;
+  size_t i;
+
+#ifdef VM
+  if (page_cnt > page_stack_max || !page_add_stack (page_cnt))
+    return false;
+#endif
+  for (i = 0; i < page_cnt; i++)
+    {
+      /* Only the lowest page is not wholly overwritten. */
+      uint8_t *kpage = alloc_user_page (i == page_cnt - 1 ? PAL_ZERO : 0);
+
+      upage -= PGSIZE;
+      if (kpage == NULL)
+        return false;
+      if (!install_page (upage, kpage, true))
+        {
+          free_user_page (kpage);
+          return false;
+        }
+#ifdef VM
+      frame_set_owner (kpage, upage);
+#endif
+    }
+
+  *esp = (uint8_t *) PHYS_BASE - args->size;
+  memcpy (*esp, args_end (args) - args->size, args->size);
+  return true;
+}
+
+/* Maps the stack for SLOT in process P, which must be running,
+   and copies the SIZE bytes at ARGS to its top.  Returns false if
+   memory is exhausted. */
+static bool
+alloc_thread_stack (struct process *p, int slot, const void *args,
+                    size_t size)
+{
+  uint8_t *upage = thread_stack_top (slot) - PGSIZE;
   uint8_t *kpage;
   bool success = false;
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL) 
+  ASSERT (size <= PGSIZE);
+
+#ifdef VM
+  lock_acquire (&p->vm_lock);
+  if (page_add_area (thread_stack_top (slot) - UTHREAD_STACK_PAGES * PGSIZE,
+                     UTHREAD_STACK_PAGES, NULL, 0, 0, true) == NULL)
+    {
+      lock_release (&p->vm_lock);
+      return false;
+    }
+#endif
+  kpage = alloc_user_page (PAL_ZERO);
+  if (kpage != NULL)
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
+      success = (pagedir_get_page (p->pagedir, upage) == NULL
+                 && pagedir_set_page (p->pagedir, upage, kpage, true));
       if (success)
-        *esp = PHYS_BASE;
+        {
+#ifdef VM
+          frame_set_owner (kpage, upage);
+#endif
+          memcpy (kpage + PGSIZE - size, args, size);
+        }
       else
-        palloc_free_page (kpage);
+        free_user_page (kpage);
     }
+#ifdef VM
+  if (!success)
+    page_remove_area (thread_stack_top (slot) - UTHREAD_STACK_PAGES * PGSIZE);
+  lock_release (&p->vm_lock);
+#endif
   return success;
 }
 
+/* Unmaps the stack for SLOT in process P, which must be running,
+   and frees its pages. */
+static void
+free_thread_stack (struct process *p, int slot)
+{
+#ifdef VM
+  lock_acquire (&p->vm_lock);
+  page_remove_area (thread_stack_top (slot) - UTHREAD_STACK_PAGES * PGSIZE);
+  lock_release (&p->vm_lock);
+#else
+  uint8_t *upage = thread_stack_top (slot) - PGSIZE;
+  void *kpage = pagedir_get_page (p->pagedir, upage);
+
+  if (kpage != NULL)
+    {
+      pagedir_clear_page (p->pagedir, upage);
+      free_user_page (kpage);
+    }
+#endif
+}
+
+#ifndef VM
+/* Unmaps and frees the pages of running process P from START up
+   to END. */
+static void
+free_heap_pages (struct process *p, uint8_t *start, uint8_t *end)
+{
+  uint8_t *upage;
+
+  for (upage = start; upage < end; upage += PGSIZE)
+    {
+      void *kpage = pagedir_get_page (p->pagedir, upage);
+
+      if (kpage != NULL)
+        {
+          pagedir_clear_page (p->pagedir, upage);
+          free_user_page (kpage);
+        }
+    }
+}
+
+/* Maps zeroed pages into the running process P, or frees them, so
+   that its heap ends at NEW_BRK instead of OLD_BRK.  Returns
+   false, changing nothing, if memory is exhausted or the heap
+   would run into pages already mapped. */
+static bool
+resize_heap (struct process *p, uint8_t *old_brk, uint8_t *new_brk)
+{
+  uint8_t *old_top = pg_round_up (old_brk);
+  uint8_t *new_top = pg_round_up (new_brk);
+  uint8_t *upage;
+
+  for (upage = old_top; upage < new_top; upage += PGSIZE)
+    {
+      uint8_t *kpage = alloc_user_page (PAL_ZERO);
+
+      if (kpage == NULL || !install_page (upage, kpage, true))
+        {
+          if (kpage != NULL)
+            free_user_page (kpage);
+          free_heap_pages (p, old_top, upage);
+          return false;
+        }
+    }
+  free_heap_pages (p, new_top, old_top);
+  return true;
+}
+#endif
+
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -1,11 +1,108 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <hash.h>
+#include <list.h>
+#include <rusage.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 
-tid_t process_execute (const char *file_name);
+struct spawn_action;
+struct exec_args;
+
+/* A child process, as seen by its parent.
+
+   The record is kept in a table keyed on the child's tid, so that
+   process_wait() finds it at once, and on one of its parent's two
+   lists: `children' while the child runs, `zombies' once it has
+   exited, so that process_wait_any() can take the first one that
+   did.  The parent frees the record when it collects the status;
+   if the parent exits first, the child frees it when it exits.
+   All of this is protected by a lock in process.c. */
+struct child
+  {
+    tid_t tid;                  /* Child's thread identifier. */
+    struct thread *parent;      /* Parent, or null once it exits. */
+    bool exited;                /* Has the child exited? */
+    int exit_status;            /* Valid once `exited' is true. */
+    struct rusage usage;        /* With its children's, once exited. */
+    struct hash_elem hash_elem; /* Element in the table of children. */
+    struct list_elem elem;      /* Element in parent's lists. */
+  };
+
+/* A user process: an address space and open files shared by one
+   or more threads.
+
+   The process's first thread is created by process_execute() or
+   process_fork(), and others by process_thread_create().  Each
+   thread refers to the process through its `process' member.  The
+   process lives until its last thread exits, which tears it down. */
+struct process
+  {
+    tid_t pid;                  /* Process id: the first thread's tid. */
+    uint32_t *pagedir;          /* Page directory. */
+    struct child *child;        /* This process's record in its parent. */
+    struct file *exec_file;     /* Executable, kept open to deny writes. */
+    uint8_t *heap_start;        /* Start of heap, after the executable. */
+    uint8_t *brk;               /* End of heap, as set by sbrk(). */
+
+    /* Resource usage.  Updated by the process's own threads and
+       the timer interrupt without locking, which on one CPU can
+       lose no more than an occasional count. */
+    struct rusage usage;        /* This process's own. */
+    struct rusage child_usage;  /* Children that have been waited for. */
+    struct profile *profile;    /* Sampled eips, with "-profile". */
+
+    /* Owned by userprog/syscall.c. */
+    struct fd_table *files;     /* Open files, indexed by descriptor. */
+
+    /* Owned by userprog/ring.c. */
+    struct ring_ctx *ring;      /* Submission ring, if any. */
+
+    /* Owned by userprog/shm.c. */
+    struct list shm_maps;       /* Mapped shared memory segments. */
+
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct list vm_areas;       /* Demand-paged areas, see vm/page.h. */
+    struct lock vm_lock;        /* Serializes changes to the address space. */
+#endif
+
+    /* Threads.  Protected by `lock'. */
+    struct lock lock;
+    int exit_status;            /* Status reported to the parent. */
+    bool exiting;               /* Set when the whole process must end. */
+    int thread_cnt;             /* Number of live threads. */
+    struct list threads;        /* Records of threads not yet joined. */
+    uint32_t stack_slots;       /* User thread stacks in use, one bit each. */
+  };
+
+/* Print each process's resource usage when it exits?  Set by
+   the kernel command-line option "-rusage". */
+extern bool process_print_rusage;
+
+void process_init (void);
+tid_t process_execute (const char *cmd_line);
+tid_t process_spawn (const char *file, struct exec_args *,
+                     const struct spawn_action *, int action_cnt);
+struct exec_args *process_args_create (void);
+char *process_args_add (struct exec_args *, size_t len);
+void process_args_destroy (struct exec_args *);
+void process_forget_image (const char *name);
+tid_t process_fork (const struct intr_frame *);
 int process_wait (tid_t);
+tid_t process_wait_any (int *status);
+int process_poll_children (void);
+bool process_get_rusage (int who, struct rusage *);
+void *process_sbrk (intptr_t increment);
+void process_end (int status) NO_RETURN;
 void process_exit (void);
 void process_activate (void);
 
+tid_t process_thread_create (void *eip, void *arg0, void *arg1);
+int process_thread_join (tid_t);
+void process_thread_exit (int status) NO_RETURN;
+
 #endif /* userprog/process.h */
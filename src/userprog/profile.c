@@ -0,0 +1,174 @@
+#include "userprog/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "userprog/process.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Sampling profiles of user processes.
+
+   With "-profile", the timer interrupt records the user eip that
+   it interrupted in a histogram of the process's code, one
+   counter per bucket of 2**shift bytes.  When the process exits,
+   the nonzero counters are written to a file named "prof-PID" in
+   the file system, as text:
+
+        pintos-profile 1
+        program NAME
+        range LOW HIGH
+        bucket SIZE
+        samples TOTAL OUTSIDE
+        ADDRESS COUNT
+        ...
+
+   where each ADDRESS is the start of a bucket and OUTSIDE counts
+   the samples that fell outside LOW...HIGH.  utils/pintos-prof
+   turns this into a flat profile by function, symbolized
+   against the program's ELF binary. */
+
+/* Most pages of counters per profile.  Programs whose code
+   needs more get bigger buckets. */
+#define PROFILE_MAX_PAGES 8
+
+/* Smallest bucket size, as a power of 2. */
+#define PROFILE_MIN_SHIFT 2
+
+bool profile_user;
+
+/* A histogram of sampled user eips. */
+struct profile
+  {
+    uint32_t low, high;         /* Code addresses covered. */
+    int shift;                  /* Log2 of the bytes per bucket. */
+    size_t bucket_cnt;          /* Number of buckets. */
+    size_t page_cnt;            /* Pages in `buckets'. */
+    uint32_t *buckets;          /* Sample counts. */
+    uint32_t total;             /* All samples. */
+    uint32_t outside;           /* Samples outside LOW...HIGH. */
+  };
+
+/* Returns a new, empty profile of the code from LOW up to HIGH,
+   or a null pointer if memory is exhausted. */
+struct profile *
+profile_create (uint32_t low, uint32_t high)
+{
+  struct profile *prof;
+
+  ASSERT (low < high);
+
+  prof = malloc (sizeof *prof);
+  if (prof == NULL)
+    return NULL;
+  prof->low = low;
+  prof->high = high;
+  prof->shift = PROFILE_MIN_SHIFT;
+  while (((high - low) >> prof->shift)
+         > PROFILE_MAX_PAGES * PGSIZE / sizeof *prof->buckets)
+    prof->shift++;
+  prof->bucket_cnt = ((high - low - 1) >> prof->shift) + 1;
+  prof->page_cnt = DIV_ROUND_UP (prof->bucket_cnt * sizeof *prof->buckets,
+                                 PGSIZE);
+  prof->buckets = palloc_get_multiple (PAL_ZERO, prof->page_cnt);
+  if (prof->buckets == NULL)
+    {
+      free (prof);
+      return NULL;
+    }
+  prof->total = prof->outside = 0;
+  return prof;
+}
+
+/* Returns a new, empty profile of the same code as PROF, for a
+   forked child, or a null pointer if memory is exhausted. */
+struct profile *
+profile_fork (const struct profile *prof)
+{
+  return profile_create (prof->low, prof->high);
+}
+
+/* Records a sample at user address EIP.  Called from the timer
+   interrupt. */
+void
+profile_sample (struct profile *prof, uint32_t eip)
+{
+  prof->total++;
+  if (eip >= prof->low && eip < prof->high)
+    prof->buckets[(eip - prof->low) >> prof->shift]++;
+  else
+    prof->outside++;
+}
+
+/* Writes PROF, the profile of process PID running the program
+   NAME, to the file "prof-PID", replacing any file by that name,
+   and reports it on the console. */
+void
+profile_write (const struct profile *prof, const char *name, int pid)
+{
+  char file_name[16];
+  struct file *file;
+  char *buf;
+  size_t size, len, i;
+  bool ok = false;
+
+  snprintf (file_name, sizeof file_name, "prof-%d", pid);
+
+  /* Each line of counts takes at most 22 bytes. */
+  size = 128 + strlen (name);
+  for (i = 0; i < prof->bucket_cnt; i++)
+    if (prof->buckets[i] != 0)
+      size += 22;
+  buf = malloc (size);
+  if (buf == NULL)
+    goto done;
+
+  len = snprintf (buf, size,
+                  "pintos-profile 1\nprogram %s\nrange %#"PRIx32" %#"PRIx32"\n"
+                  "bucket %d\nsamples %"PRIu32" %"PRIu32"\n",
+                  name, prof->low, prof->high, 1 << prof->shift,
+                  prof->total, prof->outside);
+  for (i = 0; i < prof->bucket_cnt; i++)
+    if (prof->buckets[i] != 0)
+      len += snprintf (buf + len, size - len, "%#"PRIx32" %"PRIu32"\n",
+                       prof->low + (uint32_t) (i << prof->shift),
+                       prof->buckets[i]);
+  ASSERT (len < size);
+
+  lock_acquire (&filesys_lock);
+  process_forget_image (file_name);
+  filesys_remove (file_name);
+  if (filesys_create (file_name, len))
+    {
+      file = filesys_open (file_name);
+      if (file != NULL)
+        {
+          ok = file_write (file, buf, len) == (off_t) len;
+          file_close (file);
+        }
+    }
+  lock_release (&filesys_lock);
+  free (buf);
+
+ done:
+  if (ok)
+    printf ("%s: profile: %"PRIu32" samples written to %s\n",
+            name, prof->total, file_name);
+  else
+    printf ("%s: profile: could not write %s\n", name, file_name);
+}
+
+/* Frees PROF. */
+void
+profile_destroy (struct profile *prof)
+{
+  if (prof != NULL)
+    {
+      palloc_free_multiple (prof->buckets, prof->page_cnt);
+      free (prof);
+    }
+}
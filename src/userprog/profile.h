@@ -0,0 +1,17 @@
+#ifndef USERPROG_PROFILE_H
+#define USERPROG_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Profile every user process?  Set by the kernel command-line
+   option "-profile". */
+extern bool profile_user;
+
+struct profile *profile_create (uint32_t low, uint32_t high);
+struct profile *profile_fork (const struct profile *);
+void profile_sample (struct profile *, uint32_t eip);
+void profile_write (const struct profile *, const char *name, int pid);
+void profile_destroy (struct profile *);
+
+#endif /* userprog/profile.h */
@@ -0,0 +1,517 @@
+#include "userprog/ring.h"
+#include <debug.h>
+#include <ring.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "devices/timer.h"
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* Submission and completion rings; see lib/ring.h for the
+   interface.
+
+   The ring lives in kernel pages that are mapped into the
+   process at the address it asks for, so the kernel reads
+   requests and writes completions through its own mapping,
+   without faults.  Requests are carried out either by the
+   process itself in ring_enter() or, with RING_SQPOLL, by a
+   poller thread.
+
+   The poller is a kernel thread that runs on the process's page
+   directory and uses the process's file descriptors.  It cannot
+   bring in pages for the process, so before each request it
+   checks, with the process's address space locked, that every
+   page the request touches is present and, if the request writes
+   it, writable.  If not, the poller leaves the request in the SQ
+   and goes to sleep, and the next ring_enter() carries it out in
+   the process, where page faults work as usual.
+
+   The process can write anything anywhere in the ring, so the
+   kernel trusts nothing it reads there except as data: it finds
+   the queues from its own copy of the ring's size, and keeps its
+   own copies of the indexes it owns, sq_head and cq_tail, which
+   it only publishes to the ring.
+
+   A child created by fork() does not inherit the ring. */
+
+/* Ticks that the poller spins on an empty SQ before sleeping. */
+#define POLL_IDLE_TICKS (TIMER_FREQ / 100 + 1)
+
+/* Kernel state for a ring. */
+struct ring_ctx
+  {
+    struct ring *ring;          /* Kernel mapping of the ring. */
+    uint8_t *uaddr;             /* User mapping of the ring. */
+    size_t page_cnt;            /* Size of ring, in pages. */
+    uint32_t entries;           /* Entries in each queue. */
+    struct process *owner;      /* Process that set up the ring. */
+    uint32_t sq_head;           /* Next SQE to take. */
+    uint32_t cq_tail;           /* Next CQE to fill. */
+
+    /* Carrying out requests, by the process or the poller. */
+    struct lock lock;           /* Serializes taking requests. */
+    struct condition completed; /* Signaled when CQEs are posted. */
+
+    /* Poller. */
+    bool polling;               /* Whether there is a poller. */
+    bool asleep;                /* Poller is asleep, or will be. */
+    bool stop;                  /* Poller should exit. */
+    struct semaphore wakeup;    /* Upped to wake the poller. */
+    struct semaphore exited;    /* Upped when the poller exits. */
+  };
+
+static thread_func poller NO_RETURN;
+static int run (struct ring_ctx *, bool polling, uint32_t max);
+static bool execute (struct ring_ctx *, const struct ring_sqe *,
+                     bool polling, int32_t *res);
+static bool is_resident (struct ring_ctx *, const void *, size_t,
+                         bool write);
+static void undo_setup (void);
+static bool ring_map (struct process *);
+static void ring_unmap (struct process *);
+
+/* Returns CTX's SQEs. */
+static struct ring_sqe *
+sqes (struct ring_ctx *ctx)
+{
+  return (struct ring_sqe *) (ctx->ring + 1);
+}
+
+/* Returns CTX's CQEs. */
+static struct ring_cqe *
+cqes (struct ring_ctx *ctx)
+{
+  return (struct ring_cqe *) (sqes (ctx) + ctx->entries);
+}
+
+/* Sets up a ring of ENTRIES entries in each queue for the current
+   process, mapped at user address UADDR, which must be page
+   aligned, with FLAGS a set of RING_* flags.  Returns 0 if
+   successful, -1 on failure. */
+int
+ring_setup (void *uaddr, unsigned entries, unsigned flags)
+{
+  struct thread *t = thread_current ();
+  struct process *p = t->process;
+  struct ring_ctx *ctx;
+  bool mapped;
+  size_t i;
+
+  if (p->ring != NULL || pg_ofs (uaddr) != 0 || uaddr == NULL
+      || entries == 0 || entries > RING_MAX_ENTRIES
+      || (entries & (entries - 1)) != 0 || (flags & ~RING_SQPOLL) != 0)
+    return -1;
+
+  ctx = malloc (sizeof *ctx);
+  if (ctx == NULL)
+    return -1;
+  ctx->ring = NULL;
+  ctx->uaddr = uaddr;
+  ctx->page_cnt = DIV_ROUND_UP (RING_SIZE (entries), PGSIZE);
+  ctx->entries = entries;
+  ctx->owner = p;
+  lock_init (&ctx->lock);
+  cond_init (&ctx->completed);
+  ctx->sq_head = ctx->cq_tail = 0;
+  ctx->polling = false;
+  ctx->asleep = false;
+  ctx->stop = false;
+  sema_init (&ctx->wakeup, 0);
+  sema_init (&ctx->exited, 0);
+
+  /* Reserve the address range and map the ring into it. */
+#ifdef VM
+  lock_acquire (&p->vm_lock);
+#endif
+  if ((uintptr_t) uaddr + ctx->page_cnt * PGSIZE > (uintptr_t) PHYS_BASE
+      || (uintptr_t) uaddr + ctx->page_cnt * PGSIZE < (uintptr_t) uaddr)
+    goto fail;
+  for (i = 0; i < ctx->page_cnt; i++)
+    if (pagedir_get_page (p->pagedir, ctx->uaddr + i * PGSIZE) != NULL)
+      goto fail;
+  ctx->ring = palloc_get_multiple (PAL_ZERO, ctx->page_cnt);
+  if (ctx->ring == NULL)
+    goto fail;
+#ifdef VM
+  if (page_add_area (uaddr, ctx->page_cnt, NULL, 0, 0, true) == NULL)
+    goto fail;
+#endif
+  ctx->ring->entries = entries;
+  p->ring = ctx;
+  mapped = ring_map (p);
+#ifdef VM
+  lock_release (&p->vm_lock);
+#endif
+  if (!mapped)
+    {
+      undo_setup ();
+      return -1;
+    }
+
+  if (flags & RING_SQPOLL)
+    {
+      ctx->polling = true;
+      if (thread_create (t->name, t->priority, poller, ctx) == TID_ERROR)
+        {
+          ctx->polling = false;
+          undo_setup ();
+          return -1;
+        }
+    }
+  return 0;
+
+ fail:
+#ifdef VM
+  lock_release (&p->vm_lock);
+#endif
+  if (ctx->ring != NULL)
+    palloc_free_multiple (ctx->ring, ctx->page_cnt);
+  free (ctx);
+  return -1;
+}
+
+/* Destroys the ring that ring_setup() has just set up for the
+   current process, and gives up the address range that it
+   reserved. */
+static void
+undo_setup (void)
+{
+#ifdef VM
+  struct process *p = thread_current ()->process;
+
+  /* Unmap the ring first, or else removing the area would free
+     the ring's pages as if they were the area's own. */
+  lock_acquire (&p->vm_lock);
+  ring_unmap (p);
+  page_remove_area (p->ring->uaddr);
+  lock_release (&p->vm_lock);
+#endif
+  ring_exit ();
+}
+
+/* Carries out up to TO_SUBMIT requests from the current
+   process's SQ.  With a poller, wakes the poller instead if it
+   is awake, and then waits until at least MIN_COMPLETE
+   completions are in the CQ, or the poller runs out of requests.
+   Returns the number of requests taken from the SQ by this call,
+   or -1 if the process has no ring. */
+int
+ring_enter (unsigned to_submit, unsigned min_complete)
+{
+  struct ring_ctx *ctx = thread_current ()->process->ring;
+  struct ring *r;
+  int cnt = 0;
+
+  if (ctx == NULL)
+    return -1;
+  r = ctx->ring;
+
+  lock_acquire (&ctx->lock);
+  if (!ctx->polling || ctx->asleep)
+    {
+      /* Take the requests ourselves, since the poller, if any,
+         might have gone to sleep because it was stuck on one. */
+      lock_release (&ctx->lock);
+      cnt = run (ctx, false, to_submit);
+      lock_acquire (&ctx->lock);
+      if (ctx->polling && ctx->asleep)
+        {
+          ctx->asleep = false;
+          r->flags &= ~RING_NEED_WAKEUP;
+          sema_up (&ctx->wakeup);
+        }
+    }
+
+  if (ctx->polling)
+    {
+      if (min_complete > ctx->entries)
+        min_complete = ctx->entries;
+      while (ctx->cq_tail - r->cq_head < min_complete && !ctx->asleep
+             && ctx->sq_head != r->sq_tail)
+        if (!cond_wait_interruptible (&ctx->completed, &ctx->lock))
+          break;
+    }
+  lock_release (&ctx->lock);
+  return cnt;
+}
+
+/* Removes P's ring, if any, from P's page directory. */
+static void
+ring_unmap (struct process *p)
+{
+  size_t i;
+
+  if (p->ring != NULL)
+    for (i = 0; i < p->ring->page_cnt; i++)
+      pagedir_clear_page (p->pagedir, p->ring->uaddr + i * PGSIZE);
+}
+
+/* Maps P's ring, if any, into P's page directory, as pages that
+   fork() does not copy.  Returns false if memory for page tables
+   is exhausted. */
+static bool
+ring_map (struct process *p)
+{
+  struct ring_ctx *ctx = p->ring;
+  size_t i;
+
+  if (ctx != NULL)
+    for (i = 0; i < ctx->page_cnt; i++)
+      if (!pagedir_set_shared_page (p->pagedir, ctx->uaddr + i * PGSIZE,
+                                    (uint8_t *) ctx->ring + i * PGSIZE,
+                                    true))
+        return false;
+  return true;
+}
+
+/* Destroys the current process's ring, if any, stopping its
+   poller. */
+void
+ring_exit (void)
+{
+  struct process *p = thread_current ()->process;
+  struct ring_ctx *ctx = p->ring;
+
+  if (ctx == NULL)
+    return;
+
+  /* We may be dying in the middle of a request. */
+  if (lock_held_by_current_thread (&ctx->lock))
+    lock_release (&ctx->lock);
+
+  if (ctx->polling)
+    {
+      lock_acquire (&ctx->lock);
+      ctx->stop = true;
+      if (ctx->asleep)
+        sema_up (&ctx->wakeup);
+      lock_release (&ctx->lock);
+      sema_down (&ctx->exited);
+    }
+
+  ring_unmap (p);
+  p->ring = NULL;
+  palloc_free_multiple (ctx->ring, ctx->page_cnt);
+  free (ctx);
+}
+
+/* Poller thread for ring CTX_. */
+static void
+poller (void *ctx_)
+{
+  struct ring_ctx *ctx = ctx_;
+  struct thread *t = thread_current ();
+  struct ring *r = ctx->ring;
+  int64_t idle_start = timer_ticks ();
+
+  /* Run in the process, so that its user addresses and files are
+     ours, though we are not one of its threads. */
+  t->process = ctx->owner;
+  t->pagedir = ctx->owner->pagedir;
+  process_activate ();
+
+  lock_acquire (&ctx->lock);
+  while (!ctx->stop)
+    {
+      bool stuck = false;
+
+      lock_release (&ctx->lock);
+      if (ctx->sq_head != r->sq_tail)
+        {
+          if (run (ctx, true, UINT32_MAX) > 0)
+            idle_start = timer_ticks ();
+          else
+            stuck = ctx->sq_head != r->sq_tail;
+        }
+      lock_acquire (&ctx->lock);
+      if (ctx->stop)
+        break;
+
+      if (stuck || timer_elapsed (idle_start) >= POLL_IDLE_TICKS)
+        {
+          /* Sleep until ring_enter().  Let the process know first,
+             and wake any ring_enter() waiting for us. */
+          ctx->asleep = true;
+          r->flags |= RING_NEED_WAKEUP;
+          cond_broadcast (&ctx->completed, &ctx->lock);
+          lock_release (&ctx->lock);
+          sema_down (&ctx->wakeup);
+          lock_acquire (&ctx->lock);
+          idle_start = timer_ticks ();
+        }
+      else
+        {
+          lock_release (&ctx->lock);
+          thread_yield ();
+          lock_acquire (&ctx->lock);
+        }
+    }
+  lock_release (&ctx->lock);
+
+  /* Don't let process_exit() take us for one of the process's
+     threads. */
+  t->process = NULL;
+  t->pagedir = NULL;
+  process_activate ();
+  sema_up (&ctx->exited);
+  thread_exit ();
+}
+
+/* Takes up to MAX requests from CTX's SQ, as many as there is
+   room for in its CQ, and carries them out, as the poller if
+   POLLING is true, or as the owning process otherwise.  Returns
+   the number of requests carried out.  The poller stops at the
+   first request it cannot carry out without a page fault. */
+static int
+run (struct ring_ctx *ctx, bool polling, uint32_t max)
+{
+  struct ring *r = ctx->ring;
+  uint32_t mask = ctx->entries - 1;
+  int cnt = 0;
+
+  lock_acquire (&ctx->lock);
+  while ((uint32_t) cnt < max && ctx->sq_head != r->sq_tail
+         && ctx->cq_tail - r->cq_head < ctx->entries)
+    {
+      struct ring_sqe sqe;
+      struct ring_cqe *cqe;
+      int32_t res;
+
+      /* Copy the request, so that the process cannot change it
+         while we work on it. */
+      barrier ();
+      sqe = sqes (ctx)[ctx->sq_head & mask];
+      if (!execute (ctx, &sqe, polling, &res))
+        break;
+
+      cqe = &cqes (ctx)[ctx->cq_tail & mask];
+      cqe->user_data = sqe.user_data;
+      cqe->res = res;
+      barrier ();
+      r->cq_tail = ++ctx->cq_tail;
+      r->sq_head = ++ctx->sq_head;
+      cnt++;
+    }
+  if (cnt > 0)
+    cond_broadcast (&ctx->completed, &ctx->lock);
+  lock_release (&ctx->lock);
+  return cnt;
+}
+
+/* Carries out request SQE for CTX's process, storing its result
+   in *RES.  Returns true if successful, false if POLLING is true
+   and the request would fault.  The caller must hold CTX's
+   lock. */
+static bool
+execute (struct ring_ctx *ctx, const struct ring_sqe *sqe, bool polling,
+         int32_t *res)
+{
+  struct process *p = ctx->owner;
+  bool write = sqe->op == RING_WRITE;
+  bool success = true;
+
+#ifdef VM
+  /* Keep the process's pages where they are while we use
+     them. */
+  if (polling)
+    lock_acquire (&p->vm_lock);
+#endif
+
+  *res = -1;
+  switch (sqe->op)
+    {
+    case RING_NOP:
+      *res = 0;
+      break;
+
+    case RING_READ:
+    case RING_WRITE:
+      {
+        off_t pos = sqe->offset;
+
+        if ((uintptr_t) sqe->buf + sqe->len > (uintptr_t) PHYS_BASE
+            || (uintptr_t) sqe->buf + sqe->len < (uintptr_t) sqe->buf
+            || ((sqe->flags & RING_F_OFFSET) && pos < 0))
+          break;
+        if (polling && !is_resident (ctx, sqe->buf, sqe->len, !write))
+          {
+            success = false;
+            break;
+          }
+        *res = syscall_transfer (p, sqe->fd, sqe->buf, sqe->len,
+                                 sqe->flags & RING_F_OFFSET ? &pos : NULL,
+                                 write);
+      }
+      break;
+
+    case RING_OPEN:
+      {
+        char name[NAME_MAX + 2];
+        size_t len;
+
+        /* Copy in the file name a byte at a time, because it may
+           end just before an unmapped page. */
+        for (len = 0; len < sizeof name; len++)
+          {
+            const char *p = (const char *) sqe->buf + len;
+
+            if (!is_user_vaddr (p))
+              break;
+            if (polling && !is_resident (ctx, p, 1, false))
+              {
+                success = false;
+                break;
+              }
+            if (!copy_in (&name[len], p, 1) || name[len] == '\0')
+              break;
+          }
+        if (success && len < sizeof name && name[len] == '\0')
+          *res = syscall_open (p, name);
+      }
+      break;
+
+    case RING_CLOSE:
+      *res = syscall_close (p, sqe->fd);
+      break;
+
+    case RING_FSYNC:
+      *res = syscall_fsync (p, sqe->fd);
+      break;
+    }
+
+#ifdef VM
+  if (polling)
+    lock_release (&p->vm_lock);
+#endif
+  return success;
+}
+
+/* Returns true if the SIZE bytes at user address UADDR are all
+   in memory in CTX's process, and writable if WRITE is true. */
+static bool
+is_resident (struct ring_ctx *ctx, const void *uaddr, size_t size,
+             bool write)
+{
+  uint32_t *pd = ctx->owner->pagedir;
+  const uint8_t *p;
+
+  if (size == 0)
+    return true;
+  for (p = pg_round_down (uaddr); p < (const uint8_t *) uaddr + size;
+       p += PGSIZE)
+    if (pagedir_get_page (pd, p) == NULL
+        || (write && !pagedir_is_writable (pd, p)))
+      return false;
+  return true;
+}
@@ -0,0 +1,12 @@
+#ifndef USERPROG_RING_H
+#define USERPROG_RING_H
+
+#include <stdbool.h>
+
+struct process;
+
+int ring_setup (void *uaddr, unsigned entries, unsigned flags);
+int ring_enter (unsigned to_submit, unsigned min_complete);
+void ring_exit (void);
+
+#endif /* userprog/ring.h */
@@ -0,0 +1,405 @@
+#include "userprog/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
+
+/* Shared memory segments.
+
+   A segment is a set of user frames that any number of processes
+   may map, each at an address of its choosing, so that data
+   written by one is seen by the others without being copied.  A
+   segment is created by shm_open() under a name that other
+   processes can open it by, until shm_unlink() removes the name.
+
+   A segment counts its mappings, in every process, plus one for
+   its name.  Its frames go back to the user pool when the count
+   drops to 0, that is, after the last unmap of an unlinked
+   segment.  The frames are never evicted.
+
+   Like the submission ring, a mapping is only ever present in
+   the page directory: the page directory code does not know that
+   the frames are shared, so a mapping is cleared before the page
+   directory is destroyed or forked.  A child created by fork()
+   gets its own mappings of its parent's segments, at the same
+   addresses. */
+
+/* A shared memory segment. */
+struct shm_segment
+  {
+    int id;                     /* Segment id. */
+    char name[SHM_NAME_MAX + 1]; /* Name, while linked. */
+    bool linked;                /* Can it be opened by name? */
+    int ref_cnt;                /* Mappings, plus 1 while linked. */
+    size_t page_cnt;            /* Number of frames. */
+    void **pages;               /* Kernel addresses of frames. */
+    struct list_elem elem;      /* Element in `segments'. */
+  };
+
+/* A segment mapped into a process. */
+struct shm_mapping
+  {
+    struct shm_segment *seg;    /* Segment. */
+    uint8_t *uaddr;             /* User address of first page. */
+    struct list_elem elem;      /* Element in process's `shm_maps'. */
+  };
+
+/* All segments that exist, and the lock that protects them,
+   their reference counts, and every process's mappings. */
+static struct list segments;
+static struct lock shm_lock;
+static int next_id;
+
+static struct shm_segment *segment_create (const char *name,
+                                           size_t page_cnt);
+static void segment_release (struct shm_segment *);
+static void free_pages (void **pages, size_t page_cnt);
+static void clear_pages (uint32_t *pd, struct shm_mapping *);
+
+/* Initializes the shared memory module. */
+void
+shm_init (void) 
+{
+  list_init (&segments);
+  lock_init (&shm_lock);
+}
+
+/* Returns the linked segment named NAME, or a null pointer if
+   there is none.  shm_lock must be held. */
+static struct shm_segment *
+find_by_name (const char *name)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&segments); e != list_end (&segments);
+       e = list_next (e))
+    {
+      struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+      if (seg->linked && !strcmp (seg->name, name))
+        return seg;
+    }
+  return NULL;
+}
+
+/* Returns the segment with the given ID, or a null pointer if
+   there is none.  shm_lock must be held. */
+static struct shm_segment *
+find_by_id (int id)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&segments); e != list_end (&segments);
+       e = list_next (e))
+    {
+      struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+      if (seg->id == id)
+        return seg;
+    }
+  return NULL;
+}
+
+/* Returns the id of the segment named NAME, a kernel string,
+   creating it with SIZE bytes of zeros if there is none.  An
+   existing segment must have at least SIZE bytes.  Returns -1 if
+   NAME is too long, or if the segment does not exist and SIZE is
+   0, is too big, or cannot be allocated. */
+int
+shm_open (const char *name, size_t size)
+{
+  size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  struct shm_segment *seg;
+  int id = -1;
+
+  if (strlen (name) > SHM_NAME_MAX || page_cnt > SHM_MAX_PAGES)
+    return -1;
+
+  lock_acquire (&shm_lock);
+  seg = find_by_name (name);
+  if (seg != NULL)
+    {
+      if (page_cnt <= seg->page_cnt)
+        id = seg->id;
+    }
+  else if (page_cnt > 0)
+    {
+      seg = segment_create (name, page_cnt);
+      if (seg != NULL)
+        id = seg->id;
+    }
+  lock_release (&shm_lock);
+  return id;
+}
+
+/* Returns true if the PAGE_CNT pages starting at UPAGE are valid
+   user addresses with nothing mapped in P. */
+static bool
+range_is_free (struct process *p, uint8_t *upage, size_t page_cnt)
+{
+  size_t i;
+
+  if (upage == NULL || pg_ofs (upage) != 0
+      || (uintptr_t) upage + page_cnt * PGSIZE > (uintptr_t) PHYS_BASE
+      || (uintptr_t) upage + page_cnt * PGSIZE < (uintptr_t) upage)
+    return false;
+  for (i = 0; i < page_cnt; i++)
+    if (pagedir_get_page (p->pagedir, upage + i * PGSIZE) != NULL)
+      return false;
+  return true;
+}
+
+/* Maps segment SHMID into the current process at UADDR, which
+   must be page-aligned, with the pages it covers unused.  Returns
+   UADDR if successful, or a null pointer on failure. */
+void *
+shm_map (int shmid, void *uaddr)
+{
+  struct process *p = thread_current ()->process;
+  struct shm_segment *seg;
+  struct shm_mapping *m;
+  void *retval = NULL;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return NULL;
+#ifdef VM
+  lock_acquire (&p->vm_lock);
+#endif
+  lock_acquire (&shm_lock);
+  seg = find_by_id (shmid);
+  if (seg != NULL && range_is_free (p, uaddr, seg->page_cnt))
+    {
+      size_t i;
+
+      m->seg = seg;
+      m->uaddr = uaddr;
+#ifdef VM
+      /* Reserve the range, so that no other area moves in. */
+      if (page_add_area (uaddr, seg->page_cnt, NULL, 0, 0, true) == NULL)
+        goto done;
+#endif
+      for (i = 0; i < seg->page_cnt; i++)
+        if (!pagedir_set_shared_page (p->pagedir, m->uaddr + i * PGSIZE,
+                                      seg->pages[i], true))
+          {
+            clear_pages (p->pagedir, m);
+#ifdef VM
+            page_remove_area (uaddr);
+#endif
+            goto done;
+          }
+      seg->ref_cnt++;
+      list_push_back (&p->shm_maps, &m->elem);
+      retval = uaddr;
+      m = NULL;
+    }
+ done:
+  lock_release (&shm_lock);
+#ifdef VM
+  lock_release (&p->vm_lock);
+#endif
+  free (m);
+  return retval;
+}
+
+/* Unmaps the segment mapped at UADDR in the current process.
+   Returns false if no segment is mapped there. */
+bool
+shm_unmap (void *uaddr)
+{
+  struct process *p = thread_current ()->process;
+  struct list_elem *e;
+  bool found = false;
+
+#ifdef VM
+  lock_acquire (&p->vm_lock);
+#endif
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&p->shm_maps); e != list_end (&p->shm_maps);
+       e = list_next (e))
+    {
+      struct shm_mapping *m = list_entry (e, struct shm_mapping, elem);
+      if (m->uaddr == uaddr)
+        {
+          clear_pages (p->pagedir, m);
+#ifdef VM
+          page_remove_area (uaddr);
+#endif
+          list_remove (e);
+          segment_release (m->seg);
+          free (m);
+          found = true;
+          break;
+        }
+    }
+  lock_release (&shm_lock);
+#ifdef VM
+  lock_release (&p->vm_lock);
+#endif
+  return found;
+}
+
+/* Removes NAME, a kernel string, from the segments that can be
+   opened.  The segment lives on until its last mapping is
+   unmapped.  Returns false if there is no segment named NAME. */
+bool
+shm_unlink (const char *name)
+{
+  struct shm_segment *seg;
+
+  lock_acquire (&shm_lock);
+  seg = find_by_name (name);
+  if (seg != NULL)
+    {
+      seg->linked = false;
+      segment_release (seg);
+    }
+  lock_release (&shm_lock);
+  return seg != NULL;
+}
+
+/* Gives CHILD, a new copy of PARENT made by fork(), the same
+   mappings of segments as PARENT.  Returns false if memory is
+   exhausted, in which case CHILD may have some of them; they are
+   released by shm_exit(). */
+bool
+shm_fork (struct process *parent, struct process *child)
+{
+  struct list_elem *e;
+  bool ok = true;
+
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&parent->shm_maps);
+       ok && e != list_end (&parent->shm_maps); e = list_next (e))
+    {
+      struct shm_mapping *pm = list_entry (e, struct shm_mapping, elem);
+      struct shm_mapping *cm = malloc (sizeof *cm);
+      size_t i;
+
+      if (cm == NULL)
+        {
+          ok = false;
+          break;
+        }
+      cm->seg = pm->seg;
+      cm->uaddr = pm->uaddr;
+      for (i = 0; i < cm->seg->page_cnt; i++)
+        if (!pagedir_set_shared_page (child->pagedir,
+                                      cm->uaddr + i * PGSIZE,
+                                      cm->seg->pages[i], true))
+          ok = false;
+      cm->seg->ref_cnt++;
+      list_push_back (&child->shm_maps, &cm->elem);
+    }
+  lock_release (&shm_lock);
+  return ok;
+}
+
+/* Unmaps all of P's segments, before P's page directory is
+   destroyed. */
+void
+shm_exit (struct process *p)
+{
+  lock_acquire (&shm_lock);
+  while (!list_empty (&p->shm_maps))
+    {
+      struct shm_mapping *m = list_entry (list_pop_front (&p->shm_maps),
+                                          struct shm_mapping, elem);
+      if (p->pagedir != NULL)
+        clear_pages (p->pagedir, m);
+      segment_release (m->seg);
+      free (m);
+    }
+  lock_release (&shm_lock);
+}
+
+/* Creates and returns a linked segment named NAME with PAGE_CNT
+   pages of zeros, or returns a null pointer if memory is
+   exhausted.  shm_lock must be held. */
+static struct shm_segment *
+segment_create (const char *name, size_t page_cnt)
+{
+  struct shm_segment *seg = malloc (sizeof *seg);
+  size_t i;
+
+  if (seg == NULL)
+    return NULL;
+  seg->pages = malloc (page_cnt * sizeof *seg->pages);
+  if (seg->pages == NULL)
+    {
+      free (seg);
+      return NULL;
+    }
+  for (i = 0; i < page_cnt; i++)
+    {
+#ifdef VM
+      seg->pages[i] = frame_alloc (PAL_ZERO);
+#else
+      seg->pages[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+#endif
+      if (seg->pages[i] == NULL)
+        {
+          free_pages (seg->pages, i);
+          free (seg);
+          return NULL;
+        }
+    }
+  seg->id = next_id++;
+  strlcpy (seg->name, name, sizeof seg->name);
+  seg->linked = true;
+  seg->ref_cnt = 1;
+  seg->page_cnt = page_cnt;
+  list_push_back (&segments, &seg->elem);
+  return seg;
+}
+
+/* Drops a reference to SEG, freeing it and its frames once none
+   remain.  shm_lock must be held. */
+static void
+segment_release (struct shm_segment *seg)
+{
+  ASSERT (seg->ref_cnt > 0);
+  if (--seg->ref_cnt > 0)
+    return;
+
+  list_remove (&seg->elem);
+  free_pages (seg->pages, seg->page_cnt);
+  free (seg);
+}
+
+/* Returns the PAGE_CNT frames in PAGES to the user pool, then
+   frees PAGES itself. */
+static void
+free_pages (void **pages, size_t page_cnt)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+#ifdef VM
+    frame_free (pages[i]);
+#else
+    palloc_free_page (pages[i]);
+#endif
+  free (pages);
+}
+
+/* Clears M's mapping from PD. */
+static void
+clear_pages (uint32_t *pd, struct shm_mapping *m)
+{
+  size_t i;
+
+  for (i = 0; i < m->seg->page_cnt; i++)
+    pagedir_clear_page (pd, m->uaddr + i * PGSIZE);
+}
@@ -0,0 +1,21 @@
+#ifndef USERPROG_SHM_H
+#define USERPROG_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct process;
+
+/* Longest segment name, and largest segment, in pages. */
+#define SHM_NAME_MAX 31
+#define SHM_MAX_PAGES 1024
+
+void shm_init (void);
+int shm_open (const char *name, size_t size);
+void *shm_map (int shmid, void *uaddr);
+bool shm_unmap (void *uaddr);
+bool shm_unlink (const char *name);
+bool shm_fork (struct process *parent, struct process *child);
+void shm_exit (struct process *);
+
+#endif /* userprog/shm.h */
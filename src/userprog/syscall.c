@@ -1,20 +1,1832 @@
 #include "userprog/syscall.h"
+#include <bitmap.h>
 #include <stdio.h>
+#include <string.h>
+#include <iovec.h>
+#include <poll.h>
+#include <round.h>
+#include <rusage.h>
+#include <stddef.h>
+#include <spawn.h>
 #include <syscall-nr.h>
+#include "userprog/futex.h"
+#include "userprog/pipe.h"
+#include "userprog/process.h"
+#include "userprog/ring.h"
+#include "userprog/shm.h"
+#include "devices/block.h"
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/pollq.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* An open file, one end of a pipe, or the console.
+
+   A process's threads share its file descriptors, and so does the
+   kernel thread that may service its submission ring (see
+   userprog/ring.c).  So that one cannot close a file out from
+   under another, each user of a
+   file descriptor holds a reference to it, obtained from
+   fd_get(), and the last to let go with fd_put() closes it.
+   dup() and dup2() put the same file_desc in more than one slot
+   of a table, each of which holds a reference too. */
+struct file_desc
+  {
+    struct file *file;          /* File, or null. */
+    struct pipe *pipe;          /* Pipe, or null. */
+    bool writer;                /* Write end of pipe or console? */
+    int ref_cnt;                /* 1 per table slot, 1 per user. */
+    struct file_desc *copy;     /* Child's copy, during fork(). */
+  };
+
+/* A process's file descriptor table: an array indexed by file
+   descriptor, with a bitmap of the slots in use for finding a
+   free one.  The array doubles in size as needed.
+
+   Descriptors 0 and 1 refer to the console while their slots are
+   empty, and ordinary allocation starts at 2, so they only come
+   into use through dup2(), e.g. to redirect a child's output
+   into a pipe. */
+struct fd_table
+  {
+    struct file_desc **slots;   /* Indexed by file descriptor. */
+    struct bitmap *used;        /* Slots in use. */
+    size_t size;                /* Number of slots. */
+    size_t first_free;          /* No free slot from 2 up to here. */
+  };
+
+/* Initial and largest size of a file descriptor table. */
+#define FD_TABLE_MIN 16
+#define FD_TABLE_MAX 8192
+
+/* The console, in and out.  Each has a permanent reference. */
+static struct file_desc console_in, console_out;
+
+/* Protects file descriptor tables and reference counts. */
+static struct lock fd_lock;
+
+/* A system call implementation.  Each one actually takes between
+   0 and 4 arguments of its own types, all passed as 32-bit words,
+   and returns a value that fits in EAX. */
+typedef int syscall_function (int, int, int, int);
+
+/* A system call. */
+struct syscall
+  {
+    size_t arg_cnt;             /* Number of arguments. */
+    syscall_function *func;     /* Implementation. */
+  };
+
+static void sys_halt (void) NO_RETURN;
+static void sys_exit (int status) NO_RETURN;
+static tid_t sys_exec (const char *ucmd_line);
+static int sys_wait (tid_t);
+static bool sys_create (const char *ufile, unsigned initial_size);
+static bool sys_remove (const char *ufile);
+static int sys_open (const char *ufile);
+static int sys_filesize (int fd);
+static int sys_read (int fd, void *ubuffer, unsigned size);
+static int sys_write (int fd, const void *ubuffer, unsigned size);
+static void sys_seek (int fd, unsigned position);
+static unsigned sys_tell (int fd);
+static void sys_close (int fd);
+#ifdef VM
+static int sys_mmap (int fd, void *addr);
+static void sys_munmap (int mapid);
+#endif
+static bool sys_chdir (const char *udir);
+static bool sys_mkdir (const char *udir);
+static bool sys_readdir (int fd, char *uname);
+static bool sys_isdir (int fd);
+static int sys_inumber (int fd);
+static tid_t sys_fork (void);
+static tid_t sys_getpid (void);
+static int sys_readv (int fd, const struct iovec *uiov, int iovcnt);
+static int sys_writev (int fd, const struct iovec *uiov, int iovcnt);
+static int sys_pread (int fd, void *ubuffer, unsigned size, unsigned offset);
+static int sys_pwrite (int fd, const void *ubuffer, unsigned size,
+                       unsigned offset);
+static int sys_pipe (int *ufds);
+static int sys_splice (int fd_in, int fd_out, unsigned size);
+static int sys_copy_file_range (int fd_in, int fd_out, unsigned size);
+static int sys_sendfile (int fd_out, int fd_in, unsigned size);
+static int sys_dup (int fd);
+static int sys_dup2 (int old_fd, int new_fd);
+static tid_t sys_thread_create (void *eip, void *arg0, void *arg1);
+static int sys_thread_join (tid_t);
+static void sys_thread_exit (int status) NO_RETURN;
+static void *sys_sbrk (intptr_t increment);
+static tid_t sys_spawn (const char *ufile, char *const *uargv,
+                        const struct spawn_action *uactions, int action_cnt);
+static tid_t sys_waitany (int *ustatus);
+static int sys_poll (struct pollfd *ufds, int nfds, int timeout);
+static int sys_shm_open (const char *uname, size_t size);
+static void *sys_shm_map (int shmid, void *addr);
+static bool sys_shm_unmap (void *addr);
+static bool sys_shm_unlink (const char *uname);
+static int sys_getrusage (int who, struct rusage *uusage);
+
+/* A table entry for FUNC, which takes ARG_CNT arguments.  The
+   detour through a generic function type keeps GCC from warning
+   about the cast. */
+#define SYSCALL(ARG_CNT, FUNC) \
+        {ARG_CNT, (syscall_function *) (void (*) (void)) FUNC}
+
+/* Table of system calls, indexed by number. */
+static const struct syscall syscall_table[] =
+  {
+    [SYS_HALT] = SYSCALL (0, sys_halt),
+    [SYS_EXIT] = SYSCALL (1, sys_exit),
+    [SYS_EXEC] = SYSCALL (1, sys_exec),
+    [SYS_WAIT] = SYSCALL (1, sys_wait),
+    [SYS_CREATE] = SYSCALL (2, sys_create),
+    [SYS_REMOVE] = SYSCALL (1, sys_remove),
+    [SYS_OPEN] = SYSCALL (1, sys_open),
+    [SYS_FILESIZE] = SYSCALL (1, sys_filesize),
+    [SYS_READ] = SYSCALL (3, sys_read),
+    [SYS_WRITE] = SYSCALL (3, sys_write),
+    [SYS_SEEK] = SYSCALL (2, sys_seek),
+    [SYS_TELL] = SYSCALL (1, sys_tell),
+    [SYS_CLOSE] = SYSCALL (1, sys_close),
+#ifdef VM
+    [SYS_MMAP] = SYSCALL (2, sys_mmap),
+    [SYS_MUNMAP] = SYSCALL (1, sys_munmap),
+#endif
+    [SYS_CHDIR] = SYSCALL (1, sys_chdir),
+    [SYS_MKDIR] = SYSCALL (1, sys_mkdir),
+    [SYS_READDIR] = SYSCALL (2, sys_readdir),
+    [SYS_ISDIR] = SYSCALL (1, sys_isdir),
+    [SYS_INUMBER] = SYSCALL (1, sys_inumber),
+    [SYS_FORK] = SYSCALL (0, sys_fork),
+    [SYS_GETPID] = SYSCALL (0, sys_getpid),
+    [SYS_READV] = SYSCALL (3, sys_readv),
+    [SYS_WRITEV] = SYSCALL (3, sys_writev),
+    [SYS_PREAD] = SYSCALL (4, sys_pread),
+    [SYS_PWRITE] = SYSCALL (4, sys_pwrite),
+    [SYS_RING_SETUP] = SYSCALL (3, ring_setup),
+    [SYS_RING_ENTER] = SYSCALL (2, ring_enter),
+    [SYS_PIPE] = SYSCALL (1, sys_pipe),
+    [SYS_SPLICE] = SYSCALL (3, sys_splice),
+    [SYS_COPY_FILE_RANGE] = SYSCALL (3, sys_copy_file_range),
+    [SYS_SENDFILE] = SYSCALL (3, sys_sendfile),
+    [SYS_DUP] = SYSCALL (1, sys_dup),
+    [SYS_DUP2] = SYSCALL (2, sys_dup2),
+    [SYS_FUTEX] = SYSCALL (3, futex),
+    [SYS_THREAD_CREATE] = SYSCALL (3, sys_thread_create),
+    [SYS_THREAD_JOIN] = SYSCALL (1, sys_thread_join),
+    [SYS_THREAD_EXIT] = SYSCALL (1, sys_thread_exit),
+    [SYS_SBRK] = SYSCALL (1, sys_sbrk),
+    [SYS_SPAWN] = SYSCALL (4, sys_spawn),
+    [SYS_WAITANY] = SYSCALL (1, sys_waitany),
+    [SYS_POLL] = SYSCALL (3, sys_poll),
+    [SYS_SHM_OPEN] = SYSCALL (2, sys_shm_open),
+    [SYS_SHM_MAP] = SYSCALL (2, sys_shm_map),
+    [SYS_SHM_UNMAP] = SYSCALL (1, sys_shm_unmap),
+    [SYS_SHM_UNLINK] = SYSCALL (1, sys_shm_unlink),
+    [SYS_GETRUSAGE] = SYSCALL (2, sys_getrusage),
+  };
 
 static void syscall_handler (struct intr_frame *);
 
 void
-syscall_init (void) 
+syscall_init (void)
 {
+  lock_init (&fd_lock);
+  console_in.ref_cnt = console_out.ref_cnt = 1;
+  console_out.writer = true;
+  futex_init ();
+  shm_init ();
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
+/* System call handler. */
+static void
+syscall_handler (struct intr_frame *f)
+{
+  struct thread *t = thread_current ();
+  const struct syscall *sc;
+  unsigned nr;
+  int args[4];
+
+  /* Page faults in the kernel on user memory need the user's
+     registers, e.g. to grow the stack. */
+  t->syscall_frame = f;
+
+  /* Get the system call. */
+  if (!copy_in (&nr, f->esp, sizeof nr)
+      || nr >= sizeof syscall_table / sizeof *syscall_table
+      || syscall_table[nr].func == NULL)
+    sys_exit (-1);
+  sc = &syscall_table[nr];
+  t->process->usage.nsyscalls++;
+
+  /* Get the system call arguments. */
+  ASSERT (sc->arg_cnt <= sizeof args / sizeof *args);
+  memset (args, 0, sizeof args);
+  if (!copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * sc->arg_cnt))
+    sys_exit (-1);
+
+  /* Execute the system call, and set the return value. */
+  f->eax = sc->func (args[0], args[1], args[2], args[3]);
+  t->syscall_frame = NULL;
+}
+
+/* Returns true if the SIZE bytes starting at UADDR all lie below
+   PHYS_BASE. */
+static bool
+is_user_range (const void *uaddr, size_t size)
+{
+  return ((uintptr_t) uaddr + size >= (uintptr_t) uaddr
+          && (uintptr_t) uaddr + size <= (uintptr_t) PHYS_BASE);
+}
+
+/* User memory accessors.
+
+   Rather than checking that each user address is mapped before
+   touching it, these just try the access.  If it faults,
+   page_fault() finds EAX set to the address of the instruction
+   to resume at, and resumes there with EAX set to -1 instead.
+   Each accessor must therefore be a single asm statement that
+   checks EAX afterwards.  See [IA32-v3a] 5.15 "Interrupt 14--Page
+   Fault Exception (#PF)". */
+
+/* Reads a byte at user virtual address USRC into *DST, which
+   must be a kernel address.  Returns true if successful, false
+   if a segfault occurred. */
+static inline bool
+get_user (uint8_t *dst, const uint8_t *usrc)
+{
+  int eax;
+  asm ("movl $1f, %%eax; movb %2, %%al; movb %%al, %0; 1:"
+       : "=m" (*dst), "=&a" (eax) : "m" (*usrc));
+  return eax != -1;
+}
+
+/* Writes BYTE to user address UDST.  Returns true if successful,
+   false if a segfault occurred. */
+static inline bool
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int eax;
+  asm ("movl $1f, %%eax; movb %b2, %0; 1:"
+       : "=m" (*udst), "=&a" (eax) : "q" (byte));
+  return eax != -1;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns true if successful, false if USRC is not all
+   mapped user memory. */
+bool
+copy_in (void *dst, const void *usrc, size_t size)
+{
+  int eax;
+
+  if (!is_user_range (usrc, size))
+    return false;
+  asm volatile ("movl $1f, %%eax; rep movsb; 1:"
+                : "=&a" (eax), "+D" (dst), "+S" (usrc), "+c" (size)
+                : : "memory");
+  return eax != -1;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns true if successful, false if UDST is not all
+   mapped, writable user memory. */
+bool
+copy_out (void *udst, const void *src, size_t size)
+{
+  int eax;
+
+  if (!is_user_range (udst, size))
+    return false;
+  asm volatile ("movl $1f, %%eax; rep movsb; 1:"
+                : "=&a" (eax), "+D" (udst), "+S" (src), "+c" (size)
+                : : "memory");
+  return eax != -1;
+}
+
+/* Creates a copy of user string US in kernel memory and returns
+   it as a page that must be freed with palloc_free_page().
+   Truncates the string at PGSIZE bytes in size.  Kills the
+   process if US is not a valid user string. */
+static char *
+copy_in_string (const char *us)
+{
+  char *ks;
+  size_t length;
+
+  ks = palloc_get_page (0);
+  if (ks == NULL)
+    thread_exit ();
+
+  for (length = 0; length < PGSIZE; length++)
+    {
+      if (us + length >= (char *) PHYS_BASE
+          || !get_user ((uint8_t *) ks + length,
+                        (const uint8_t *) us + length))
+        {
+          palloc_free_page (ks);
+          sys_exit (-1);
+        }
+      if (ks[length] == '\0')
+        return ks;
+    }
+  ks[PGSIZE - 1] = '\0';
+  return ks;
+}
+
+/* Returns true if FD is one of the console descriptors. */
+static inline bool
+fd_is_console (const struct file_desc *fd)
+{
+  return fd == &console_in || fd == &console_out;
+}
+
+/* Returns the file_desc in slot FD of P's table, or a null
+   pointer if the slot is empty.  The caller must hold
+   fd_lock. */
+static struct file_desc *
+fd_lookup (struct process *p, int fd)
+{
+  struct fd_table *table = p != NULL ? p->files : NULL;
+
+  ASSERT (lock_held_by_current_thread (&fd_lock));
+  if (table == NULL || fd < 0 || (size_t) fd >= table->size)
+    return NULL;
+  return table->slots[fd];
+}
+
+/* Returns file descriptor FD in P's table, or a null pointer if
+   FD is not open.  The caller must hold fd_lock. */
+static struct file_desc *
+fd_find (struct process *p, int fd)
+{
+  struct file_desc *fd_ = fd_lookup (p, fd);
+
+  if (fd_ == NULL && fd == STDIN_FILENO)
+    return &console_in;
+  if (fd_ == NULL && fd == STDOUT_FILENO)
+    return &console_out;
+  return fd_;
+}
+
+/* Returns file descriptor FD in P's table, with a new reference
+   that the caller must release with fd_put(), or a null pointer
+   if FD is not open. */
+static struct file_desc *
+fd_get (struct process *p, int fd)
+{
+  struct file_desc *fd_;
+
+  lock_acquire (&fd_lock);
+  fd_ = fd_find (p, fd);
+  if (fd_ != NULL)
+    fd_->ref_cnt++;
+  lock_release (&fd_lock);
+  return fd_;
+}
+
+/* Releases a reference to FD, closing its file if it was the
+   last.  FD may be null. */
+static void
+fd_put (struct file_desc *fd)
+{
+  bool last;
+
+  if (fd == NULL)
+    return;
+  lock_acquire (&fd_lock);
+  last = --fd->ref_cnt == 0;
+  lock_release (&fd_lock);
+  if (last)
+    {
+      ASSERT (!fd_is_console (fd));
+      if (fd->pipe != NULL)
+        pipe_close (fd->pipe, fd->writer);
+      else
+        {
+          lock_acquire (&filesys_lock);
+          file_close (fd->file);
+          lock_release (&filesys_lock);
+        }
+      free (fd);
+    }
+}
+
+/* Returns file descriptor FD in P's table, with a new reference
+   as for fd_get(), or a null pointer if FD is not an open
+   file. */
+static struct file_desc *
+fd_get_file (struct process *p, int fd)
+{
+  struct file_desc *fd_ = fd_get (p, fd);
+
+  if (fd_ != NULL && fd_->file == NULL)
+    {
+      fd_put (fd_);
+      fd_ = NULL;
+    }
+  return fd_;
+}
+
+/* Creates and returns an empty file descriptor table of SIZE
+   slots, or returns a null pointer if memory is exhausted. */
+static struct fd_table *
+fd_table_create (size_t size)
+{
+  struct fd_table *table = malloc (sizeof *table);
+
+  if (table == NULL)
+    return NULL;
+  table->slots = calloc (size, sizeof *table->slots);
+  table->used = bitmap_create (size);
+  if (table->slots == NULL || table->used == NULL)
+    {
+      free (table->slots);
+      if (table->used != NULL)
+        bitmap_destroy (table->used);
+      free (table);
+      return NULL;
+    }
+  table->size = size;
+  table->first_free = 2;
+  return table;
+}
+
+/* Grows TABLE to at least SIZE slots.  Returns false if SIZE is
+   too big or memory is exhausted.  The caller must hold
+   fd_lock. */
+static bool
+fd_table_grow (struct fd_table *table, size_t size)
+{
+  size_t new_size = table->size;
+  struct file_desc **slots;
+  struct bitmap *used;
+  size_t i;
+
+  if (size > FD_TABLE_MAX)
+    return false;
+  while (new_size < size)
+    new_size *= 2;
+  if (new_size > FD_TABLE_MAX)
+    new_size = FD_TABLE_MAX;
+
+  slots = realloc (table->slots, new_size * sizeof *slots);
+  if (slots == NULL)
+    return false;
+  table->slots = slots;
+  used = bitmap_create (new_size);
+  if (used == NULL)
+    return false;
+  for (i = table->size; i < new_size; i++)
+    slots[i] = NULL;
+  for (i = 0; i < table->size; i++)
+    bitmap_set (used, i, slots[i] != NULL);
+  bitmap_destroy (table->used);
+  table->used = used;
+  table->size = new_size;
+  return true;
+}
+
+/* Puts FD_ in slot FD of TABLE, which must be empty.  The caller
+   must hold fd_lock. */
+static void
+fd_table_set (struct fd_table *table, int fd, struct file_desc *fd_)
+{
+  ASSERT (table->slots[fd] == NULL);
+  table->slots[fd] = fd_;
+  bitmap_mark (table->used, fd);
+}
+
+/* Empties slot FD of TABLE and returns what was in it.  The
+   caller must hold fd_lock. */
+static struct file_desc *
+fd_table_clear (struct fd_table *table, int fd)
+{
+  struct file_desc *fd_ = table->slots[fd];
+
+  table->slots[fd] = NULL;
+  bitmap_reset (table->used, fd);
+  if ((size_t) fd < table->first_free && fd >= 2)
+    table->first_free = fd;
+  return fd_;
+}
+
+/* Puts FD_ in the lowest free slot, from 2 up, of P's table and
+   returns that slot's file descriptor, or -1 if the table cannot
+   grow.  Transfers the caller's reference to the table.  The
+   caller must hold fd_lock. */
+static int
+fd_alloc (struct process *p, struct file_desc *fd_)
+{
+  struct fd_table *table = p->files;
+  size_t fd;
+
+  ASSERT (lock_held_by_current_thread (&fd_lock));
+  fd = bitmap_scan (table->used, table->first_free, 1, false);
+  if (fd == BITMAP_ERROR)
+    {
+      fd = table->size;
+      if (!fd_table_grow (table, fd + 1))
+        return -1;
+    }
+  fd_table_set (table, fd, fd_);
+  table->first_free = fd + 1;
+  return fd;
+}
+
+/* Adds FD, which holds one reference, to P's table under a new
+   file descriptor, which it returns.  On failure, releases FD
+   and returns -1. */
+static int
+fd_install (struct process *p, struct file_desc *fd)
+{
+  int handle;
+
+  fd->ref_cnt = 1;
+  fd->copy = NULL;
+  lock_acquire (&fd_lock);
+  handle = fd_alloc (p, fd);
+  lock_release (&fd_lock);
+  if (handle < 0)
+    fd_put (fd);
+  return handle;
+}
+
+/* Halt system call. */
+static void
+sys_halt (void)
+{
+  shutdown_power_off ();
+}
+
+/* Exit system call. */
+static void
+sys_exit (int status)
+{
+  process_end (status);
+}
+
+/* Exec system call. */
+static tid_t
+sys_exec (const char *ucmd_line)
+{
+  char *cmd_line = copy_in_string (ucmd_line);
+  tid_t pid = process_execute (cmd_line);
+
+  palloc_free_page (cmd_line);
+  return pid;
+}
+
+/* Wait system call. */
+static int
+sys_wait (tid_t pid)
+{
+  return process_wait (pid);
+}
+
+/* Waitany system call. */
+static tid_t
+sys_waitany (int *ustatus)
+{
+  int status;
+  tid_t pid = process_wait_any (&status);
+
+  if (pid != TID_ERROR && ustatus != NULL
+      && !copy_out (ustatus, &status, sizeof status))
+    sys_exit (-1);
+  return pid;
+}
+
+/* Create system call. */
+static bool
+sys_create (const char *ufile, unsigned initial_size)
+{
+  char *file = copy_in_string (ufile);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_create (file, initial_size);
+  lock_release (&filesys_lock);
+  palloc_free_page (file);
+  return ok;
+}
+
+/* Remove system call. */
+static bool
+sys_remove (const char *ufile)
+{
+  char *file = copy_in_string (ufile);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  process_forget_image (file);
+  ok = filesys_remove (file);
+  lock_release (&filesys_lock);
+  palloc_free_page (file);
+  return ok;
+}
+
+/* Open system call. */
+static int
+sys_open (const char *ufile)
+{
+  char *file = copy_in_string (ufile);
+  int handle = syscall_open (thread_current ()->process, file);
+
+  palloc_free_page (file);
+  return handle;
+}
+
+/* Filesize system call. */
+static int
+sys_filesize (int fd)
+{
+  struct file_desc *fd_ = fd_get_file (thread_current ()->process, fd);
+  int size;
+
+  if (fd_ == NULL)
+    return -1;
+  lock_acquire (&filesys_lock);
+  size = file_length (fd_->file);
+  lock_release (&filesys_lock);
+  fd_put (fd_);
+  return size;
+}
+
+/* Returns true if a key is waiting in the input buffer. */
+static bool
+key_waiting (void)
+{
+  enum intr_level old_level = intr_disable ();
+  bool waiting = !input_empty ();
+  intr_set_level (old_level);
+  return waiting;
+}
+
+/* Waits for a key and stores it in *KEY.  Returns false without
+   a key if the running thread is interrupted first. */
+static bool
+console_getc (uint8_t *key)
+{
+  struct poller poller;
+  struct poll_entry entry;
+  bool got_key = false;
+
+  poller_init (&poller);
+  poller_add (&poller, &entry, input_pollq ());
+  for (;;)
+    {
+      enum intr_level old_level = intr_disable ();
+      if (!input_empty ())
+        {
+          *key = input_getc ();
+          got_key = true;
+        }
+      intr_set_level (old_level);
+      if (got_key || poller_wait (&poller, -1) == NULL)
+        break;
+    }
+  poller_remove (&entry);
+  return got_key;
+}
+
+/* Transfers SIZE bytes between user buffer UBUF and the file
+   open as FD in P's table, writing to the file if WRITE is true
+   and reading from it otherwise.  The transfer starts at byte
+   *POS in the file, advancing *POS past the bytes transferred,
+   or, if POS is null, at the file's own position, which is
+   advanced instead.  Returns the number of bytes transferred,
+   which is short at end of file, or -1 if FD is not open.
+
+   FD may also be one end of a pipe or the console, if POS is
+   null.  A read from a pipe returns the data available, up to a
+   page, waiting only if there is none; a read from the keyboard
+   returns at most one line.
+
+   File data goes through KBUF, a kernel page, so that the file
+   system never touches user memory, which might fault while it
+   holds filesys_lock.  If UBUF is not valid user memory, frees
+   KBUF and kills the process. */
+static int
+transfer (struct process *p, int fd, uint8_t *ubuf, unsigned size, off_t *pos,
+          bool write, uint8_t *kbuf)
+{
+  struct file_desc *fd_;
+  struct file *file;
+  struct pipe *pipe;
+  int done = 0;
+
+  fd_ = fd_get (p, fd);
+  if (fd_ == NULL)
+    return -1;
+  if (fd_->file == NULL && (fd_->writer != write || pos != NULL))
+    {
+      fd_put (fd_);
+      return -1;
+    }
+  file = fd_->file;
+  pipe = fd_->pipe;
+
+  /* Handle keyboard reads.  Like a terminal, stop at the end of
+     a line, or once no more keys are waiting, so that a buffered
+     reader does not wait for a whole buffer's worth of keys. */
+  if (fd_ == &console_in)
+    {
+      for (done = 0; (unsigned) done < size; done++)
+        {
+          uint8_t key;
+
+          if (done > 0 && !key_waiting ())
+            break;
+          if (ubuf + done >= (uint8_t *) PHYS_BASE)
+            goto bad_user;
+          if (!console_getc (&key))
+            break;
+          if (!put_user (ubuf + done, key))
+            goto bad_user;
+          if (key == '\n' || key == '\r')
+            {
+              done++;
+              break;
+            }
+        }
+      p->usage.read_bytes += done;
+      fd_put (fd_);
+      return done;
+    }
+
+  if (!is_user_range (ubuf, size))
+    goto bad_user;
+
+  while (size > 0)
+    {
+      size_t chunk = size < PGSIZE ? size : PGSIZE;
+      off_t retval;
+
+      if (write && !copy_in (kbuf, ubuf + done, chunk))
+        goto bad_user;
+      if (pipe != NULL)
+        {
+          retval = (write
+                    ? pipe_write (pipe, kbuf, chunk)
+                    : pipe_read (pipe, kbuf, chunk));
+          if (retval < 0 && done == 0)
+            done = -1;
+        }
+      else if (file == NULL)
+        {
+          /* Console output. */
+          putbuf ((char *) kbuf, chunk);
+          retval = chunk;
+        }
+      else
+        {
+          lock_acquire (&filesys_lock);
+          if (pos != NULL)
+            retval = (write
+                      ? file_write_at (file, kbuf, chunk, *pos)
+                      : file_read_at (file, kbuf, chunk, *pos));
+          else
+            retval = (write
+                      ? file_write (file, kbuf, chunk)
+                      : file_read (file, kbuf, chunk));
+          lock_release (&filesys_lock);
+        }
+      if (retval <= 0)
+        break;
+      if (!write && !copy_out (ubuf + done, kbuf, retval))
+        goto bad_user;
+      if (pos != NULL)
+        *pos += retval;
+      done += retval;
+      if (retval != (off_t) chunk || (pipe != NULL && !write))
+        break;
+      size -= retval;
+    }
+  if (done > 0)
+    {
+      if (write)
+        p->usage.write_bytes += done;
+      else
+        p->usage.read_bytes += done;
+    }
+  fd_put (fd_);
+  return done;
+
+ bad_user:
+  fd_put (fd_);
+  palloc_free_page (kbuf);
+  sys_exit (-1);
+}
+
+/* Read system call. */
+static int
+sys_read (int fd, void *ubuffer, unsigned size)
+{
+  struct process *p = thread_current ()->process;
+  uint8_t *kbuf = palloc_get_page (0);
+  int bytes_read;
+
+  if (kbuf == NULL)
+    return -1;
+  bytes_read = transfer (p, fd, ubuffer, size, NULL, false, kbuf);
+  palloc_free_page (kbuf);
+  return bytes_read;
+}
+
+/* Write system call. */
+static int
+sys_write (int fd, const void *ubuffer, unsigned size)
+{
+  struct process *p = thread_current ()->process;
+  uint8_t *kbuf = palloc_get_page (0);
+  int bytes_written;
+
+  if (kbuf == NULL)
+    return -1;
+  bytes_written = transfer (p, fd, (void *) ubuffer, size, NULL, true, kbuf);
+  palloc_free_page (kbuf);
+  return bytes_written;
+}
+
+/* Common code for readv() and writev(): transfers data between
+   the file open as FD and the IOVCNT buffers described by the
+   user array UIOV, in order, stopping at the first short
+   transfer.  Returns the total number of bytes transferred, or
+   -1 if FD is not open. */
+static int
+transfer_vector (int fd, const struct iovec *uiov, int iovcnt, bool write)
+{
+  struct iovec iov[IOV_MAX];
+  uint8_t *kbuf;
+  int total = 0;
+  int i;
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return -1;
+  if (!copy_in (iov, uiov, iovcnt * sizeof *iov))
+    sys_exit (-1);
+
+  kbuf = palloc_get_page (0);
+  if (kbuf == NULL)
+    return -1;
+  for (i = 0; i < iovcnt; i++)
+    {
+      int retval = transfer (thread_current ()->process, fd, iov[i].iov_base,
+                             iov[i].iov_len, NULL, write, kbuf);
+      if (retval < 0)
+        {
+          total = -1;
+          break;
+        }
+      total += retval;
+      if ((size_t) retval != iov[i].iov_len)
+        break;
+    }
+  palloc_free_page (kbuf);
+  return total;
+}
+
+/* Readv system call. */
+static int
+sys_readv (int fd, const struct iovec *uiov, int iovcnt)
+{
+  return transfer_vector (fd, uiov, iovcnt, false);
+}
+
+/* Writev system call. */
+static int
+sys_writev (int fd, const struct iovec *uiov, int iovcnt)
+{
+  return transfer_vector (fd, uiov, iovcnt, true);
+}
+
+/* Common code for pread() and pwrite(), which transfer data at
+   byte OFFSET in the file open as FD, without using or changing
+   the file's own position. */
+static int
+transfer_at (int fd, void *ubuffer, unsigned size, unsigned offset,
+             bool write)
+{
+  struct process *p = thread_current ()->process;
+  uint8_t *kbuf;
+  off_t pos = offset;
+  int retval;
+
+  if (pos < 0)
+    return -1;
+  kbuf = palloc_get_page (0);
+  if (kbuf == NULL)
+    return -1;
+  retval = transfer (p, fd, ubuffer, size, &pos, write, kbuf);
+  palloc_free_page (kbuf);
+  return retval;
+}
+
+/* Pread system call. */
+static int
+sys_pread (int fd, void *ubuffer, unsigned size, unsigned offset)
+{
+  return transfer_at (fd, ubuffer, size, offset, false);
+}
+
+/* Pwrite system call. */
+static int
+sys_pwrite (int fd, const void *ubuffer, unsigned size, unsigned offset)
+{
+  return transfer_at (fd, (void *) ubuffer, size, offset, true);
+}
+
+/* Pipe system call. */
+static int
+sys_pipe (int *ufds)
+{
+  struct process *p = thread_current ()->process;
+  struct file_desc *rd = malloc (sizeof *rd);
+  struct file_desc *wr = malloc (sizeof *wr);
+  struct pipe *pipe = pipe_create ();
+  int fds[2];
+
+  if (rd == NULL || wr == NULL || pipe == NULL)
+    {
+      free (rd);
+      free (wr);
+      if (pipe != NULL)
+        {
+          pipe_close (pipe, false);
+          pipe_close (pipe, true);
+        }
+      return -1;
+    }
+  rd->file = wr->file = NULL;
+  rd->pipe = wr->pipe = pipe;
+  rd->writer = false;
+  wr->writer = true;
+  fds[0] = fd_install (p, rd);
+  fds[1] = fd_install (p, wr);
+  if (fds[0] < 0 || fds[1] < 0)
+    {
+      syscall_close (p, fds[0]);
+      syscall_close (p, fds[1]);
+      return -1;
+    }
+  if (!copy_out (ufds, fds, sizeof fds))
+    sys_exit (-1);
+  return 0;
+}
+
+/* Splice system call.  Moves up to SIZE bytes from the read end
+   of a pipe to a file or the console output, or from a file to
+   the write end of a pipe, without copying through user memory.
+   Returns the number of bytes moved, or -1 if neither FD_IN nor
+   FD_OUT is a suitable pipe end. */
+static int
+sys_splice (int fd_in, int fd_out, unsigned size)
+{
+  struct process *p = thread_current ()->process;
+  struct file_desc *in = fd_get (p, fd_in);
+  struct file_desc *out = fd_get (p, fd_out);
+  int retval = -1;
+
+  if (in == NULL || out == NULL)
+    goto done;
+
+  if (in->pipe != NULL && !in->writer)
+    {
+      /* Pipe to file or console. */
+      if (out->file != NULL || out == &console_out)
+        retval = pipe_splice_out (in->pipe, out->file, size);
+    }
+  else if (in->file != NULL && out->pipe != NULL && out->writer)
+    {
+      /* File to pipe. */
+      retval = pipe_splice_in (out->pipe, in->file, size);
+    }
+
+ done:
+  fd_put (in);
+  fd_put (out);
+  return retval;
+}
+
+/* Copies up to SIZE bytes from IN to OUT, or to the console if
+   OUT is null, through KBUF, a kernel page, starting at and
+   advancing each file's position.  Returns the number of bytes
+   copied, which is short at end of file or if OUT cannot grow.
+
+   The inode layer transfers whole sectors straight between the
+   disk and the caller's buffer, but needs a bounce buffer, and
+   for writes an extra read, for a partial sector.  So each chunk
+   after the first ends on a sector boundary in OUT, which keeps
+   every write but the last whole-sector.  Reads are aligned too
+   when IN and OUT are at the same offset within a sector, as in
+   a copy from the start of one file to the start of another. */
+static int
+copy_range (struct file *in, struct file *out, size_t size, uint8_t *kbuf)
+{
+  int done = 0;
+
+  while (size > 0)
+    {
+      off_t pos, got, put;
+      size_t chunk;
+
+      lock_acquire (&filesys_lock);
+      pos = file_tell (out != NULL ? out : in);
+      chunk = PGSIZE - pos % BLOCK_SECTOR_SIZE;
+      if (chunk > size)
+        chunk = size;
+      got = file_read (in, kbuf, chunk);
+      put = got;
+      if (out != NULL && got > 0)
+        {
+          put = file_write (out, kbuf, got);
+          if (put < got)
+            file_seek (in, file_tell (in) - (got - put));
+        }
+      lock_release (&filesys_lock);
+      if (out == NULL && got > 0)
+        putbuf ((char *) kbuf, got);
+
+      if (put <= 0)
+        break;
+      done += put;
+      size -= put;
+      if ((size_t) put != chunk)
+        break;
+    }
+  return done;
+}
+
+/* Copy_file_range system call.  Copies up to SIZE bytes from
+   file FD_IN to file FD_OUT, at and advancing each one's
+   position, without passing the data through user memory.
+   Returns the number of bytes copied, or -1 if either is not an
+   open file. */
+static int
+sys_copy_file_range (int fd_in, int fd_out, unsigned size)
+{
+  struct process *p = thread_current ()->process;
+  struct file_desc *in = fd_get_file (p, fd_in);
+  struct file_desc *out = fd_get_file (p, fd_out);
+  uint8_t *kbuf = palloc_get_page (0);
+  int retval = -1;
+
+  if (in != NULL && out != NULL && kbuf != NULL)
+    retval = copy_range (in->file, out->file, size, kbuf);
+  palloc_free_page (kbuf);
+  fd_put (in);
+  fd_put (out);
+  return retval;
+}
+
+/* Moves SIZE bytes from FILE into PIPE, waiting for room as
+   often as necessary.  Returns the number of bytes moved, which
+   is short at end of file, or -1 if PIPE has no readers. */
+static int
+splice_all (struct pipe *pipe, struct file *file, size_t size)
+{
+  size_t done = 0;
+
+  while (done < size)
+    {
+      int moved = pipe_splice_in (pipe, file, size - done);
+      if (moved <= 0)
+        return done > 0 ? (int) done : moved;
+      done += moved;
+    }
+  return done;
+}
+
+/* Sendfile system call.  As copy_file_range(), except that
+   FD_OUT may also be the console output or the write end of a
+   pipe. */
+static int
+sys_sendfile (int fd_out, int fd_in, unsigned size)
+{
+  struct process *p = thread_current ()->process;
+  struct file_desc *in = fd_get_file (p, fd_in);
+  struct file_desc *out = fd_get (p, fd_out);
+  uint8_t *kbuf = palloc_get_page (0);
+  int retval = -1;
+
+  if (in != NULL && out != NULL && kbuf != NULL)
+    {
+      if (out->file != NULL || out == &console_out)
+        retval = copy_range (in->file, out->file, size, kbuf);
+      else if (out->pipe != NULL && out->writer)
+        retval = splice_all (out->pipe, in->file, size);
+    }
+  palloc_free_page (kbuf);
+  fd_put (in);
+  fd_put (out);
+  return retval;
+}
+
+/* Dup system call.  Returns a new file descriptor, the lowest
+   free from 2 up, for the same open file as FD, sharing its file
+   position. */
+static int
+sys_dup (int fd)
+{
+  struct process *p = thread_current ()->process;
+  struct file_desc *fd_;
+  int new_fd = -1;
+
+  lock_acquire (&fd_lock);
+  fd_ = fd_find (p, fd);
+  if (fd_ != NULL)
+    {
+      new_fd = fd_alloc (p, fd_);
+      if (new_fd >= 0)
+        fd_->ref_cnt++;
+    }
+  lock_release (&fd_lock);
+  return new_fd;
+}
+
+/* Dup2 system call.  Makes NEW_FD refer to the same open file as
+   OLD_FD, first closing whatever NEW_FD referred to, and returns
+   NEW_FD. */
+static int
+sys_dup2 (int old_fd, int new_fd)
+{
+  struct process *p = thread_current ()->process;
+  struct fd_table *table = p->files;
+  struct file_desc *fd_, *old = NULL;
+
+  if (new_fd < 0)
+    return -1;
+  lock_acquire (&fd_lock);
+  fd_ = fd_find (p, old_fd);
+  if (fd_ == NULL
+      || ((size_t) new_fd >= table->size
+          && !fd_table_grow (table, new_fd + 1)))
+    new_fd = -1;
+  else if (new_fd != old_fd)
+    {
+      if (table->slots[new_fd] != NULL)
+        old = fd_table_clear (table, new_fd);
+      fd_table_set (table, new_fd, fd_);
+      fd_->ref_cnt++;
+    }
+  lock_release (&fd_lock);
+
+  fd_put (old);
+  return new_fd;
+}
+
+/* Seek system call. */
+static void
+sys_seek (int fd, unsigned position)
+{
+  struct file_desc *fd_ = fd_get_file (thread_current ()->process, fd);
+
+  if (fd_ != NULL && (off_t) position >= 0)
+    {
+      lock_acquire (&filesys_lock);
+      file_seek (fd_->file, position);
+      lock_release (&filesys_lock);
+    }
+  fd_put (fd_);
+}
+
+/* Tell system call. */
+static unsigned
+sys_tell (int fd)
+{
+  struct file_desc *fd_ = fd_get_file (thread_current ()->process, fd);
+  unsigned position;
+
+  if (fd_ == NULL)
+    return -1;
+  lock_acquire (&filesys_lock);
+  position = file_tell (fd_->file);
+  lock_release (&filesys_lock);
+  fd_put (fd_);
+  return position;
+}
+
+/* Close system call. */
+static void
+sys_close (int fd)
+{
+  syscall_close (thread_current ()->process, fd);
+}
+
+#ifdef VM
+/* Mmap system call. */
+static int
+sys_mmap (int fd, void *addr)
+{
+  struct file_desc *fd_ = fd_get_file (thread_current ()->process, fd);
+  struct file *file;
+
+  if (fd_ == NULL)
+    return -1;
+  lock_acquire (&filesys_lock);
+  file = file_reopen (fd_->file);
+  lock_release (&filesys_lock);
+  fd_put (fd_);
+  return file != NULL ? page_mmap (file, addr) : -1;
+}
+
+/* Munmap system call. */
+static void
+sys_munmap (int mapid)
+{
+  page_munmap (mapid);
+}
+#endif
+
+/* The file system keeps every file in a single root directory,
+   so the directory system calls below can only fail, except that
+   every open file has an inode number. */
+
+/* Chdir system call. */
+static bool
+sys_chdir (const char *udir)
+{
+  palloc_free_page (copy_in_string (udir));
+  return false;
+}
+
+/* Mkdir system call. */
+static bool
+sys_mkdir (const char *udir)
+{
+  palloc_free_page (copy_in_string (udir));
+  return false;
+}
+
+/* Readdir system call. */
+static bool
+sys_readdir (int fd UNUSED, char *uname UNUSED)
+{
+  return false;
+}
+
+/* Isdir system call. */
+static bool
+sys_isdir (int fd UNUSED)
+{
+  return false;
+}
+
+/* Inumber system call. */
+static int
+sys_inumber (int fd)
+{
+  struct file_desc *fd_ = fd_get_file (thread_current ()->process, fd);
+  int inumber;
+
+  if (fd_ == NULL)
+    return -1;
+  inumber = inode_get_inumber (file_get_inode (fd_->file));
+  fd_put (fd_);
+  return inumber;
+}
+
+/* Fork system call. */
+static tid_t
+sys_fork (void)
+{
+  return process_fork (thread_current ()->syscall_frame);
+}
+
+/* Getpid system call. */
+static tid_t
+sys_getpid (void)
+{
+  return thread_current ()->process->pid;
+}
+
+/* Thread_create system call.  The user library passes its own
+   start routine as EIP, which calls the user's function with
+   ARG0 and ARG1. */
+static tid_t
+sys_thread_create (void *eip, void *arg0, void *arg1)
+{
+  if (!is_user_vaddr (eip))
+    return TID_ERROR;
+  return process_thread_create (eip, arg0, arg1);
+}
+
+/* Thread_join system call. */
+static int
+sys_thread_join (tid_t tid)
+{
+  return process_thread_join (tid);
+}
+
+/* Thread_exit system call. */
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+sys_thread_exit (int status)
+{
+  process_thread_exit (status);
+}
+
+/* Sbrk system call. */
+static void *
+sys_sbrk (intptr_t increment)
+{
+  return process_sbrk (increment);
+}
+
+/* Spawn system call. */
+static tid_t
+sys_spawn (const char *ufile, char *const *uargv,
+           const struct spawn_action *uactions, int action_cnt)
+{
+  struct spawn_action actions[SPAWN_MAX_ACTIONS];
+  struct exec_args *args;
+  char *file;
+  int argc;
+  tid_t pid;
+
+  if (action_cnt < 0 || action_cnt > SPAWN_MAX_ACTIONS)
+    return TID_ERROR;
+  if (!copy_in (actions, uactions, action_cnt * sizeof *actions))
+    sys_exit (-1);
+  file = copy_in_string (ufile);
+  args = process_args_create ();
+  if (args == NULL)
+    {
+      palloc_free_page (file);
+      return TID_ERROR;
+    }
+
+  /* Measure each argument, then copy it straight into place in
+     the new process's stack image. */
+  for (argc = 0; ; argc++)
+    {
+      const char *uarg;
+      size_t len;
+      char *arg;
+
+      if (!copy_in (&uarg, uargv + argc, sizeof uarg))
+        goto bad_user;
+      if (uarg == NULL)
+        break;
+      for (len = 0; ; len++)
+        {
+          uint8_t c;
+
+          if (uarg + len >= (char *) PHYS_BASE
+              || !get_user (&c, (const uint8_t *) uarg + len))
+            goto bad_user;
+          if (c == '\0')
+            break;
+        }
+      arg = process_args_add (args, len);
+      if (arg == NULL)
+        {
+          process_args_destroy (args);
+          palloc_free_page (file);
+          return TID_ERROR;
+        }
+      if (!copy_in (arg, uarg, len))
+        goto bad_user;
+    }
+
+  pid = process_spawn (file, args, actions, action_cnt);
+  palloc_free_page (file);
+  return pid;
+
+ bad_user:
+  process_args_destroy (args);
+  palloc_free_page (file);
+  sys_exit (-1);
+}
+
+/* A descriptor watched by sys_poll(). */
+struct poll_slot
+  {
+    struct poll_entry entry;    /* Entry in the object's poll queue. */
+    struct file_desc *fd;       /* Descriptor, or null. */
+  };
+
+/* Returns the poll queue of the object that the pollfd FD refers
+   to, where FD_ is FD's file descriptor in the running process,
+   or a null pointer if the object is always ready or never. */
+static struct pollq *
+poll_queue (int fd, struct file_desc *fd_)
+{
+  if (fd == POLL_CHILDREN)
+    return &thread_current ()->child_pollers;
+  else if (fd_ == &console_in)
+    return input_pollq ();
+  else if (fd_ != NULL && fd_->pipe != NULL)
+    return pipe_pollq (fd_->pipe);
+  else
+    return NULL;
+}
+
+/* Returns the events of interest in EVENTS, plus the ones that
+   are always reported, that hold for the pollfd FD, where FD_ is
+   FD's file descriptor in the running process. */
+static int
+poll_events (int fd, struct file_desc *fd_, int events)
+{
+  int revents;
+
+  if (fd == POLL_CHILDREN)
+    revents = process_poll_children ();
+  else if (fd < 0)
+    return 0;
+  else if (fd_ == NULL)
+    revents = POLLNVAL;
+  else if (fd_ == &console_in)
+    revents = key_waiting () ? POLLIN : 0;
+  else if (fd_ == &console_out)
+    revents = POLLOUT;
+  else if (fd_->pipe != NULL)
+    revents = pipe_poll (fd_->pipe, fd_->writer);
+  else
+    revents = POLLIN | POLLOUT;
+  return revents & (events | POLLERR | POLLHUP | POLLNVAL);
+}
+
+/* Poll system call.  Waits until at least one of the NFDS
+   descriptors in UFDS is ready, or for TIMEOUT milliseconds if
+   TIMEOUT is nonnegative, and returns the number that are ready.
+
+   Each descriptor is checked once up front, with its poll entry
+   already on its object's queue.  After that, a wakeup only
+   rechecks the descriptors whose objects woke it. */
+static int
+sys_poll (struct pollfd *ufds, int nfds, int timeout)
+{
+  struct process *p = thread_current ()->process;
+  struct pollfd *fds;
+  struct poll_slot *slots;
+  struct poller poller;
+  struct poll_entry *e;
+  int64_t deadline;
+  int ready = 0;
+  int i;
+
+  if (nfds < 0 || nfds > POLL_MAX_FDS)
+    return -1;
+  deadline = (timeout < 0 ? -1
+              : timer_ticks () + DIV_ROUND_UP ((int64_t) timeout
+                                               * TIMER_FREQ, 1000));
+  fds = malloc (nfds * sizeof *fds + 1);
+  slots = malloc (nfds * sizeof *slots + 1);
+  if (fds == NULL || slots == NULL)
+    {
+      free (fds);
+      free (slots);
+      return -1;
+    }
+  if (!copy_in (fds, ufds, nfds * sizeof *fds))
+    {
+      free (fds);
+      free (slots);
+      sys_exit (-1);
+    }
+
+  poller_init (&poller);
+  for (i = 0; i < nfds; i++)
+    {
+      struct poll_slot *s = &slots[i];
+
+      s->fd = fds[i].fd >= 0 ? fd_get (p, fds[i].fd) : NULL;
+      poller_add (&poller, &s->entry, poll_queue (fds[i].fd, s->fd));
+      fds[i].revents = poll_events (fds[i].fd, s->fd, fds[i].events);
+      if (fds[i].revents != 0)
+        ready++;
+    }
+  while (ready == 0 && (e = poller_wait (&poller, deadline)) != NULL)
+    {
+      i = (struct poll_slot *) ((uint8_t *) e
+                                - offsetof (struct poll_slot, entry)) - slots;
+      fds[i].revents = poll_events (fds[i].fd, slots[i].fd, fds[i].events);
+      if (fds[i].revents != 0)
+        ready++;
+    }
+  for (i = 0; i < nfds; i++)
+    {
+      poller_remove (&slots[i].entry);
+      fd_put (slots[i].fd);
+    }
+  free (slots);
+
+  if (!copy_out (ufds, fds, nfds * sizeof *fds))
+    {
+      free (fds);
+      sys_exit (-1);
+    }
+  free (fds);
+  return ready;
+}
+
+/* Shm_open system call. */
+static int
+sys_shm_open (const char *uname, size_t size)
+{
+  char *name = copy_in_string (uname);
+  int shmid = shm_open (name, size);
+
+  palloc_free_page (name);
+  return shmid;
+}
+
+/* Shm_map system call. */
+static void *
+sys_shm_map (int shmid, void *addr)
+{
+  return shm_map (shmid, addr);
+}
+
+/* Shm_unmap system call. */
+static bool
+sys_shm_unmap (void *addr)
+{
+  return shm_unmap (addr);
+}
+
+/* Shm_unlink system call. */
+static bool
+sys_shm_unlink (const char *uname)
 {
-  printf ("system call!\n");
-  thread_exit ();
+  char *name = copy_in_string (uname);
+  bool ok = shm_unlink (name);
+
+  palloc_free_page (name);
+  return ok;
+}
+
+/* Getrusage system call. */
+static int
+sys_getrusage (int who, struct rusage *uusage)
+{
+  struct rusage usage;
+
+  if (!process_get_rusage (who, &usage))
+    return -1;
+  if (!copy_out (uusage, &usage, sizeof usage))
+    sys_exit (-1);
+  return 0;
+}
+
+/* Opens FILE, a kernel string, in P's file descriptor table and
+   returns the new file descriptor, or -1 if FILE cannot be
+   opened. */
+int
+syscall_open (struct process *p, const char *file)
+{
+  struct file_desc *fd = malloc (sizeof *fd);
+  int handle = -1;
+
+  if (fd == NULL)
+    return -1;
+  lock_acquire (&filesys_lock);
+  fd->file = filesys_open (file);
+  lock_release (&filesys_lock);
+  fd->pipe = NULL;
+  fd->writer = false;
+  if (fd->file != NULL)
+    handle = fd_install (p, fd);
+  else
+    free (fd);
+  return handle;
+}
+
+/* Transfers SIZE bytes between user buffer UBUF and the file
+   open as FD in P's table, as for read() or write() if POS is
+   null, or pread() or pwrite() at offset *POS otherwise.  UBUF
+   must lie below PHYS_BASE.  Returns the number of bytes
+   transferred, or -1 if FD is not open or memory is exhausted.
+   Kills the process if UBUF is not mapped. */
+int
+syscall_transfer (struct process *p, int fd, void *ubuf, unsigned size,
+                  off_t *pos, bool write)
+{
+  uint8_t *kbuf;
+  int retval;
+
+  ASSERT (is_user_range (ubuf, size));
+
+  kbuf = palloc_get_page (0);
+  if (kbuf == NULL)
+    return -1;
+  retval = transfer (p, fd, ubuf, size, pos, write, kbuf);
+  palloc_free_page (kbuf);
+  return retval;
+}
+
+/* Flushes the file open as FD in P's table to disk.  Returns 0
+   if successful, -1 if FD is not open.  Writes to files go
+   straight to disk, because the file system has no cache, so
+   there is nothing else to do. */
+int
+syscall_fsync (struct process *p, int fd)
+{
+  struct file_desc *fd_ = fd_get (p, fd);
+
+  if (fd_ == NULL)
+    return -1;
+  fd_put (fd_);
+  return 0;
+}
+
+/* Closes file descriptor FD in P's table.  Returns 0 if
+   successful, -1 if FD is not open. */
+int
+syscall_close (struct process *p, int fd)
+{
+  struct file_desc *fd_;
+
+  lock_acquire (&fd_lock);
+  fd_ = fd_lookup (p, fd);
+  if (fd_ != NULL)
+    fd_table_clear (p->files, fd);
+  lock_release (&fd_lock);
+
+  /* Drop the table's reference. */
+  if (fd_ == NULL)
+    return -1;
+  fd_put (fd_);
+  return 0;
+}
+
+/* Returns a new file descriptor table for a process started by
+   the current one with exec() or spawn(), or a null pointer if
+   memory is exhausted or one of the ACTION_CNT ACTIONS fails.
+   The new process shares the current one's standard input and
+   output, descriptors 0 and 1, and then whatever ACTIONS give
+   it; see lib/spawn.h. */
+struct fd_table *
+syscall_create_files (const struct spawn_action *actions, int action_cnt)
+{
+  struct process *p = thread_current ()->process;
+  struct fd_table *table = fd_table_create (FD_TABLE_MIN);
+  bool success = true;
+  int fd, i;
+
+  if (table == NULL)
+    return NULL;
+  lock_acquire (&fd_lock);
+  for (fd = STDIN_FILENO; fd <= STDOUT_FILENO; fd++)
+    {
+      struct file_desc *fd_ = fd_lookup (p, fd);
+      if (fd_ != NULL)
+        {
+          fd_table_set (table, fd, fd_);
+          fd_->ref_cnt++;
+        }
+    }
+
+  /* Every file_desc in TABLE is also held by our own table, or is
+     the console, so dropping TABLE's reference never closes
+     one. */
+  for (i = 0; i < action_cnt && success; i++)
+    {
+      const struct spawn_action *a = &actions[i];
+      struct file_desc *fd_;
+
+      if (a->op == SPAWN_DUP2)
+        {
+          fd_ = fd_find (p, a->fd);
+          if (fd_ == NULL || a->new_fd < 0
+              || ((size_t) a->new_fd >= table->size
+                  && !fd_table_grow (table, a->new_fd + 1)))
+            success = false;
+          else if (table->slots[a->new_fd] != fd_)
+            {
+              if (table->slots[a->new_fd] != NULL)
+                fd_table_clear (table, a->new_fd)->ref_cnt--;
+              fd_table_set (table, a->new_fd, fd_);
+              fd_->ref_cnt++;
+            }
+        }
+      else if (a->op == SPAWN_CLOSE)
+        {
+          if (a->fd >= 0 && (size_t) a->fd < table->size
+              && table->slots[a->fd] != NULL)
+            fd_table_clear (table, a->fd)->ref_cnt--;
+          else if (a->fd != STDIN_FILENO && a->fd != STDOUT_FILENO)
+            success = false;
+        }
+      else
+        success = false;
+    }
+  lock_release (&fd_lock);
+
+  if (!success)
+    {
+      syscall_close_files (table);
+      return NULL;
+    }
+  return table;
+}
+
+/* Returns a copy of the current process's file descriptor table,
+   for a child created by fork(), or a null pointer if memory is
+   exhausted.  Each open file is reopened for the child, with its
+   own file position, shared between the child's duplicates of
+   it.  Pipes are shared with the child. */
+struct fd_table *
+syscall_copy_files (void)
+{
+  struct fd_table *table = thread_current ()->process->files;
+  struct fd_table *copy = fd_table_create (table->size);
+  bool success = true;
+  size_t i;
+
+  if (copy == NULL)
+    return NULL;
+  lock_acquire (&fd_lock);
+  copy->first_free = table->first_free;
+  for (i = 0; i < table->size && success; i++)
+    {
+      struct file_desc *fd = table->slots[i];
+
+      if (fd == NULL)
+        continue;
+      if (fd_is_console (fd))
+        fd->copy = fd;
+      else if (fd->copy == NULL)
+        {
+          fd->copy = malloc (sizeof *fd->copy);
+          if (fd->copy == NULL)
+            {
+              success = false;
+              break;
+            }
+          *fd->copy = *fd;
+          fd->copy->ref_cnt = 0;
+          fd->copy->copy = NULL;
+          if (fd->pipe != NULL)
+            pipe_open (fd->pipe, fd->writer);
+          else
+            {
+              lock_acquire (&filesys_lock);
+              fd->copy->file = file_reopen (fd->file);
+              if (fd->copy->file != NULL)
+                file_seek (fd->copy->file, file_tell (fd->file));
+              lock_release (&filesys_lock);
+              if (fd->copy->file == NULL)
+                {
+                  free (fd->copy);
+                  fd->copy = NULL;
+                  success = false;
+                  break;
+                }
+            }
+        }
+      fd->copy->ref_cnt++;
+      fd_table_set (copy, i, fd->copy);
+    }
+
+  /* Forget the copies. */
+  for (i = 0; i < table->size; i++)
+    if (table->slots[i] != NULL)
+      table->slots[i]->copy = NULL;
+  console_in.copy = console_out.copy = NULL;
+  lock_release (&fd_lock);
+
+  if (!success)
+    {
+      syscall_close_files (copy);
+      return NULL;
+    }
+  return copy;
+}
+
+/* Closes the open files in TABLE and frees it.  TABLE may be
+   null.  Nothing else may be using TABLE. */
+void
+syscall_close_files (struct fd_table *table)
+{
+  size_t i;
+
+  if (table == NULL)
+    return;
+  for (i = 0; i < table->size; i++)
+    {
+      struct file_desc *fd;
+
+      lock_acquire (&fd_lock);
+      fd = table->slots[i];
+      table->slots[i] = NULL;
+      lock_release (&fd_lock);
+      fd_put (fd);
+    }
+  bitmap_destroy (table->used);
+  free (table->slots);
+  free (table);
 }
@@ -1,6 +1,26 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct process;
+struct fd_table;
+struct spawn_action;
+
 void syscall_init (void);
+bool copy_in (void *dst, const void *usrc, size_t size);
+bool copy_out (void *udst, const void *src, size_t size);
+
+int syscall_open (struct process *, const char *file);
+int syscall_close (struct process *, int fd);
+int syscall_transfer (struct process *, int fd, void *ubuf, unsigned size,
+                      off_t *pos, bool write);
+int syscall_fsync (struct process *, int fd);
+struct fd_table *syscall_create_files (const struct spawn_action *,
+                                      int action_cnt);
+struct fd_table *syscall_copy_files (void);
+void syscall_close_files (struct fd_table *);
 
 #endif /* userprog/syscall.h */
@@ -47,7 +47,17 @@
    See [IA32-v3a] 6.2.1 "Task-State Segment (TSS)" for a
    description of the TSS.  See [IA32-v3a] 5.12.1 "Exception- or
    Interrupt-Handler Procedures" for a description of when and
-   how stack switching occurs during an interrupt. */
+   how stack switching occurs during an interrupt.
+
+   System calls made with SYSENTER do not consult the TSS, but
+   load ESP from a model-specific register, so tss_update()
+   rewrites that register along with esp0 on every thread switch.
+   The register must hold a real stack, not a pointer to one:
+   a caller that sets TF takes a debug trap on the entry stub's
+   first instruction, and the CPU pushes the trap frame wherever
+   ESP points.  See [IA32-v3b] 4.8.7 "Performing Fast Calls to
+   System Procedures with the SYSENTER and SYSEXIT
+   Instructions". */
 struct tss
   {
     uint16_t back_link, :16;
@@ -75,6 +85,26 @@ struct tss
 /* Kernel TSS. */
 static struct tss *tss;
 
+/* SYSENTER model-specific registers. */
+#define MSR_SYSENTER_CS 0x174   /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Entry point. */
+
+/* CPUID.1:EDX bit for SYSENTER and SYSEXIT. */
+#define CPUID_SEP 0x800
+
+static bool cpu_has_sep (void);
+
+/* Does the CPU support SYSENTER? */
+static bool sysenter_ok;
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint32_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "a" (value), "d" (0));
+}
+
 /* Initializes the kernel TSS. */
 void
 tss_init (void) 
@@ -85,6 +115,16 @@ tss_init (void)
   tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   tss->ss0 = SEL_KDSEG;
   tss->bitmap = 0xdfff;
+
+  /* Enable SYSENTER.  SYSEXIT takes the user code and stack
+     selectors at fixed offsets from SEL_KCSEG, which our GDT
+     layout satisfies. */
+  sysenter_ok = cpu_has_sep ();
+  if (sysenter_ok)
+    {
+      wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+      wrmsr (MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+    }
   tss_update ();
 }
 
@@ -103,4 +143,24 @@ tss_update (void)
 {
   ASSERT (tss != NULL);
   tss->esp0 = (uint8_t *) thread_current () + PGSIZE;
+  if (sysenter_ok)
+    wrmsr (MSR_SYSENTER_ESP, (uint32_t) tss->esp0);
+}
+
+/* Returns true if the CPU supports SYSENTER and SYSEXIT,
+   according to CPUID.  Early Pentium Pro processors claim to
+   support them but do not.  See [IA32-v2a] "CPUID--CPU
+   Identification". */
+static bool
+cpu_has_sep (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+  return ((edx & CPUID_SEP) != 0
+          && !(family == 6 && model < 3 && stepping < 3));
 }
@@ -8,4 +8,8 @@ void tss_init (void);
 struct tss *tss_get (void);
 void tss_update (void);
 
+/* Entry point for SYSENTER, in userprog/sysenter.S. */
+void sysenter_entry (void);
+void sysenter_clean (void);
+
 #endif /* userprog/tss.h */
@@ -0,0 +1,293 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "vm/page.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+
+/* Frame table.
+
+   Every physical page handed out to user processes has an entry
+   here, indexed by physical page number.  A frame may be mapped
+   into several page directories at once, e.g. after fork() shares
+   an address space copy-on-write, so each entry counts its
+   mappings and the frame only goes back to the user pool when
+   the last of them is dropped.
+
+   When the user pool runs dry, frame_alloc() evicts a frame
+   chosen by the clock algorithm.  Only frames with a single
+   mapping whose owner is recorded, by frame_set_owner(), can be
+   evicted: a frame shared after fork() has no owner, and stays
+   put while it is shared.
+
+   fork() maps a shared frame at the same user page in every
+   process that shares it, so a shared frame keeps its user page.
+   Once all but one of the sharers have let go of it, the clock
+   finds the process that still maps it there and makes it the
+   owner again, so that the frame can be evicted after all. */
+struct frame
+  {
+    unsigned ref_cnt;           /* Number of mappings of the frame. */
+    struct process *owner;      /* Process mapping it, if evictable. */
+    void *upage;                /* User page it is mapped at. */
+  };
+
+static struct frame *frames;    /* One entry per physical page. */
+static struct lock frame_lock;  /* Protects frames and clock_hand. */
+static size_t clock_hand;       /* Next frame for the clock to look at. */
+
+static void *evict (void);
+static struct process *find_mapper (void *kpage, void *upage);
+
+/* Returns the frame table entry for kernel virtual address
+   KPAGE. */
+static struct frame *
+frame_lookup (void *kpage)
+{
+  uintptr_t pfn = vtop (kpage) >> PGBITS;
+
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (pfn < init_ram_pages);
+  return &frames[pfn];
+}
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  frames = calloc (init_ram_pages, sizeof *frames);
+  if (frames == NULL)
+    PANIC ("frame_init: out of memory");
+  lock_init (&frame_lock);
+}
+
+/* Obtains a page from the user pool, passing FLAGS on to
+   palloc_get_page(), and returns its kernel virtual address with
+   a single reference and no owner.  If the user pool is
+   exhausted, evicts a frame instead.  Returns a null pointer if
+   no frame can be evicted either. */
+void *
+frame_alloc (enum palloc_flags flags)
+{
+  void *kpage = palloc_get_page (PAL_USER | flags);
+
+  if (kpage != NULL)
+    {
+      struct frame *f = frame_lookup (kpage);
+      ASSERT (f->ref_cnt == 0);
+      f->ref_cnt = 1;
+    }
+  else
+    {
+      kpage = evict ();
+      if (kpage != NULL && (flags & PAL_ZERO))
+        memset (kpage, 0, PGSIZE);
+    }
+  return kpage;
+}
+
+/* Records that KPAGE, which must have a single reference, is
+   mapped at UPAGE in the current process, making it a candidate
+   for eviction. */
+void
+frame_set_owner (void *kpage, void *upage)
+{
+  struct frame *f = frame_lookup (kpage);
+
+  lock_acquire (&frame_lock);
+  ASSERT (f->ref_cnt == 1);
+  f->owner = thread_current ()->process;
+  f->upage = upage;
+  lock_release (&frame_lock);
+}
+
+/* Withdraws KPAGE from eviction if the current process owns it.
+   A process must disown its frames before it tears down its page
+   directory. */
+void
+frame_disown (void *kpage)
+{
+  struct frame *f = frame_lookup (kpage);
+
+  lock_acquire (&frame_lock);
+  if (f->owner == thread_current ()->process)
+    {
+      f->owner = NULL;
+      f->upage = NULL;
+    }
+  lock_release (&frame_lock);
+}
+
+/* Adds a reference to KPAGE, which must already be allocated,
+   for a mapping at the same user page in a child created by
+   fork().  A shared frame has no owner. */
+void
+frame_ref (void *kpage)
+{
+  struct frame *f = frame_lookup (kpage);
+
+  lock_acquire (&frame_lock);
+  ASSERT (f->ref_cnt > 0);
+  f->ref_cnt++;
+  f->owner = NULL;
+  lock_release (&frame_lock);
+}
+
+/* Drops a reference to KPAGE, returning it to the user pool once
+   no references remain. */
+void
+frame_free (void *kpage)
+{
+  struct frame *f = frame_lookup (kpage);
+  bool last;
+
+  lock_acquire (&frame_lock);
+  ASSERT (f->ref_cnt > 0);
+  last = --f->ref_cnt == 0;
+  if (last)
+    {
+      f->owner = NULL;
+      f->upage = NULL;
+    }
+  lock_release (&frame_lock);
+
+  if (last)
+    palloc_free_page (kpage);
+}
+
+/* Makes KPAGE private to the caller.  If the caller holds the
+   only reference, returns KPAGE unchanged.  Otherwise, copies it
+   into a newly allocated frame, drops the caller's reference to
+   KPAGE, and returns the copy.  Returns a null pointer, leaving
+   KPAGE untouched, if no frame is available for the copy. */
+void *
+frame_unshare (void *kpage)
+{
+  struct frame *f = frame_lookup (kpage);
+  void *copy;
+  bool shared;
+
+  lock_acquire (&frame_lock);
+  shared = f->ref_cnt > 1;
+  lock_release (&frame_lock);
+  if (!shared)
+    return kpage;
+
+  /* Another sharer may drop its reference while we copy, in which
+     case the copy was unnecessary but still correct. */
+  copy = frame_alloc (0);
+  if (copy == NULL)
+    return NULL;
+  memcpy (copy, kpage, PGSIZE);
+  frame_free (kpage);
+  return copy;
+}
+
+/* Evicts an owned frame chosen by the clock algorithm and returns
+   it with a single reference and no owner, or returns a null
+   pointer if no frame can be evicted.
+
+   Evicting a frame changes its owner's page directory, so we
+   need the owner's vm_lock.  We only try for it, skipping frames
+   whose owner is busy, because the lock order elsewhere is
+   vm_lock first, then frame_lock.  If the current process is the
+   owner, it already holds the lock, as page_in() does.
+
+   A frame that fork() shared, and that is down to its last
+   mapping, gets that mapping's process as its owner here.  The
+   process is only a candidate until we hold its vm_lock and have
+   checked, with page_is_mapped(), that it still maps the frame
+   and has not begun to exit. */
+static void *
+evict (void)
+{
+  void *kpage = NULL;
+  size_t i;
+
+  lock_acquire (&frame_lock);
+  for (i = 0; kpage == NULL && i < 2 * init_ram_pages; i++)
+    {
+      struct frame *f = &frames[clock_hand];
+      void *candidate = ptov (clock_hand << PGBITS);
+      struct process *proc = f->owner;
+      bool held;
+
+      clock_hand = (clock_hand + 1) % init_ram_pages;
+      if (proc == NULL && f->ref_cnt == 1 && f->upage != NULL)
+        proc = find_mapper (candidate, f->upage);
+      if (proc == NULL)
+        continue;
+      held = lock_held_by_current_thread (&proc->vm_lock);
+      if (!held && !lock_try_acquire (&proc->vm_lock))
+        continue;
+
+      if (f->owner == NULL)
+        {
+          if (page_is_mapped (proc, f->upage, candidate))
+            f->owner = proc;
+        }
+      else if (pagedir_is_accessed (proc->pagedir, f->upage))
+        {
+          /* Give recently used frames a second chance. */
+          pagedir_set_accessed (proc->pagedir, f->upage, false);
+        }
+      else if (page_out (proc, f->upage, candidate))
+        {
+          f->owner = NULL;
+          f->upage = NULL;
+          kpage = candidate;
+        }
+
+      if (!held)
+        lock_release (&proc->vm_lock);
+    }
+  lock_release (&frame_lock);
+  return kpage;
+}
+
+/* Search state for find_mapper(). */
+struct mapper_search
+  {
+    void *kpage;                /* Frame. */
+    void *upage;                /* User page it should be mapped at. */
+    struct process *proc;       /* Process found, or null. */
+  };
+
+/* Records T's process in the mapper_search at SEARCH_ if it maps
+   the frame being searched for. */
+static void
+check_mapper (struct thread *t, void *search_)
+{
+  struct mapper_search *search = search_;
+  struct process *proc = t->process;
+
+  if (search->proc == NULL && proc != NULL && proc->pagedir != NULL
+      && pagedir_get_page (proc->pagedir, search->upage) == search->kpage)
+    search->proc = proc;
+}
+
+/* Returns a process that maps KPAGE at UPAGE, or a null pointer
+   if none of the processes with a running thread does.  A process
+   tearing down its page directory has already cleared its
+   `pagedir', so we never look at one that is being freed. */
+static struct process *
+find_mapper (void *kpage, void *upage)
+{
+  struct mapper_search search;
+  enum intr_level old_level;
+
+  search.kpage = kpage;
+  search.upage = upage;
+  search.proc = NULL;
+  old_level = intr_disable ();
+  thread_foreach (check_mapper, &search);
+  intr_set_level (old_level);
+  return search.proc;
+}
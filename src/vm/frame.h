@@ -0,0 +1,14 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include "threads/palloc.h"
+
+void frame_init (void);
+void *frame_alloc (enum palloc_flags);
+void frame_set_owner (void *kpage, void *upage);
+void frame_disown (void *kpage);
+void frame_ref (void *kpage);
+void frame_free (void *kpage);
+void *frame_unshare (void *kpage);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,791 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/swap.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+
+/* Number of pages brought in around a random fault, including
+   the faulting page itself.  1 disables fault-around. */
+size_t page_fault_around = 4;
+
+/* Largest number of pages read ahead of a sequential scan.  The
+   read-ahead window starts at page_fault_around and doubles on
+   every fault that continues the scan. */
+size_t page_readahead_max = 32;
+
+/* Largest size of a user stack, in pages. */
+size_t page_stack_max = 2048;
+
+/* Unmapped pages kept between the stack and the area below it,
+   so that running off the end of the stack faults. */
+#define STACK_GUARD_PAGES 1
+
+/* How far below the stack pointer an access may be and still
+   grow the stack.  PUSHA checks 32 bytes below it before
+   adjusting it. */
+#define STACK_SLACK 32
+
+/* Statistics. */
+static long long fault_cnt;     /* # of faults resolved by page_in(). */
+static long long seq_cnt;       /* # of those that continued a scan. */
+static long long ahead_cnt;     /* # of pages brought in ahead of use. */
+static long long ahead_hit_cnt; /* # of those later found accessed. */
+static long long evict_cnt;     /* # of pages evicted. */
+static long long clean_cnt;     /* # of those dropped without swapping. */
+static long long grow_cnt;      /* # of faults that grew a stack. */
+static long long grow_page_cnt; /* # of pages brought in by those. */
+
+static bool do_page_in (uint8_t *upage, bool write, const uint8_t *esp);
+static bool grow_stack (struct vm_area *stack, uint8_t *upage);
+static struct vm_area *find_stack (void);
+static bool is_mapped (uint32_t *pd, const void *upage);
+static struct vm_area *find_area (const void *upage);
+static bool load_page (struct vm_area *, uint8_t *upage);
+static bool swap_in_page (struct vm_area *, uint8_t *upage, size_t slot);
+static struct vm_area *find_area_in (struct process *, const void *upage);
+static bool write_back (struct vm_area *, const uint8_t *upage,
+                        const void *kpage);
+static void discard_pages (uint32_t *pd, uint8_t *start, uint8_t *end);
+static void free_area (struct vm_area *, uint32_t *pd);
+
+/* Adds an area of PAGE_CNT pages starting at UPAGE to the current
+   process, to be brought in on demand.  The first READ_BYTES
+   bytes come from FILE, starting at offset OFS, and the rest are
+   zeroed.  The area takes ownership of FILE, which may be null if
+   READ_BYTES is 0.  Returns the new area, or a null pointer,
+   closing FILE, if the area would overlap an existing one or
+   memory is exhausted. */
+struct vm_area *
+page_add_area (void *upage, size_t page_cnt, struct file *file,
+               off_t ofs, uint32_t read_bytes, bool writable)
+{
+  struct process *proc = thread_current ()->process;
+  struct vm_area *a;
+  struct list_elem *e;
+  uint8_t *start = upage;
+  uint8_t *end = start + page_cnt * PGSIZE;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (read_bytes <= page_cnt * PGSIZE);
+  ASSERT (file != NULL || read_bytes == 0);
+
+  for (e = list_begin (&proc->vm_areas); e != list_end (&proc->vm_areas);
+       e = list_next (e))
+    {
+      struct vm_area *other = list_entry (e, struct vm_area, elem);
+      if (start < other->end && other->start < end)
+        goto fail;
+    }
+
+  a = malloc (sizeof *a);
+  if (a == NULL)
+    goto fail;
+  a->start = start;
+  a->end = end;
+  a->writable = writable;
+  a->file = file;
+  a->file_ofs = ofs;
+  a->read_bytes = read_bytes;
+  a->grows_down = false;
+  a->mapid = -1;
+  a->next_fault = NULL;
+  a->window = page_fault_around;
+  list_push_back (&proc->vm_areas, &a->elem);
+  return a;
+
+ fail:
+  lock_acquire (&filesys_lock);
+  file_close (file);
+  lock_release (&filesys_lock);
+  return NULL;
+}
+
+/* Adds a stack to the current process, as an area of PAGE_CNT
+   pages just below PHYS_BASE that grows down on demand, up to
+   page_stack_max pages.  Returns false if the area would overlap
+   an existing one or memory is exhausted. */
+bool
+page_add_stack (size_t page_cnt)
+{
+  struct vm_area *a;
+
+  a = page_add_area ((uint8_t *) PHYS_BASE - page_cnt * PGSIZE, page_cnt,
+                     NULL, 0, 0, true);
+  if (a == NULL)
+    return false;
+  a->grows_down = true;
+  return true;
+}
+
+/* Brings in the page containing FAULT_ADDR, which must not be
+   present, for a read or, if WRITE is true, a write by the
+   current process, whose user stack pointer is ESP.  Returns
+   false if FAULT_ADDR is outside every area, and is not close
+   enough to ESP to grow the stack, or if the access is not
+   allowed, or if memory is exhausted.
+
+   A page that was evicted comes back from swap.  Otherwise, to
+   save traps, neighbouring pages of the same area are brought in
+   too.  A fault that lands right after the pages brought in by
+   the previous one is taken as part of a sequential scan, and the
+   window then doubles up to page_readahead_max pages, all ahead
+   of the faulting page.  Any other fault maps a window of
+   page_fault_around pages centred on the faulting page. */
+bool
+page_in (void *fault_addr, bool write, const void *esp)
+{
+  struct process *proc = thread_current ()->process;
+  bool success;
+
+  if ((const uint8_t *) fault_addr + STACK_SLACK < (const uint8_t *) esp)
+    esp = NULL;
+
+  lock_acquire (&proc->vm_lock);
+  success = do_page_in (pg_round_down (fault_addr), write, esp);
+  lock_release (&proc->vm_lock);
+  return success;
+}
+
+/* Gives the current process a private, writable copy of UPAGE,
+   which it shares copy-on-write, for a write that faulted on
+   it.  Returns false if UPAGE is not a copy-on-write page or
+   memory is exhausted. */
+bool
+page_unshare (void *upage)
+{
+  struct process *proc = thread_current ()->process;
+  bool success;
+
+  lock_acquire (&proc->vm_lock);
+  success = pagedir_unshare_page (proc->pagedir, upage);
+  if (success)
+    {
+      frame_set_owner (pagedir_get_page (proc->pagedir, upage), upage);
+      proc->usage.minflt++;
+    }
+  lock_release (&proc->vm_lock);
+  return success;
+}
+
+/* Evicts UPAGE, which process PROC maps to KPAGE, to free KPAGE for
+   frame_alloc().  The caller must hold PROC's vm_lock.
+
+   A page that is not dirty still holds what its area would
+   bring in, so it is just unmapped.  Otherwise it goes to swap,
+   or back to its file if it was mmap()'d.  Returns false, leaving
+   UPAGE mapped, if swap is full. */
+bool
+page_out (struct process *proc, void *upage, void *kpage)
+{
+  uint32_t *pd = proc->pagedir;
+  size_t slot;
+
+  /* Unmap the page first, so that its owner cannot modify it
+     while it is being written out. */
+  pagedir_clear_page (pd, upage);
+  evict_cnt++;
+  if (!pagedir_is_dirty (pd, upage))
+    {
+      clean_cnt++;
+      return true;
+    }
+  if (write_back (find_area_in (proc, upage), upage, kpage))
+    return true;
+
+  if (!swap_out (kpage, &slot))
+    {
+      evict_cnt--;
+      pagedir_set_page (pd, upage, kpage, true);
+      pagedir_set_dirty (pd, upage, true);
+      return false;
+    }
+  pagedir_set_swap (pd, upage, slot);
+  return true;
+}
+
+/* Returns true if PROC maps UPAGE to KPAGE within one of its
+   areas, as the owner of KPAGE's frame must.  The caller must
+   hold PROC's vm_lock.  A process that has begun to exit has no
+   areas left, so this is false for it. */
+bool
+page_is_mapped (struct process *proc, void *upage, void *kpage)
+{
+  return (find_area_in (proc, upage) != NULL
+          && pagedir_get_page (proc->pagedir, upage) == kpage);
+}
+
+/* Maps FILE into the current process's memory starting at ADDR,
+   for the mmap() system call, and returns its mapping id.  The
+   mapping takes ownership of FILE.  Returns -1, closing FILE, if
+   ADDR is not a page boundary, FILE is empty, or the mapping
+   would overlap memory already in use. */
+int
+page_mmap (struct file *file, void *addr)
+{
+  struct process *proc = thread_current ()->process;
+  struct list_elem *e;
+  struct vm_area *a;
+  off_t length;
+  int mapid = 0;
+
+  lock_acquire (&filesys_lock);
+  length = file_length (file);
+  lock_release (&filesys_lock);
+  if (addr == NULL || pg_ofs (addr) != 0 || length == 0
+      || (size_t) length > (size_t) ((uint8_t *) PHYS_BASE - (uint8_t *) addr))
+    {
+      lock_acquire (&filesys_lock);
+      file_close (file);
+      lock_release (&filesys_lock);
+      return -1;
+    }
+
+  lock_acquire (&proc->vm_lock);
+  for (e = list_begin (&proc->vm_areas); e != list_end (&proc->vm_areas);
+       e = list_next (e))
+    {
+      a = list_entry (e, struct vm_area, elem);
+      if (a->mapid >= mapid)
+        mapid = a->mapid + 1;
+    }
+  a = page_add_area (addr, DIV_ROUND_UP (length, PGSIZE), file, 0, length,
+                     true);
+  if (a != NULL)
+    a->mapid = mapid;
+  lock_release (&proc->vm_lock);
+  return a != NULL ? mapid : -1;
+}
+
+/* Removes mapping MAPID from the current process, writing back
+   the pages that were modified.  Returns false if there is no
+   such mapping. */
+bool
+page_munmap (int mapid)
+{
+  struct process *proc = thread_current ()->process;
+  struct list_elem *e;
+
+  lock_acquire (&proc->vm_lock);
+  for (e = list_begin (&proc->vm_areas); e != list_end (&proc->vm_areas);
+       e = list_next (e))
+    {
+      struct vm_area *a = list_entry (e, struct vm_area, elem);
+      if (a->mapid == mapid && mapid >= 0)
+        {
+          uint8_t *p;
+
+          list_remove (e);
+          for (p = a->start; p < a->end; p += PGSIZE)
+            {
+              void *kpage = pagedir_get_page (proc->pagedir, p);
+              if (kpage != NULL)
+                {
+                  frame_disown (kpage);
+                  pagedir_clear_page (proc->pagedir, p);
+                  if (pagedir_is_dirty (proc->pagedir, p))
+                    write_back (a, p, kpage);
+                  frame_free (kpage);
+                }
+            }
+          free_area (a, NULL);
+          lock_release (&proc->vm_lock);
+          return true;
+        }
+    }
+  lock_release (&proc->vm_lock);
+  return false;
+}
+
+/* Removes the area that starts at UPAGE and was not mmap()'d
+   from the current process, freeing its pages, as when a thread's
+   stack is no longer needed.  The caller must hold the process's
+   vm_lock.  Returns false if there is no such area. */
+bool
+page_remove_area (void *upage)
+{
+  struct process *proc = thread_current ()->process;
+  struct vm_area *a = find_area_in (proc, upage);
+
+  ASSERT (lock_held_by_current_thread (&proc->vm_lock));
+
+  if (a == NULL || a->start != upage || a->mapid >= 0)
+    return false;
+  list_remove (&a->elem);
+  discard_pages (proc->pagedir, a->start, a->end);
+  free_area (a, NULL);
+  return true;
+}
+
+/* Moves the end of the current process's heap, which starts at
+   page HEAP_START, from OLD_BRK to NEW_BRK, for sbrk().  The heap
+   is an area of zero-filled pages, brought in on demand; it has
+   no area while it is empty.  The caller must hold the process's
+   vm_lock.  Returns false if the heap would overlap another area
+   or memory is exhausted. */
+bool
+page_brk (void *heap_start, void *old_brk, void *new_brk)
+{
+  struct process *proc = thread_current ()->process;
+  uint8_t *old_top = pg_round_up (old_brk);
+  uint8_t *new_top = pg_round_up (new_brk);
+  struct vm_area *heap = old_top > (uint8_t *) heap_start
+                         ? find_area_in (proc, heap_start) : NULL;
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&proc->vm_lock));
+
+  if (new_top == old_top)
+    return true;
+  if (heap == NULL)
+    return page_add_area (heap_start,
+                          (new_top - (uint8_t *) heap_start) / PGSIZE,
+                          NULL, 0, 0, true) != NULL;
+
+  if (new_top > old_top)
+    {
+      for (e = list_begin (&proc->vm_areas); e != list_end (&proc->vm_areas);
+           e = list_next (e))
+        {
+          struct vm_area *other = list_entry (e, struct vm_area, elem);
+          if (other != heap && old_top < other->end
+              && other->start < new_top)
+            return false;
+        }
+    }
+  else
+    discard_pages (proc->pagedir, new_top, old_top);
+  heap->end = new_top;
+  if (heap->end == heap->start)
+    {
+      list_remove (&heap->elem);
+      free_area (heap, NULL);
+    }
+  return true;
+}
+
+/* Copies the current process's areas into AREAS, for a child
+   created by fork().  Returns false if memory is exhausted, in
+   which case AREAS may hold some of the copies.  The caller must
+   hold the current process's vm_lock. */
+bool
+page_copy_areas (struct list *areas)
+{
+  struct process *proc = thread_current ()->process;
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&proc->vm_lock));
+
+  for (e = list_begin (&proc->vm_areas); e != list_end (&proc->vm_areas);
+       e = list_next (e))
+    {
+      struct vm_area *a = list_entry (e, struct vm_area, elem);
+      struct vm_area *copy = malloc (sizeof *copy);
+
+      if (copy == NULL)
+        return false;
+      *copy = *a;
+      if (a->file != NULL)
+        {
+          lock_acquire (&filesys_lock);
+          copy->file = file_reopen (a->file);
+          lock_release (&filesys_lock);
+          if (copy->file == NULL)
+            {
+              free (copy);
+              return false;
+            }
+        }
+      list_push_back (areas, &copy->elem);
+    }
+  return true;
+}
+
+/* Frees the areas in AREAS, which were never part of a running
+   process. */
+void
+page_free_areas (struct list *areas)
+{
+  while (!list_empty (areas))
+    free_area (list_entry (list_pop_front (areas), struct vm_area, elem),
+               NULL);
+}
+
+/* Frees the current process's areas and withdraws its frames
+   from eviction.  Must be called before its page directory is
+   destroyed. */
+void
+page_exit (void)
+{
+  struct process *proc = thread_current ()->process;
+
+  lock_acquire (&proc->vm_lock);
+  while (!list_empty (&proc->vm_areas))
+    free_area (list_entry (list_pop_front (&proc->vm_areas),
+                           struct vm_area, elem), proc->pagedir);
+  lock_release (&proc->vm_lock);
+}
+
+/* Prints paging statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Paging: %lld faults (%lld sequential), "
+          "%lld pages faulted around, %lld used\n",
+          fault_cnt, seq_cnt, ahead_cnt, ahead_hit_cnt);
+  printf ("Eviction: %lld pages evicted, %lld of them clean\n",
+          evict_cnt, clean_cnt);
+  printf ("Stack growth: %lld faults, %lld pages\n",
+          grow_cnt, grow_page_cnt);
+  swap_print_stats ();
+}
+
+/* Brings in UPAGE for page_in().  ESP is null unless the fault
+   was close enough to the stack pointer to grow the stack.  The
+   caller must hold the current process's vm_lock.
+
+   Counts the fault in the process's resource usage as major if
+   it read the page from a file or swap, minor otherwise. */
+static bool
+do_page_in (uint8_t *upage, bool write, const uint8_t *esp)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct rusage *usage = &thread_current ()->process->usage;
+  struct vm_area *a = find_area (upage);
+  uint8_t *first, *last, *p;
+  size_t before, slot;
+
+  if (a == NULL && esp != NULL)
+    {
+      uint8_t *old_start;
+
+      a = find_stack ();
+      if (a == NULL)
+        return false;
+      old_start = a->start;
+      if (!grow_stack (a, upage) || !load_page (a, upage))
+        {
+          a->start = old_start;
+          return false;
+        }
+      grow_cnt++;
+      grow_page_cnt++;
+      usage->minflt++;
+
+      /* Bring in the rest of the extension too, up to the
+         read-ahead limit above the faulting page.  A fault more
+         than a page below the old bottom means that a large frame
+         has just been pushed, all of which will be used soon. */
+      last = old_start;
+      if ((size_t) (last - upage) / PGSIZE > page_readahead_max)
+        last = upage + page_readahead_max * PGSIZE;
+      for (p = a->start; p < last; p += PGSIZE)
+        if (p != upage)
+          {
+            if (!load_page (a, p))
+              break;
+            grow_page_cnt++;
+          }
+      return true;
+    }
+
+  if (a == NULL || (write && !a->writable))
+    return false;
+  if (pagedir_get_page (pd, upage) != NULL)
+    {
+      usage->minflt++;
+      return true;
+    }
+  if (pagedir_get_swap (pd, upage, &slot))
+    {
+      if (!swap_in_page (a, upage, slot))
+        return false;
+      usage->majflt++;
+      return true;
+    }
+  if (!load_page (a, upage))
+    return false;
+  fault_cnt++;
+  if ((size_t) (upage - a->start) < a->read_bytes)
+    usage->majflt++;
+  else
+    usage->minflt++;
+
+  /* Pick the window. */
+  if (upage == a->next_fault)
+    {
+      seq_cnt++;
+      a->window *= 2;
+      if (a->window > page_readahead_max)
+        a->window = page_readahead_max;
+      before = 0;
+    }
+  else
+    {
+      a->window = page_fault_around;
+      before = (a->window - 1) / 2;
+    }
+  if (before > (size_t) (upage - a->start) / PGSIZE)
+    before = (upage - a->start) / PGSIZE;
+  first = upage - before * PGSIZE;
+  last = (size_t) (a->end - first) / PGSIZE > a->window
+         ? first + a->window * PGSIZE : a->end;
+
+  /* Fill in whatever the window lacks, giving up quietly if
+     memory runs short. */
+  for (p = first; p < last; p += PGSIZE)
+    if (p != upage && !is_mapped (pd, p))
+      {
+        if (!load_page (a, p))
+          break;
+        pagedir_set_ahead (pd, p);
+        ahead_cnt++;
+      }
+  a->next_fault = last;
+  return true;
+}
+
+/* Returns true if UPAGE is present in PD or swapped out. */
+static bool
+is_mapped (uint32_t *pd, const void *upage)
+{
+  return (pagedir_get_page (pd, upage) != NULL
+          || pagedir_get_swap (pd, upage, NULL));
+}
+
+/* Extends STACK, the current process's stack, down to UPAGE,
+   which lies below it.  Returns false if that would make the
+   stack larger than page_stack_max pages or bring it within
+   STACK_GUARD_PAGES of another area.
+
+   A fault on the page just below the stack usually comes from a
+   deep recursion, which will go on to fault on the pages below
+   one at a time, so in that case the stack grows by a chunk of
+   page_fault_around pages instead. */
+static bool
+grow_stack (struct vm_area *stack, uint8_t *upage)
+{
+  struct process *proc = thread_current ()->process;
+  uint8_t *limit, *start = upage;
+  struct list_elem *e;
+
+  ASSERT (upage < stack->start);
+  if (page_stack_max > (size_t) PHYS_BASE / PGSIZE)
+    return false;
+  limit = (uint8_t *) PHYS_BASE - page_stack_max * PGSIZE;
+  if (upage < limit)
+    return false;
+  if (upage + PGSIZE == stack->start)
+    start = (size_t) (upage - limit) / PGSIZE >= page_fault_around - 1
+            ? upage - (page_fault_around - 1) * PGSIZE : limit;
+
+  for (e = list_begin (&proc->vm_areas); e != list_end (&proc->vm_areas);
+       e = list_next (e))
+    {
+      struct vm_area *other = list_entry (e, struct vm_area, elem);
+      uint8_t *floor = other->end + STACK_GUARD_PAGES * PGSIZE;
+
+      if (other == stack || other->end > stack->start)
+        continue;
+      if (floor > upage)
+        return false;
+      if (floor > start)
+        start = floor;
+    }
+  stack->start = start;
+  return true;
+}
+
+/* Returns the current process's stack area, or a null pointer if
+   it has none. */
+static struct vm_area *
+find_stack (void)
+{
+  struct process *proc = thread_current ()->process;
+  struct list_elem *e;
+
+  for (e = list_begin (&proc->vm_areas); e != list_end (&proc->vm_areas);
+       e = list_next (e))
+    {
+      struct vm_area *a = list_entry (e, struct vm_area, elem);
+      if (a->grows_down)
+        return a;
+    }
+  return NULL;
+}
+
+/* Returns the current process's area containing UPAGE, or a null
+   pointer if there is none. */
+static struct vm_area *
+find_area (const void *upage)
+{
+  return find_area_in (thread_current ()->process, upage);
+}
+
+/* Returns process PROC's area containing UPAGE, or a null pointer if
+   there is none. */
+static struct vm_area *
+find_area_in (struct process *proc, const void *upage)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&proc->vm_areas); e != list_end (&proc->vm_areas);
+       e = list_next (e))
+    {
+      struct vm_area *a = list_entry (e, struct vm_area, elem);
+      if ((const uint8_t *) upage >= a->start
+          && (const uint8_t *) upage < a->end)
+        return a;
+    }
+  return NULL;
+}
+
+/* Reads page UPAGE of area A into a new frame and maps it in the
+   current process.  Returns false if memory is exhausted or the
+   file cannot be read. */
+static bool
+load_page (struct vm_area *a, uint8_t *upage)
+{
+  size_t ofs = upage - a->start;
+  size_t read_bytes = 0;
+  uint8_t *kpage;
+
+  if (ofs < a->read_bytes)
+    read_bytes = a->read_bytes - ofs < PGSIZE ? a->read_bytes - ofs : PGSIZE;
+
+  kpage = frame_alloc (0);
+  if (kpage == NULL)
+    return false;
+  if (read_bytes > 0)
+    {
+      off_t bytes_read;
+
+      lock_acquire (&filesys_lock);
+      bytes_read = file_read_at (a->file, kpage, read_bytes,
+                                 a->file_ofs + ofs);
+      lock_release (&filesys_lock);
+      if (bytes_read != (off_t) read_bytes)
+        goto fail;
+    }
+  memset (kpage + read_bytes, 0, PGSIZE - read_bytes);
+
+  if (!pagedir_set_page (thread_current ()->pagedir, upage, kpage,
+                         a->writable))
+    goto fail;
+  frame_set_owner (kpage, upage);
+  return true;
+
+ fail:
+  frame_free (kpage);
+  return false;
+}
+
+/* Reads page UPAGE of area A back from swap slot SLOT into a new
+   frame and maps it in the current process.  Returns false if
+   memory is exhausted. */
+static bool
+swap_in_page (struct vm_area *a, uint8_t *upage, size_t slot)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  uint8_t *kpage = frame_alloc (0);
+
+  if (kpage == NULL)
+    return false;
+  swap_in (slot, kpage);
+
+  /* The PTE still records SLOT, so it cannot need a new page
+     table. */
+  pagedir_set_page (pd, upage, kpage, a->writable);
+
+  /* The page no longer matches its area's backing file, so make
+     sure that the next eviction writes it to swap again. */
+  pagedir_set_dirty (pd, upage, true);
+  pagedir_set_accessed (pd, upage, true);
+  frame_set_owner (kpage, upage);
+  return true;
+}
+
+/* If area A was mmap()'d, writes page UPAGE of it, whose
+   contents are at KPAGE, back to A's file and returns true.
+   Otherwise returns false. */
+static bool
+write_back (struct vm_area *a, const uint8_t *upage, const void *kpage)
+{
+  size_t ofs;
+
+  if (a == NULL || a->mapid < 0)
+    return false;
+  ofs = upage - a->start;
+  if (ofs < a->read_bytes)
+    {
+      size_t size = a->read_bytes - ofs < PGSIZE ? a->read_bytes - ofs : PGSIZE;
+
+      lock_acquire (&filesys_lock);
+      file_write_at (a->file, kpage, size, a->file_ofs + ofs);
+      lock_release (&filesys_lock);
+    }
+  return true;
+}
+
+/* Unmaps the pages from START up to END in PD, which belong to
+   an area that is going away, and frees them, whether in memory
+   or in swap, without writing them back. */
+static void
+discard_pages (uint32_t *pd, uint8_t *start, uint8_t *end)
+{
+  uint8_t *p;
+
+  for (p = start; p < end; p += PGSIZE)
+    {
+      void *kpage = pagedir_get_page (pd, p);
+      size_t slot;
+
+      if (kpage != NULL)
+        {
+          frame_disown (kpage);
+          pagedir_clear_page (pd, p);
+          frame_free (kpage);
+        }
+      else if (pagedir_get_swap (pd, p, &slot))
+        {
+          pagedir_clear_swap (pd, p);
+          swap_free (slot);
+        }
+    }
+}
+
+/* Frees area A.  If PD is nonnull, first withdraws the pages of A
+   from eviction, writes back those of an mmap()'d area that were
+   modified, and credits fault-around with those it brought in
+   and that were used. */
+static void
+free_area (struct vm_area *a, uint32_t *pd)
+{
+  uint8_t *p;
+
+  if (pd != NULL)
+    for (p = a->start; p < a->end; p += PGSIZE)
+      {
+        void *kpage = pagedir_get_page (pd, p);
+
+        if (kpage == NULL)
+          continue;
+        frame_disown (kpage);
+        if (pagedir_is_dirty (pd, p))
+          write_back (a, p, kpage);
+        if (pagedir_clear_ahead (pd, p) && pagedir_is_accessed (pd, p))
+          ahead_hit_cnt++;
+      }
+  lock_acquire (&filesys_lock);
+  file_close (a->file);
+  lock_release (&filesys_lock);
+  free (a);
+}
@@ -0,0 +1,68 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct process;
+
+/* A range of a process's user virtual memory whose pages are
+   brought in on demand by page_in(), such as an ELF segment or
+   the stack.
+
+   The first READ_BYTES bytes of the area come from FILE starting
+   at offset FILE_OFS; the rest is zero-filled.  Once a page has
+   been brought in it belongs to the process, so writes to a
+   writable area never go back to the file.
+
+   The stack is the one area that grows down: a fault just below
+   it, near the user stack pointer, extends it.
+
+   An area created by mmap() is the exception to the rule above:
+   its pages are written back to FILE when they are evicted or
+   unmapped, instead of going to swap. */
+struct vm_area
+  {
+    uint8_t *start;             /* First page. */
+    uint8_t *end;               /* One past the last page. */
+    bool writable;              /* Whether the process may write it. */
+    struct file *file;          /* Backing file, or null. */
+    off_t file_ofs;             /* File offset of START. */
+    uint32_t read_bytes;        /* Bytes to read from FILE. */
+    bool grows_down;            /* True for the stack. */
+    int mapid;                  /* Mapping id, or -1 if not mmap()'d. */
+
+    /* Sequential access detection. */
+    uint8_t *next_fault;        /* Where a sequential scan faults next. */
+    size_t window;              /* Pages brought in on last fault. */
+
+    struct list_elem elem;      /* Element in thread's `vm_areas'. */
+  };
+
+/* Tunables, set from the kernel command line. */
+extern size_t page_fault_around;
+extern size_t page_readahead_max;
+extern size_t page_stack_max;
+
+struct vm_area *page_add_area (void *upage, size_t page_cnt, struct file *,
+                               off_t ofs, uint32_t read_bytes,
+                               bool writable);
+bool page_add_stack (size_t page_cnt);
+bool page_in (void *fault_addr, bool write, const void *esp);
+bool page_unshare (void *upage);
+bool page_out (struct process *, void *upage, void *kpage);
+bool page_is_mapped (struct process *, void *upage, void *kpage);
+int page_mmap (struct file *, void *addr);
+bool page_munmap (int mapid);
+bool page_remove_area (void *upage);
+bool page_brk (void *heap_start, void *old_brk, void *new_brk);
+bool page_copy_areas (struct list *);
+void page_free_areas (struct list *);
+void page_exit (void);
+void page_print_stats (void);
+
+#endif /* vm/page.h */
@@ -0,0 +1,303 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <lz.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap space.
+
+   Pages evicted from memory go to one of two tiers.  The first
+   is a pool of kernel pages holding them compressed, which costs
+   only a decompression to read back.  Only when the pool is full,
+   or a page does not compress well, does the page go to the
+   second tier, the swap block device, which Pintos drives with
+   slow programmed I/O.
+
+   A slot names a page in either tier: its low bit is the tier
+   and the remaining bits an index within the tier.  Slots are
+   reference counted, because fork() shares swapped-out pages
+   between parent and child just as it shares frames. */
+enum swap_tier
+  {
+    TIER_POOL,                  /* Compressed in the pool. */
+    TIER_DISK,                  /* On the swap device. */
+    TIER_CNT
+  };
+
+/* Size of the pool, in pages.  0 disables it. */
+size_t swap_pool_pages = 64;
+
+/* Pool allocation unit, in bytes. */
+#define UNIT_SIZE 64
+
+/* Pages that compress to more than this many bytes go to disk,
+   if there is one, because they would eat up the pool. */
+#define MAX_ZLEN (PGSIZE * 3 / 4)
+
+/* A compressed page in the pool. */
+struct zpage
+  {
+    size_t unit;                /* First unit. */
+    uint16_t len;               /* Length, PGSIZE if uncompressed. */
+    uint16_t ref_cnt;           /* Number of references, 0 if free. */
+  };
+
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct lock swap_lock;   /* Protects everything below. */
+
+/* Pool tier. */
+static uint8_t *pool;           /* SWAP_POOL_PAGES pages. */
+static struct bitmap *pool_map; /* Units in use. */
+static struct zpage *zpages;    /* One per unit, as the upper bound. */
+static struct bitmap *zpage_map; /* Elements of ZPAGES in use. */
+
+/* Disk tier. */
+static struct block *swap_dev;  /* Swap device, or null. */
+static struct bitmap *disk_map; /* Pages in use. */
+static uint16_t *disk_refs;     /* Reference counts. */
+
+/* Scratch space for compression. */
+static uint8_t zbuf[MAX_ZLEN];
+static uint8_t lz_work[LZ_WORK_SIZE];
+
+/* Statistics. */
+static long long out_cnt[TIER_CNT];     /* # of pages written. */
+static long long in_cnt[TIER_CNT];      /* # of pages read back. */
+static uint64_t in_cycles[TIER_CNT];    /* CPU cycles spent reading. */
+static long long zbytes;                /* Bytes written to the pool. */
+
+static bool out_pool (const void *kpage, size_t *slot);
+static bool out_disk (const void *kpage, size_t *slot);
+static void free_slot (size_t slot);
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Sets up swap space: a pool of swap_pool_pages kernel pages and
+   the BLOCK_SWAP device, if any. */
+void
+swap_init (void)
+{
+  lock_init (&swap_lock);
+
+  if (swap_pool_pages > 0)
+    {
+      size_t unit_cnt = swap_pool_pages * (PGSIZE / UNIT_SIZE);
+
+      pool = palloc_get_multiple (0, swap_pool_pages);
+      pool_map = bitmap_create (unit_cnt);
+      zpages = malloc (unit_cnt * sizeof *zpages);
+      zpage_map = bitmap_create (unit_cnt);
+      if (pool == NULL || pool_map == NULL || zpages == NULL
+          || zpage_map == NULL)
+        PANIC ("swap_init: cannot allocate %zu-page pool", swap_pool_pages);
+    }
+
+  swap_dev = block_get_role (BLOCK_SWAP);
+  if (swap_dev != NULL)
+    {
+      size_t page_cnt = block_size (swap_dev) / SECTORS_PER_PAGE;
+
+      disk_map = bitmap_create (page_cnt);
+      disk_refs = calloc (page_cnt, sizeof *disk_refs);
+      if (disk_map == NULL || disk_refs == NULL)
+        PANIC ("swap_init: out of memory");
+    }
+}
+
+/* Writes the page at KPAGE to swap and stores the slot it went
+   to in *SLOT.  Returns false if swap is full. */
+bool
+swap_out (const void *kpage, size_t *slot)
+{
+  bool success;
+
+  lock_acquire (&swap_lock);
+  success = out_pool (kpage, slot) || out_disk (kpage, slot);
+  lock_release (&swap_lock);
+  return success;
+}
+
+/* Reads the page in SLOT into KPAGE and drops a reference to
+   SLOT. */
+void
+swap_in (size_t slot, void *kpage)
+{
+  enum swap_tier tier = slot & 1;
+  size_t idx = slot >> 1;
+  uint64_t start;
+
+  lock_acquire (&swap_lock);
+  start = rdtsc ();
+  if (tier == TIER_POOL)
+    {
+      struct zpage *z = &zpages[idx];
+      const uint8_t *data = pool + z->unit * UNIT_SIZE;
+
+      ASSERT (z->ref_cnt > 0);
+      if (z->len == PGSIZE)
+        memcpy (kpage, data, PGSIZE);
+      else if (lz_decompress (data, z->len, kpage, PGSIZE) != PGSIZE)
+        PANIC ("swap slot %zu corrupt", slot);
+    }
+  else
+    {
+      size_t i;
+
+      ASSERT (disk_refs[idx] > 0);
+      for (i = 0; i < SECTORS_PER_PAGE; i++)
+        block_read (swap_dev, idx * SECTORS_PER_PAGE + i,
+                    (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+    }
+  in_cycles[tier] += rdtsc () - start;
+  in_cnt[tier]++;
+  free_slot (slot);
+  lock_release (&swap_lock);
+}
+
+/* Adds a reference to SLOT. */
+void
+swap_ref (size_t slot)
+{
+  size_t idx = slot >> 1;
+
+  lock_acquire (&swap_lock);
+  if ((slot & 1) == TIER_POOL)
+    {
+      ASSERT (zpages[idx].ref_cnt > 0);
+      zpages[idx].ref_cnt++;
+    }
+  else
+    {
+      ASSERT (disk_refs[idx] > 0);
+      disk_refs[idx]++;
+    }
+  lock_release (&swap_lock);
+}
+
+/* Drops a reference to SLOT, freeing it once no references
+   remain. */
+void
+swap_free (size_t slot)
+{
+  lock_acquire (&swap_lock);
+  free_slot (slot);
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  static const char *names[TIER_CNT] = {"compressed", "disk"};
+  int tier;
+
+  printf ("Swap: %lld pages compressed to %lld%% of their size\n",
+          out_cnt[TIER_POOL],
+          out_cnt[TIER_POOL] > 0
+          ? zbytes * 100 / (out_cnt[TIER_POOL] * PGSIZE) : 0);
+  for (tier = 0; tier < TIER_CNT; tier++)
+    printf ("Swap %s: %lld pages out, %lld in, %llu cycles per fault\n",
+            names[tier], out_cnt[tier], in_cnt[tier],
+            in_cnt[tier] > 0 ? in_cycles[tier] / in_cnt[tier] : 0);
+}
+
+/* Tries to store KPAGE compressed in the pool, setting *SLOT.
+   Pages that do not compress well are only stored, uncompressed,
+   when there is no swap device to take them instead. */
+static bool
+out_pool (const void *kpage, size_t *slot)
+{
+  const void *data = zbuf;
+  size_t len, unit, idx;
+
+  if (pool == NULL)
+    return false;
+
+  len = lz_compress (kpage, PGSIZE, zbuf, sizeof zbuf, lz_work);
+  if (len == 0)
+    {
+      if (swap_dev != NULL)
+        return false;
+      data = kpage;
+      len = PGSIZE;
+    }
+
+  unit = bitmap_scan_and_flip (pool_map, 0, DIV_ROUND_UP (len, UNIT_SIZE),
+                               false);
+  if (unit == BITMAP_ERROR)
+    return false;
+  idx = bitmap_scan_and_flip (zpage_map, 0, 1, false);
+  ASSERT (idx != BITMAP_ERROR);
+
+  zpages[idx].unit = unit;
+  zpages[idx].len = len;
+  zpages[idx].ref_cnt = 1;
+  memcpy (pool + unit * UNIT_SIZE, data, len);
+  out_cnt[TIER_POOL]++;
+  zbytes += len;
+  *slot = (idx << 1) | TIER_POOL;
+  return true;
+}
+
+/* Tries to write KPAGE to the swap device, setting *SLOT. */
+static bool
+out_disk (const void *kpage, size_t *slot)
+{
+  size_t idx, i;
+
+  if (swap_dev == NULL)
+    return false;
+  idx = bitmap_scan_and_flip (disk_map, 0, 1, false);
+  if (idx == BITMAP_ERROR)
+    return false;
+
+  disk_refs[idx] = 1;
+  for (i = 0; i < SECTORS_PER_PAGE; i++)
+    block_write (swap_dev, idx * SECTORS_PER_PAGE + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  out_cnt[TIER_DISK]++;
+  *slot = (idx << 1) | TIER_DISK;
+  return true;
+}
+
+/* Drops a reference to SLOT.  The caller must hold swap_lock. */
+static void
+free_slot (size_t slot)
+{
+  size_t idx = slot >> 1;
+
+  if ((slot & 1) == TIER_POOL)
+    {
+      struct zpage *z = &zpages[idx];
+
+      ASSERT (z->ref_cnt > 0);
+      if (--z->ref_cnt == 0)
+        {
+          bitmap_set_multiple (pool_map, z->unit,
+                               DIV_ROUND_UP (z->len, UNIT_SIZE), false);
+          bitmap_reset (zpage_map, idx);
+        }
+    }
+  else
+    {
+      ASSERT (disk_refs[idx] > 0);
+      if (--disk_refs[idx] == 0)
+        bitmap_reset (disk_map, idx);
+    }
+}
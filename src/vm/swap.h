@@ -0,0 +1,18 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Size of the compressed swap pool, in pages, set from the
+   kernel command line. */
+extern size_t swap_pool_pages;
+
+void swap_init (void);
+bool swap_out (const void *kpage, size_t *slot);
+void swap_in (size_t slot, void *kpage);
+void swap_ref (size_t slot);
+void swap_free (size_t slot);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */